@@ -0,0 +1,466 @@
+/** \file   AssetCache.cpp
+ *  \brief  Implémente la classe AssetCache
+ */
+#include "AssetCache.h"
+
+#include <sstream>
+
+#define FNV_OFFSET              14695981039346656037ULL
+#define FNV_PRIME               1099511628211ULL
+
+
+/**
+ * Constructeur de AssetCache: vide, budget par défaut
+ */
+AssetCache::AssetCache()
+{
+    device = NULL;
+    budget = ASSET_BUDGET * 1024ULL * 1024ULL;
+    memory = 0;
+    useCounter = 0;
+
+    nbHits = 0;
+    nbDedup = 0;
+    nbLoads = 0;
+    nbEvictions = 0;
+}
+
+/**
+ * Destructeur de AssetCache
+ */
+AssetCache::~AssetCache()
+{
+}
+
+
+/**
+ * Donne le device qui charge les assets
+ *
+ * @param device        Device d'Irrlicht, NULL pour le détacher
+ */
+void AssetCache::setDevice(irr::IrrlichtDevice* device)
+{
+    this->device = device;
+}
+
+
+/**
+ * Change le budget mémoire, et libére le surplus s'il est dépassé
+ *
+ * @param budget        Octets
+ */
+void AssetCache::setBudget(boost::uint64_t budget)
+{
+    this->budget = budget;
+    evict(budget);
+}
+
+
+/**
+ * Libére tout les assets, même référencés (a faire avant de détruire le
+ * device)
+ */
+void AssetCache::clear()
+{
+    while(!l_byAsset.empty())
+        unload(l_byAsset.begin()->second);
+
+    l_archive.clear();
+}
+
+
+/**
+ * Monte une archive dans le systéme de fichiers, une seule fois
+ *
+ * @param path          Chemin de l'archive
+ *
+ * @return              false si l'archive ne peut pas être montée
+ */
+bool AssetCache::mountArchive(const string& path)
+{
+    if(l_archive.find(path) != l_archive.end())
+        return true;
+
+    if(!device->getFileSystem()->addFileArchive(path.c_str()))
+        return false;
+
+    l_archive.insert(path);
+    return true;
+}
+
+
+/**
+ * Indique si un fichier est déja chargé: asset en cache, quel que soit son
+ * type, ou archive montée
+ *
+ * @param path          Chemin du fichier
+ */
+bool AssetCache::isCached(const string& path) const
+{
+    for(irr::u32 i=0; i<ASSET_TYPE_COUNT; i++)
+        if(l_byPath[i].find(path) != l_byPath[i].end())
+            return true;
+
+    return l_archive.find(path) != l_archive.end();
+}
+
+
+/**
+ * Donne un mesh, chargé s'il n'est pas en cache. Prend une référence.
+ *
+ * @param path          Chemin du mesh
+ *
+ * @return              NULL si le chargement a échoué
+ */
+irr::scene::IAnimatedMesh* AssetCache::getMesh(const string& path)
+{
+    boost::uint64_t hash, size;
+    Asset* asset = find(ASSET_MESH, path, hash, size);
+
+    if(!asset) {
+        irr::scene::IAnimatedMesh* mesh =
+                device->getSceneManager()->getMesh(path.c_str());
+        if(!mesh)
+            return NULL;
+
+        asset = new Asset;
+        asset->mesh = mesh;
+        asset->texture = NULL;
+        asset->asset = mesh;
+        asset->type = ASSET_MESH;
+        asset->hash = hash;
+        asset->memory = getMeshMemory(mesh);
+        if(asset->memory < size)
+            asset->memory = size;
+
+        insert(asset, path);
+    }
+
+    acquire(asset);
+    return asset->mesh;
+}
+
+
+/**
+ * Donne une texture, chargée si elle n'est pas en cache. Prend une
+ * référence.
+ *
+ * @param path          Chemin de la texture
+ *
+ * @return              NULL si le chargement a échoué
+ */
+irr::video::ITexture* AssetCache::getTexture(const string& path)
+{
+    boost::uint64_t hash, size;
+    Asset* asset = find(ASSET_TEXTURE, path, hash, size);
+
+    if(!asset) {
+        irr::video::ITexture* texture =
+                device->getVideoDriver()->getTexture(path.c_str());
+        if(!texture)
+            return NULL;
+
+        asset = new Asset;
+        asset->mesh = NULL;
+        asset->texture = texture;
+        asset->asset = texture;
+        asset->type = ASSET_TEXTURE;
+        asset->hash = hash;
+        asset->memory = (boost::uint64_t)texture->getPitch()
+                * texture->getSize().Height;
+
+        insert(asset, path);
+    }
+
+    acquire(asset);
+    return asset->texture;
+}
+
+
+/**
+ * Donne une texture créée depuis une image (lightmap), sous un nom qui
+ * n'est pas un fichier. Prend une référence.
+ *
+ * @param name          Nom de la texture dans le cache
+ * @param image         Pixels, utilisés si le nom n'est pas en cache
+ *
+ * @return              NULL si la création a échoué
+ */
+irr::video::ITexture* AssetCache::addTexture(const string& name,
+        irr::video::IImage* image)
+{
+    Asset* asset;
+
+    map<string, Asset*>::iterator it = l_byPath[ASSET_TEXTURE].find(name);
+    if(it != l_byPath[ASSET_TEXTURE].end()) {
+        nbHits++;
+        asset = it->second;
+    }
+    else {
+        irr::video::ITexture* texture =
+                device->getVideoDriver()->addTexture(name.c_str(), image);
+        if(!texture)
+            return NULL;
+
+        asset = new Asset;
+        asset->mesh = NULL;
+        asset->texture = texture;
+        asset->asset = texture;
+        asset->type = ASSET_TEXTURE;
+        asset->hash = 0;
+        asset->memory = (boost::uint64_t)texture->getPitch()
+                * texture->getSize().Height;
+
+        insert(asset, name);
+    }
+
+    acquire(asset);
+    return asset->texture;
+}
+
+
+/**
+ * Rend une référence prise par getMesh ou getTexture. L'asset reste en
+ * cache tant que le budget le permet.
+ *
+ * @param asset         Mesh ou texture
+ */
+void AssetCache::release(irr::IReferenceCounted* asset)
+{
+    map<irr::IReferenceCounted*, Asset*>::iterator it = l_byAsset.find(asset);
+    if(it == l_byAsset.end() || it->second->references == 0)
+        return;
+
+    if(--it->second->references == 0)
+        evict(budget);
+}
+
+
+/**
+ * Cherche un asset d'un type par chemin, puis par contenu
+ *
+ * @param type          Type demandé
+ * @param path          Chemin demandé
+ * @param hash          Reçoit l'empreinte du fichier (0 si déja en cache
+ *                      par son chemin ou illisible)
+ * @param size          Reçoit la taille du fichier
+ *
+ * @return              NULL si l'asset doit être chargé
+ */
+AssetCache::Asset* AssetCache::find(EnumAssetType type, const string& path,
+        boost::uint64_t& hash, boost::uint64_t& size)
+{
+    hash = 0;
+    size = 0;
+
+    map<string, Asset*>::iterator it = l_byPath[type].find(path);
+    if(it != l_byPath[type].end()) {
+        nbHits++;
+        return it->second;
+    }
+
+    if(!hashFile(path, hash, size))
+        return NULL;
+
+    map<boost::uint64_t, Asset*>::iterator same = l_byHash[type].find(hash);
+    if(same == l_byHash[type].end())
+        return NULL;
+
+    // Même fichier sous un autre chemin
+    l_byPath[type][path] = same->second;
+    nbDedup++;
+
+    return same->second;
+}
+
+
+/**
+ * Ajoute un asset chargé au cache, sans référence
+ *
+ * @param asset         Asset rempli par getMesh ou getTexture (type
+ *                      compris)
+ * @param path          Chemin chargé
+ */
+AssetCache::Asset* AssetCache::insert(Asset* asset, const string& path)
+{
+    asset->asset->grab();
+    asset->path = path;
+    asset->references = 0;
+    asset->lastUse = 0;
+
+    l_byPath[asset->type][path] = asset;
+    l_byAsset[asset->asset] = asset;
+    if(asset->hash)
+        l_byHash[asset->type][asset->hash] = asset;
+
+    memory += asset->memory;
+    nbLoads++;
+
+    return asset;
+}
+
+
+/**
+ * Prend une référence sur un asset, le fait passer en tête de l'ordre LRU
+ * et libére le surplus du budget
+ *
+ * @param asset         Asset en cache
+ */
+void AssetCache::acquire(Asset* asset)
+{
+    asset->references++;
+    asset->lastUse = ++useCounter;
+
+    evict(budget);
+}
+
+
+/**
+ * Libére les assets sans référence, le moins récemment utilisé d'abord,
+ * jusqu'a revenir sous une limite
+ *
+ * @param limite        Octets
+ */
+void AssetCache::evict(boost::uint64_t limite)
+{
+    while(memory > limite) {
+        Asset* ancien = NULL;
+
+        map<irr::IReferenceCounted*, Asset*>::iterator it;
+        for(it = l_byAsset.begin(); it != l_byAsset.end(); it++)
+            if(it->second->references == 0
+                    && (!ancien || it->second->lastUse < ancien->lastUse))
+                ancien = it->second;
+
+        // Tout est utilisé: le budget est dépassé
+        if(!ancien)
+            return;
+
+        unload(ancien);
+        nbEvictions++;
+    }
+}
+
+
+/**
+ * Retire un asset du cache et le libére dans Irrlicht
+ *
+ * @param asset         Asset en cache
+ */
+void AssetCache::unload(Asset* asset)
+{
+    // Tout les chemins qui y menaient
+    map<string, Asset*>& l_path = l_byPath[asset->type];
+    map<string, Asset*>::iterator it = l_path.begin();
+    while(it != l_path.end()) {
+        if(it->second == asset)
+            l_path.erase(it++);
+        else
+            it++;
+    }
+
+    if(asset->hash)
+        l_byHash[asset->type].erase(asset->hash);
+    l_byAsset.erase(asset->asset);
+
+    if(asset->mesh)
+        device->getSceneManager()->getMeshCache()->removeMesh(asset->mesh);
+    else
+        device->getVideoDriver()->removeTexture(asset->texture);
+
+    asset->asset->drop();
+
+    memory -= asset->memory;
+    delete asset;
+}
+
+
+/**
+ * Calcule l'empreinte FNV-1a 64 bits d'un fichier (archives montées
+ * comprises)
+ *
+ * @param path          Chemin du fichier
+ * @param hash          Reçoit l'empreinte
+ * @param size          Reçoit la taille
+ *
+ * @return              false si le fichier ne peut pas être lu
+ */
+bool AssetCache::hashFile(const string& path, boost::uint64_t& hash,
+        boost::uint64_t& size)
+{
+    irr::io::IReadFile* fichier =
+            device->getFileSystem()->createAndOpenFile(path.c_str());
+    if(!fichier)
+        return false;
+
+    unsigned char tampon[65536];
+    irr::s32 lus;
+
+    hash = FNV_OFFSET;
+    while((lus = fichier->read(tampon, sizeof(tampon))) > 0)
+        for(irr::s32 i=0; i<lus; i++) {
+            hash ^= tampon[i];
+            hash *= FNV_PRIME;
+        }
+
+    size = fichier->getSize();
+    fichier->drop();
+
+    return true;
+}
+
+
+/**
+ * Estime la mémoire des mesh buffers d'un mesh (premiére image)
+ *
+ * @param mesh          Mesh chargé
+ *
+ * @return              Octets
+ */
+boost::uint64_t AssetCache::getMeshMemory(irr::scene::IAnimatedMesh* mesh)
+{
+    irr::scene::IMesh* image = mesh->getMesh(0);
+    if(!image)
+        return 0;
+
+    boost::uint64_t octets = 0;
+    for(irr::u32 i=0; i<image->getMeshBufferCount(); i++) {
+        irr::scene::IMeshBuffer* buffer = image->getMeshBuffer(i);
+
+        octets += (boost::uint64_t)buffer->getVertexCount()
+                * irr::video::getVertexPitchFromType(buffer->getVertexType());
+        octets += (boost::uint64_t)buffer->getIndexCount() * sizeof(irr::u16);
+    }
+
+    return octets;
+}
+
+
+/**
+ * Donne la mémoire estimée des assets en cache
+ *
+ * @return              Octets
+ */
+boost::uint64_t AssetCache::getMemory() const
+{
+    return memory;
+}
+
+
+/**
+ * Résumé du cache
+ */
+string AssetCache::toString() const
+{
+    ostringstream resume;
+
+    resume  << l_byAsset.size() << " assets, "
+            << (memory / (1024 * 1024)) << "/"
+            << (budget / (1024 * 1024)) << " Mo, "
+            << nbLoads << " chargements, "
+            << nbHits << " en cache, "
+            << nbDedup << " doublons, "
+            << nbEvictions << " liberes";
+
+    return resume.str();
+}
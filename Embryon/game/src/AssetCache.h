@@ -0,0 +1,113 @@
+/** \file   AssetCache.h
+ *  \brief  Définit la classe AssetCache
+ */
+#ifndef ASSETCACHE_H
+#define ASSETCACHE_H
+
+#include <irrlicht.h>
+#include <map>
+#include <set>
+#include <string>
+#include <boost/cstdint.hpp>
+
+#define ASSET_BUDGET            128     // Budget mémoire par défaut (Mo)
+
+using namespace std;
+
+
+/** \enum   EnumAssetType
+ *  \brief  Type d'un asset: chaque type a ses propres index
+ */
+enum EnumAssetType {
+    ASSET_MESH=0,
+    ASSET_TEXTURE,
+    ASSET_TYPE_COUNT
+};
+
+
+/** \class  AssetCache
+ *  \brief  Cache des meshes et des textures, conservé d'un niveau a l'autre.
+ *
+ * Chaque asset est compté: getMesh et getTexture prennent une référence,
+ * release la rend. Un asset sans référence reste chargé, il est réutilisé
+ * tel quel au prochain niveau, et n'est libéré (du mesh cache d'Irrlicht
+ * ou du driver) que si le budget mémoire est dépassé, le moins récemment
+ * utilisé d'abord.
+ *
+ * Les chargements sont dédupliqués par chemin puis, pour un chemin
+ * inconnu, par empreinte du contenu du fichier (FNV-1a 64 bits): deux
+ * chemins vers le même fichier partagent un seul asset. Les index sont
+ * séparés par type: un fichier demandé comme mesh puis comme texture
+ * donne deux assets.
+ *
+ * La mémoire d'un asset est estimée: taille des mesh buffers (ou du
+ * fichier si elle est plus grande), pitch * hauteur d'une texture. Les
+ * textures créées par les loaders (Q3) ne sont pas comptées.
+ * Comme Irrlicht, ne doit être utilisé que depuis le thread de rendu.
+ */
+class AssetCache
+{
+    public:
+        AssetCache();
+        virtual ~AssetCache();
+
+        void setDevice(irr::IrrlichtDevice* device);
+        void setBudget(boost::uint64_t budget);
+        void clear();
+
+        bool mountArchive(const string& path);
+        bool isCached(const string& path) const;
+
+        irr::scene::IAnimatedMesh* getMesh(const string& path);
+        irr::video::ITexture* getTexture(const string& path);
+        irr::video::ITexture* addTexture(const string& name,
+                irr::video::IImage* image);
+        void release(irr::IReferenceCounted* asset);
+
+        // Accesseurs
+        boost::uint64_t getMemory() const;
+        string toString() const;
+    protected:
+    private:
+        struct Asset
+        {
+            irr::scene::IAnimatedMesh* mesh;    // L'un ou l'autre
+            irr::video::ITexture* texture;
+            irr::IReferenceCounted* asset;      // Clé de release
+            EnumAssetType type;
+            string path;                        // Premier chemin chargé
+            boost::uint64_t hash;
+            boost::uint64_t memory;             // Octets (estimation)
+            irr::u32 references;
+            irr::u32 lastUse;                   // Pour l'éviction LRU
+        };
+
+        irr::IrrlichtDevice* device;
+        boost::uint64_t budget;
+        boost::uint64_t memory;
+        irr::u32 useCounter;
+
+        map<string, Asset*> l_byPath[ASSET_TYPE_COUNT];
+        map<boost::uint64_t, Asset*> l_byHash[ASSET_TYPE_COUNT];
+        map<irr::IReferenceCounted*, Asset*> l_byAsset;
+        set<string> l_archive;
+
+        // Statistiques
+        irr::u32 nbHits;
+        irr::u32 nbDedup;
+        irr::u32 nbLoads;
+        irr::u32 nbEvictions;
+
+        Asset* find(EnumAssetType type, const string& path,
+                boost::uint64_t& hash, boost::uint64_t& size);
+        Asset* insert(Asset* asset, const string& path);
+        void acquire(Asset* asset);
+        void evict(boost::uint64_t limite);
+        void unload(Asset* asset);
+        bool hashFile(const string& path, boost::uint64_t& hash,
+                boost::uint64_t& size);
+
+        static boost::uint64_t getMeshMemory(irr::scene::IAnimatedMesh* mesh);
+};
+
+#endif // ASSETCACHE_H
@@ -0,0 +1,19 @@
+/** \file   Benchmark.h
+ *  \brief  Déclare les mesures de la cible Benchmark
+ *
+ * Ces mesures ne sont pas compilées dans le jeu: la cible Benchmark du
+ * projet les lance une a une (voir Benchmark/main.cpp).
+ */
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <ostream>
+#include <irrlicht.h>
+
+using namespace std;
+
+void benchmarkMessages(ostream& out, irr::u32 nbMessages);
+void benchmarkJobSystem(ostream& out, irr::u32 maxWorkers);
+void benchmarkPlayer(ostream& out);
+
+#endif // BENCHMARK_H
@@ -0,0 +1,79 @@
+/** \file   JobBenchmark.cpp
+ *  \brief  Mesure le passage a l'échelle du JobSystem
+ */
+#include "Benchmark.h"
+
+#include <cmath>
+#include <vector>
+
+#include "../Core/JobSystem.h"
+#include "../Core/TimeService.h"
+
+
+/**
+ * Charge de travail du benchmark: calcul flottant indépendant par élément
+ *
+ * @param data          Tableau de résultats
+ * @param begin         Premier élément
+ * @param end           Fin de l'intervalle (exclue)
+ */
+static void benchmarkJob(void* data, irr::u32 begin, irr::u32 end)
+{
+    irr::f32* resultats = (irr::f32*)data;
+
+    for(irr::u32 i=begin; i<end; i++) {
+        irr::f32 x = (irr::f32)i;
+        for(int j=0; j<32; j++)
+            x = sqrtf(x + 1.0f) * 1.5f;
+        resultats[i] = x;
+    }
+}
+
+
+/**
+ * Mesure le passage a l'échelle du JobSystem: la même charge est
+ * exécutée avec 0, 1, 3, 7, ... workers (soit 1, 2, 4, 8, ... threads en
+ * comptant l'appelant) puis avec maxWorkers.
+ *
+ * @param out           Flux recevant les résultats
+ * @param maxWorkers    Nombre maximal de workers
+ */
+void benchmarkJobSystem(ostream& out, irr::u32 maxWorkers)
+{
+    static const irr::u32 nbElements = 1 << 20;
+    static const irr::u32 grain = 1024;
+    static const int nbRepetitions = 8;
+
+    vector<irr::f32> resultats(nbElements);
+    boost::uint64_t reference = 0;
+
+    out << "Benchmark JobSystem: " << nbElements << " elements, tranches de "
+        << grain << endl;
+
+    irr::u32 nbThreads = 1;
+    while(true) {
+        irr::u32 workers = nbThreads - 1;
+        if(workers > maxWorkers)
+            workers = maxWorkers;
+
+        JobSystem jobSystem(workers);
+
+        // Une passe a vide pour réveiller les workers
+        jobSystem.parallelFor(nbElements, grain, &benchmarkJob, &resultats[0]);
+
+        boost::uint64_t debut = TimeService::now();
+        for(int i=0; i<nbRepetitions; i++)
+            jobSystem.parallelFor(nbElements, grain, &benchmarkJob, &resultats[0]);
+        boost::uint64_t duree = (TimeService::now() - debut) / nbRepetitions;
+
+        if(reference == 0)
+            reference = duree;
+
+        out << "    " << (workers + 1) << " threads: " << (duree / 1000)
+            << " us, acceleration x" << ((double)reference / duree) << endl;
+
+        if(workers == maxWorkers)
+            break;
+        nbThreads *= 2;
+    }
+}
@@ -0,0 +1,120 @@
+/** \file   MessageBenchmark.cpp
+ *  \brief  Mesure le coût d'un message entre modules
+ */
+#include "Benchmark.h"
+
+#include "../Core/Core.h"
+#include "../Core/TimeService.h"
+#include "../Modules/Module.h"
+
+#define BENCHMARK_LOT   (MODULE_QUEUE_SIZE / 2)     // Messages entre deux vidages
+
+
+/** \class  BenchmarkModule
+ *  \brief  Module destinataire des messages mesurés: les compte seulement
+ */
+class BenchmarkModule : public Module
+{
+    public:
+        BenchmarkModule(Core* core) : Module(GAME, "Benchmark", core)
+        {
+            nbRecus = 0;
+        }
+
+        void vider()
+        {
+            processQueue();
+        }
+
+        irr::u32 nbRecus;
+    protected:
+        void processMessage(module_message&)
+        {
+            nbRecus++;
+        }
+};
+
+
+/**
+ * Prépare le message d'indice i: les actions alternent entre les membres
+ * de MessageData les plus envoyés en partie
+ *
+ * @param msg           Message neuf a remplir
+ * @param i             Indice du message
+ */
+static void prepareMessage(module_message& msg, irr::u32 i)
+{
+    msg.idExpediteur = EVENTS;
+    msg.idDestination = GAME;
+
+    switch(i % 4) {
+    case 0:
+        msg.codeAction = ACTION_START_WALKING_FORWARDS;
+        msg.data.input.time = i;
+        msg.data.input.gameTime = i;
+        break;
+
+    case 1:
+        msg.codeAction = ACTION_STOP_WALKING_FORWARDS;
+        msg.data.input.time = i;
+        msg.data.input.gameTime = i;
+        break;
+
+    case 2:
+        msg.codeAction = ACTION_PLAYER_SPAWN;
+        msg.data.spawn.x = (irr::f32)i;
+        msg.data.spawn.y = 0;
+        msg.data.spawn.z = 0;
+        break;
+
+    default:
+        msg.codeAction = ACTION_NOUVELLE_PARTIE;
+        msg.data.nouvellePartie.niveau = i % 6;
+        break;
+    }
+}
+
+
+/**
+ * Mesure le chemin complet d'un message dans un seul thread: création,
+ * Core::sendMessage, dépôt dans la file du module (pushMessage), puis
+ * traitement par lots (processQueue). La file est vidée tout les
+ * BENCHMARK_LOT messages, sans attente ni réveil de thread.
+ *
+ * @param out           Flux recevant les résultats
+ * @param nbMessages    Nombre de messages envoyés
+ */
+void benchmarkMessages(ostream& out, irr::u32 nbMessages)
+{
+    Core core;
+    BenchmarkModule module(&core);
+
+    // Une passe a vide pour les caches et l'allocation des statistiques
+    for(irr::u32 i=0; i<BENCHMARK_LOT; i++) {
+        module_message msg;
+        prepareMessage(msg, i);
+        core.sendMessage(msg);
+    }
+    module.vider();
+    module.nbRecus = 0;
+
+    boost::uint64_t debut = TimeService::now();
+
+    for(irr::u32 i=0; i<nbMessages; i++) {
+        module_message msg;
+        prepareMessage(msg, i);
+        core.sendMessage(msg);
+
+        if((i + 1) % BENCHMARK_LOT == 0)
+            module.vider();
+    }
+    module.vider();
+
+    boost::uint64_t duree = TimeService::now() - debut;
+
+    out << "Benchmark messages: " << module.nbRecus << "/" << nbMessages
+        << " messages, vidage tout les " << BENCHMARK_LOT << endl;
+    out << "    " << (duree / nbMessages) << " ns/message, "
+        << (irr::u32)(nbMessages * 1000000000.0 / duree) << " messages/s"
+        << endl;
+}
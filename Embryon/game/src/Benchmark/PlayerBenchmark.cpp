@@ -0,0 +1,57 @@
+/** \file   PlayerBenchmark.cpp
+ *  \brief  Mesure le coût de la visée du joueur
+ */
+#include "Benchmark.h"
+
+#include "../Player.h"
+#include "../Core/TimeService.h"
+#include "../Core/WorldSnapshot.h"
+
+
+/**
+ * Mesure le coût de la visée sur des pas chargés en collisions: chaque pas
+ * déplace le joueur de nbCorrections positions (repousser) puis publie son
+ * snapshot. Compare un calcul de la visée a chaque position (lecture forcée
+ * aprés chaque déplacement) au calcul a la lecture.
+ *
+ * @param out           Flux recevant les résultats
+ */
+void benchmarkPlayer(ostream& out)
+{
+    static const int nbTicks = 10000;
+    static const int nbCorrections = 16;
+
+    WorldSnapshot snapshot;
+    boost::uint64_t duree[2];
+
+    for(int lazy=0; lazy<2; lazy++) {
+        Player player;
+        player.setMouseRay(irr::core::line3df(
+                irr::core::vector3df(0, 200, 0),
+                irr::core::vector3df(10, -100, 30)));
+
+        boost::uint64_t debut = TimeService::now();
+
+        for(int i=0; i<nbTicks; i++) {
+            for(int j=0; j<nbCorrections; j++) {
+                player.setPosition(
+                        irr::core::vector3df((irr::f32)i, 0, (irr::f32)j));
+
+                if(!lazy)
+                    player.getViseurRay();
+            }
+
+            player.advancePosition(player.getPosition());
+            player.writeSnapshot(snapshot);
+        }
+
+        duree[lazy] = TimeService::now() - debut;
+    }
+
+    out << "Benchmark Player: " << nbTicks << " pas, " << nbCorrections
+        << " positions par pas" << endl;
+    out << "    visee a chaque position: " << (duree[0] / nbTicks)
+        << " ns/pas" << endl;
+    out << "    visee a la lecture: " << (duree[1] / nbTicks)
+        << " ns/pas, acceleration x" << ((double)duree[0] / duree[1]) << endl;
+}
@@ -0,0 +1,24 @@
+/** \file   Benchmark/main.cpp
+ *  \brief  Point d'entrée de la cible Benchmark: lance les mesures sans
+ *          fenêtre ni partie, et affiche leurs résultats
+ */
+#include <iostream>
+#include <boost/thread.hpp>
+
+#include "Benchmark.h"
+
+using namespace std;
+
+
+int main()
+{
+    benchmarkMessages(cout, 1000000);
+
+    // Jusqu'a un worker par coeur, l'appelant aidant aussi
+    irr::u32 nbCoeurs = boost::thread::hardware_concurrency();
+    benchmarkJobSystem(cout, nbCoeurs > 1 ? nbCoeurs - 1 : 1);
+
+    benchmarkPlayer(cout);
+
+    return 0;
+}
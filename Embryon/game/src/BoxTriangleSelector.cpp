@@ -0,0 +1,184 @@
+/** \file   BoxTriangleSelector.cpp
+ *  \brief  Implémente la classe BoxTriangleSelector
+ */
+#include "BoxTriangleSelector.h"
+
+// Coins d'une boite: bit 0 X max, bit 1 Y max, bit 2 Z max. Faces
+// tournées vers l'extérieur (seules celles-ci arrêtent le joueur).
+static const irr::u32 l_boxTriangle[12][3] = {
+    {0, 6, 2}, {0, 4, 6},       // Y min
+    {1, 3, 7}, {1, 7, 5},       // Y max
+    {0, 1, 5}, {0, 5, 4},       // Z min
+    {2, 7, 3}, {2, 6, 7},       // Z max
+    {0, 3, 1}, {0, 2, 3},       // X min
+    {4, 5, 7}, {4, 7, 6}        // X max
+};
+
+
+/**
+ * Constructeur de BoxTriangleSelector. Appelé par le rendu, qui peut alors
+ * lire la node.
+ *
+ * @param node          Node représentée (identifiant)
+ * @param id            Type de la node (SCENE_NODE_*)
+ * @param box           Boite englobante, dans le repére de la node
+ */
+BoxTriangleSelector::BoxTriangleSelector(irr::scene::ISceneNode* node,
+        irr::s32 id, const irr::core::aabbox3df& box)
+{
+    this->node = node;
+    this->id = id;
+    this->box = box;
+
+    setTransform(irr::core::vector3df(0, 0, 0), irr::core::vector3df(0, 0, 0));
+}
+
+/**
+ * Destructeur de BoxTriangleSelector
+ */
+BoxTriangleSelector::~BoxTriangleSelector()
+{
+}
+
+
+/**
+ * Place la boite
+ *
+ * @param position      Position simulée
+ * @param rotation      Rotation simulée (degrés)
+ */
+void BoxTriangleSelector::setTransform(const irr::core::vector3df& position,
+        const irr::core::vector3df& rotation)
+{
+    irr::core::matrix4 transform;
+    transform.setRotationDegrees(rotation);
+    transform.setTranslation(position);
+
+    this->position = position;
+    transformedBox = box;
+    transform.transformBoxEx(transformedBox);
+}
+
+
+// ITriangleSelector
+/**
+ * Donne le nombre de triangles: 2 par face
+ */
+irr::s32 BoxTriangleSelector::getTriangleCount() const
+{
+    return 12;
+}
+
+
+/**
+ * Donne les triangles de la boite
+ *
+ * @param triangles         Reçoit les triangles
+ * @param arraySize         Taille du tableau
+ * @param outTriangleCount  Nombre de triangles écrits
+ * @param transform         Transformation a appliquer (ou NULL)
+ */
+void BoxTriangleSelector::getTriangles(irr::core::triangle3df* triangles,
+        irr::s32 arraySize, irr::s32& outTriangleCount,
+        const irr::core::matrix4* transform) const
+{
+    irr::core::vector3df coin[8];
+    for(irr::u32 i=0; i<8; i++) {
+        coin[i].X = (i & 1) ? transformedBox.MaxEdge.X : transformedBox.MinEdge.X;
+        coin[i].Y = (i & 2) ? transformedBox.MaxEdge.Y : transformedBox.MinEdge.Y;
+        coin[i].Z = (i & 4) ? transformedBox.MaxEdge.Z : transformedBox.MinEdge.Z;
+
+        if(transform)
+            transform->transformVect(coin[i]);
+    }
+
+    outTriangleCount = arraySize < 12 ? arraySize : 12;
+    for(irr::s32 i=0; i<outTriangleCount; i++)
+        triangles[i].set(coin[l_boxTriangle[i][0]],
+                coin[l_boxTriangle[i][1]], coin[l_boxTriangle[i][2]]);
+}
+
+
+/**
+ * Donne les triangles de la boite: tous, comme le sélecteur d'Irrlicht
+ *
+ * @param triangles         Reçoit les triangles
+ * @param arraySize         Taille du tableau
+ * @param outTriangleCount  Nombre de triangles écrits
+ * @param box               Zone recherchée (ignorée)
+ * @param transform         Transformation a appliquer (ou NULL)
+ */
+void BoxTriangleSelector::getTriangles(irr::core::triangle3df* triangles,
+        irr::s32 arraySize, irr::s32& outTriangleCount,
+        const irr::core::aabbox3df& box,
+        const irr::core::matrix4* transform) const
+{
+    getTriangles(triangles, arraySize, outTriangleCount, transform);
+}
+
+
+/**
+ * Donne les triangles de la boite: tous, comme le sélecteur d'Irrlicht
+ *
+ * @param triangles         Reçoit les triangles
+ * @param arraySize         Taille du tableau
+ * @param outTriangleCount  Nombre de triangles écrits
+ * @param line              Segment recherché (ignoré)
+ * @param transform         Transformation a appliquer (ou NULL)
+ */
+void BoxTriangleSelector::getTriangles(irr::core::triangle3df* triangles,
+        irr::s32 arraySize, irr::s32& outTriangleCount,
+        const irr::core::line3df& line,
+        const irr::core::matrix4* transform) const
+{
+    getTriangles(triangles, arraySize, outTriangleCount, transform);
+}
+
+
+/**
+ * Donne la node d'un triangle: identifie la boite heurtée
+ *
+ * @param triangleIndex     Index du triangle (ignoré)
+ */
+irr::scene::ISceneNode* BoxTriangleSelector::getSceneNodeForTriangle(
+        irr::u32 triangleIndex) const
+{
+    return node;
+}
+
+
+// Accesseurs
+/**
+ * Donne la node représentée, a ne pas lire hors du thread du rendu
+ */
+irr::scene::ISceneNode* BoxTriangleSelector::getNode() const
+{
+    return node;
+}
+
+
+/**
+ * Donne le type de la node représentée (SCENE_NODE_*)
+ */
+irr::s32 BoxTriangleSelector::getID() const
+{
+    return id;
+}
+
+
+/**
+ * Donne la position de la boite
+ */
+const irr::core::vector3df& BoxTriangleSelector::getPosition() const
+{
+    return position;
+}
+
+
+/**
+ * Donne la boite, placée
+ */
+const irr::core::aabbox3df& BoxTriangleSelector::getTransformedBoundingBox() const
+{
+    return transformedBox;
+}
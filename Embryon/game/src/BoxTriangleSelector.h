@@ -0,0 +1,62 @@
+/** \file   BoxTriangleSelector.h
+ *  \brief  Définit la classe BoxTriangleSelector
+ */
+#ifndef BOXTRIANGLESELECTOR_H
+#define BOXTRIANGLESELECTOR_H
+
+#include <irrlicht.h>
+
+
+/** \class  BoxTriangleSelector
+ *  \brief  Boite de collision tenue par la simulation.
+ *
+ * Comme le sélecteur de createTriangleSelectorFromBoundingBox, donne les
+ * 12 triangles d'une boite englobante. Mais la boite est une copie: sa
+ * position est celle de la simulation (setTransform) et non celle de la
+ * node, que le rendu modifie dans son thread.
+ *
+ * La node n'est gardée que comme identifiant (getSceneNodeForTriangle,
+ * getNode): elle n'est jamais lue.
+ */
+class BoxTriangleSelector : public irr::scene::ITriangleSelector
+{
+    public:
+        BoxTriangleSelector(irr::scene::ISceneNode* node, irr::s32 id,
+                const irr::core::aabbox3df& box);
+        virtual ~BoxTriangleSelector();
+
+        void setTransform(const irr::core::vector3df& position,
+                const irr::core::vector3df& rotation);
+
+        // ITriangleSelector
+        virtual irr::s32 getTriangleCount() const;
+        virtual void getTriangles(irr::core::triangle3df* triangles,
+                irr::s32 arraySize, irr::s32& outTriangleCount,
+                const irr::core::matrix4* transform=0) const;
+        virtual void getTriangles(irr::core::triangle3df* triangles,
+                irr::s32 arraySize, irr::s32& outTriangleCount,
+                const irr::core::aabbox3df& box,
+                const irr::core::matrix4* transform=0) const;
+        virtual void getTriangles(irr::core::triangle3df* triangles,
+                irr::s32 arraySize, irr::s32& outTriangleCount,
+                const irr::core::line3df& line,
+                const irr::core::matrix4* transform=0) const;
+        virtual irr::scene::ISceneNode* getSceneNodeForTriangle(
+                irr::u32 triangleIndex) const;
+
+        // Accesseurs
+        irr::scene::ISceneNode* getNode() const;
+        irr::s32 getID() const;
+        const irr::core::vector3df& getPosition() const;
+        const irr::core::aabbox3df& getTransformedBoundingBox() const;
+    protected:
+    private:
+        irr::scene::ISceneNode* node;       // Identifiant, jamais lu
+        irr::s32 id;                        // SCENE_NODE_*
+
+        irr::core::aabbox3df box;           // Repére de la node
+        irr::core::vector3df position;
+        irr::core::aabbox3df transformedBox;
+};
+
+#endif // BOXTRIANGLESELECTOR_H
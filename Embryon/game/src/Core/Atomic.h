@@ -0,0 +1,105 @@
+/** \file   Atomic.h
+ *  \brief  Définit quelques opérations atomiques
+ *
+ * Le projet est compilé avec gcc (MinGW) sans support C++11: les opérations
+ * atomiques reposent sur les builtins __sync de gcc.
+ */
+#ifndef ATOMIC_H
+#define ATOMIC_H
+
+#include <irrlicht.h>
+
+
+// Barriére empêchant le compilateur de réordonner les accés mémoire.
+// Sur x86 elle suffit pour obtenir la sémantique acquire/release.
+#if defined(__i386__) || defined(__x86_64__)
+    #define ATOMIC_ACQUIRE_RELEASE()    __asm__ __volatile__("" ::: "memory")
+#else
+    #define ATOMIC_ACQUIRE_RELEASE()    __sync_synchronize()
+#endif
+
+
+/**
+ * Lit une valeur partagée (sémantique acquire)
+ *
+ * @param value         Valeur a lire
+ *
+ * @return              Valeur lue
+ */
+inline irr::u32 atomicLoad(volatile irr::u32& value)
+{
+    irr::u32 result = value;
+    ATOMIC_ACQUIRE_RELEASE();
+
+    return result;
+}
+
+
+/**
+ * Ecrit une valeur partagée (sémantique release)
+ *
+ * @param value         Valeur a modifier
+ * @param newValue      Nouvelle valeur
+ */
+inline void atomicStore(volatile irr::u32& value, irr::u32 newValue)
+{
+    ATOMIC_ACQUIRE_RELEASE();
+    value = newValue;
+}
+
+
+/**
+ * Ajoute une quantité a une valeur partagée
+ *
+ * @param value         Valeur a modifier
+ * @param increment     Quantité a ajouter
+ *
+ * @return              Valeur aprés l'ajout
+ */
+inline irr::u32 atomicAdd(volatile irr::u32& value, irr::u32 increment)
+{
+    return __sync_add_and_fetch(&value, increment);
+}
+
+
+/**
+ * Remplace une valeur partagée si elle vaut encore expected
+ *
+ * @param value         Valeur a modifier
+ * @param expected      Valeur attendue
+ * @param newValue      Nouvelle valeur
+ *
+ * @return              true si la valeur a été remplacée
+ */
+inline bool atomicCompareAndSwap(volatile irr::u32& value,
+        irr::u32 expected, irr::u32 newValue)
+{
+    return __sync_bool_compare_and_swap(&value, expected, newValue);
+}
+
+
+/**
+ * Remplace une valeur partagée et donne l'ancienne (barriére compléte)
+ *
+ * @param value         Valeur a modifier
+ * @param newValue      Nouvelle valeur
+ *
+ * @return              Valeur avant le remplacement
+ */
+inline irr::u32 atomicExchange(volatile irr::u32& value, irr::u32 newValue)
+{
+    // __sync_lock_test_and_set n'est qu'une barriére acquire
+    __sync_synchronize();
+    return __sync_lock_test_and_set(&value, newValue);
+}
+
+
+/**
+ * Barriére mémoire compléte (ordonne aussi une écriture suivie d'une lecture)
+ */
+inline void atomicFence()
+{
+    __sync_synchronize();
+}
+
+#endif // ATOMIC_H
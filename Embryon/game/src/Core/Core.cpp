@@ -4,12 +4,17 @@
 #include "Core.h"
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <boost/bind.hpp>
 #include <boost/thread.hpp>
+#include <boost/date_time.hpp>
 
+#include "Atomic.h"
 #include "../Modules/Module.h"
 #include "../GUI/ChooseLevelMenu.h"
 #include "../GUI/GameMenu.h"
+#include "../GUI/LoadingMenu.h"
 #include "../GUI/MainMenu.h"
 #include "../GUI/OptionMenu.h"
 #include "../GUI/PauseMenu.h"
@@ -17,7 +22,7 @@
 
 /**
  * Constructeur de Core. Instancie le Logger
- * et met isRunning a true
+ * et lance l'application (GAME_STATE_RUNNING)
  */
 Core::Core() :
 #ifdef _DEBUG
@@ -31,9 +36,17 @@ Core::Core() :
 {
     log("Initialisation du Core");
 
-    boost::mutex::scoped_lock l(mutexRunning);
-    isRunning = true;
-    setPartieEnCours(false);
+    debut = TimeService::now();
+    inputAck = 0;
+
+    for(int i=0; i<MODULE_COUNT; i++)
+        l_module[i] = NULL;
+    for(int i=0; i<TOPIC_COUNT; i++)
+        nbSubscribers[i] = 0;
+
+    // Application lancée, aucune partie, menu principal
+    atomicStore(gameState,
+            GAME_STATE_RUNNING | GameState::menuBits(IN_MAIN_MENU));
 
     // Définitions des GUI
     l_GUIPage[IN_MAIN_MENU] = new MainMenu(this);
@@ -41,8 +54,27 @@ Core::Core() :
     l_GUIPage[IN_OPTIONS_MENU] = new OptionMenu(this);
     l_GUIPage[IN_PAUSE_MENU] = new PauseMenu(this);
     l_GUIPage[IN_GAME] = new GameMenu(this);
+    l_GUIPage[IN_LOADING_MENU] = new LoadingMenu(this);
+
+    loadRecorderConfig();
+    loadHeadlessConfig();
+    loadTimeConfig();
+
+    map<string, int> config = loadConfig("CORE");
+    if(config.find("scheduler") == config.end())    config["scheduler"] = SCHEDULER_THREADS;
+    if(config.find("workers") == config.end())      config["workers"] = 0;
+    saveConfig("CORE", config);
 
-    menuState = IN_MAIN_MENU;
+    scheduler = (EnumScheduler)config["scheduler"];
+
+    // 0: un worker par coeur, le thread qui attend un job aidant aussi
+    irr::u32 nbWorkers = config["workers"];
+    if(nbWorkers == 0) {
+        nbWorkers = boost::thread::hardware_concurrency();
+        nbWorkers = nbWorkers > 1 ? nbWorkers - 1 : 1;
+    }
+
+    jobSystem = new JobSystem(nbWorkers);
 }
 
 /**
@@ -50,7 +82,7 @@ Core::Core() :
  */
 Core::~Core()
 {
-    //dtor
+    delete jobSystem;
 }
 
 
@@ -60,35 +92,222 @@ Core::~Core()
  */
 void Core::main()
 {
-    map<EnumModuleId, Module*>::iterator iteratorModule;
+    loadThreadConfig();
+    placeThread(CORE, "Core");
+
+    debut = TimeService::now();
 
+    if(scheduler == SCHEDULER_COOPERATIVE)
+        runCooperative();
+    else
+        runThreads();
+
+    cpuTime = getCurrentThreadCpuTime();
+
+    // Statistiques des modules
+    for(int i=0; i<MODULE_COUNT; i++) {
+        if(l_module[i])
+            l_module[i]->logStatistics();
+    }
+    log(jobSystem->getStatistics());
+    dumpStatistics(STATISTICS_FILE);
+
+    if(recorder.getMode() != RECORDER_OFF) {
+        ostringstream journal;
+        journal << "Journal de session: " << recorder.getNbRecords()
+                << " enregistrements";
+        log(journal.str());
+    }
+    recorder.close();
+
+    // Temps CPU de chaque thread, pour vérifier le placement
+    double secondes = (TimeService::now() - debut) / 1000000000.0;
+
+    ostringstream stats;
+    stats << "Temps CPU du thread 'Core': " << (cpuTime / 1000000) << " ms";
+    if(secondes > 0)
+        stats << " (" << (cpuTime / 10000000.0 / secondes) << "%)";
+    log(stats.str());
+
+    for(int i=0; i<MODULE_COUNT; i++) {
+        Module* module = l_module[i];
+        if(!module || scheduler == SCHEDULER_COOPERATIVE)
+            continue;
+
+        boost::uint64_t cpu = module->getCpuTime();
+
+        stats.str("");
+        stats << "Temps CPU du thread '" << module->getName() << "': "
+              << (cpu / 1000000) << " ms";
+        if(secondes > 0)
+            stats << " (" << (cpu / 10000000.0 / secondes) << "%)";
+        log(stats.str());
+    }
+
+    log("Fermeture de l'application");
+}
+
+
+/**
+ * Ordonnanceur SCHEDULER_THREADS: chaque module tourne dans son thread
+ */
+void Core::runThreads()
+{
     // Lance les thread
-    for(iteratorModule = l_module.begin();
-        iteratorModule != l_module.end();
-        iteratorModule++)
-    {
-        Module* module = iteratorModule->second;
-        string name = module->getName();
+    for(int i=0; i<MODULE_COUNT; i++) {
+        Module* module = l_module[i];
+        if(!module)
+            continue;
 
-        log("Lancement du thread '" + name + "'");
+        log("Lancement du thread '" + module->getName() + "'");
         module->setThread(new boost::thread(
-                boost::bind(&Module::frame, module)
+                boost::bind(&Core::runModuleThread, this, module)
         ));
     }
 
     // Attend la fin des thread
     log("Attente de la fin des thread ...");
-    for(iteratorModule = l_module.begin();
-        iteratorModule != l_module.end();
-        iteratorModule++)
-    {
-        Module* module = iteratorModule->second;
-
-        module->getThread()->join();
+    for(int i=0; i<MODULE_COUNT; i++) {
+        if(l_module[i])
+            l_module[i]->getThread()->join();
     }
 
     log("Tout les thread sont termine");
-    log("Fermeture de l'application");
+}
+
+
+/**
+ * Corps du thread d'un module (SCHEDULER_THREADS): place le thread, fait
+ * tourner le module puis reléve son temps CPU
+ *
+ * @param module        Module a faire tourner
+ */
+void Core::runModuleThread(Module* module)
+{
+    placeThread(module->getId(), module->getName());
+
+    module->frame();
+
+    module->setCpuTime(getCurrentThreadCpuTime());
+}
+
+
+/**
+ * Charge le placement des threads (section THREADS). Pour chaque module:
+ *  - <Module>Affinity: masque des coeurs autorisés (0: tous)
+ *  - <Module>Priority: de -2 (minimale) a 2 (maximale), voir
+ *    EnumThreadPriority
+ * names active le nommage des threads ("Emb-" suivi du module).
+ */
+void Core::loadThreadConfig()
+{
+    map<string, int> config = loadConfig("THREADS");
+
+    if(config.find("names") == config.end())    config["names"] = 1;
+    threadNames = config["names"] != 0;
+
+    for(int i=0; i<MODULE_COUNT; i++) {
+        threadAffinity[i] = 0;
+        threadPriority[i] = PRIORITE_NORMALE;
+
+        if(i != CORE && !l_module[i])
+            continue;
+
+        string nom = i == CORE ? "Core" : l_module[i]->getName();
+        string affinity = nom + "Affinity";
+        string priority = nom + "Priority";
+
+        if(config.find(affinity) == config.end())   config[affinity] = 0;
+        if(config.find(priority) == config.end())   config[priority] = 0;
+
+        if(config[priority] < PRIORITE_MINIMALE)
+            config[priority] = PRIORITE_MINIMALE;
+        if(config[priority] > PRIORITE_MAXIMALE)
+            config[priority] = PRIORITE_MAXIMALE;
+
+        threadAffinity[i] = config[affinity];
+        threadPriority[i] = (EnumThreadPriority)config[priority];
+    }
+
+    saveConfig("THREADS", config);
+}
+
+
+/**
+ * Applique au thread appelant le placement configuré pour un module
+ *
+ * @param id            Module (CORE pour le thread principal)
+ * @param nom           Nom du module
+ */
+void Core::placeThread(EnumModuleId id, string nom)
+{
+    ostringstream placement;
+    placement << "Thread '" << nom << "':";
+
+    if(threadNames) {
+        if(setCurrentThreadName("Emb-" + nom))
+            placement << " nom 'Emb-" << nom << "'";
+        else
+            log("Thread '" + nom + "': nommage impossible", WARNING);
+    }
+
+    if(threadAffinity[id] != 0) {
+        if(setCurrentThreadAffinity(threadAffinity[id]))
+            placement << " affinite 0x" << hex << threadAffinity[id] << dec;
+        else
+            log("Thread '" + nom + "': affinite refusee", WARNING);
+    }
+
+    if(threadPriority[id] != PRIORITE_NORMALE) {
+        if(setCurrentThreadPriority(threadPriority[id]))
+            placement << " priorite " << threadPriority[id];
+        else
+            log("Thread '" + nom + "': priorite refusee", WARNING);
+    }
+
+    log(placement.str());
+}
+
+
+/**
+ * Ordonnanceur SCHEDULER_COOPERATIVE: une étape de chaque module a tour
+ * de rôle, sur le thread courant. L'ordre suit le trajet d'une entrée:
+ * les events produits pendant l'affichage sont traités au tour suivant.
+ * Le rendu cadence la boucle (limitation du FPS).
+ */
+void Core::runCooperative()
+{
+    static const EnumModuleId ordre[] = {EVENTS, GAME, GUI, RENDERING};
+    static const int nbModules = sizeof(ordre) / sizeof(ordre[0]);
+
+    log("Ordonnancement cooperatif sur un seul thread");
+
+    for(int i=0; i<nbModules; i++) {
+        if(l_module[ordre[i]])
+            l_module[ordre[i]]->begin();
+    }
+
+    irr::u32 nbTours = 0;
+    while(getIsRunning()) {
+        for(int i=0; i<nbModules; i++) {
+            Module* module = l_module[ordre[i]];
+            if(module && !module->runStep()) {
+                stop();
+                break;
+            }
+        }
+
+        nbTours++;
+    }
+
+    for(int i=0; i<nbModules; i++) {
+        if(l_module[ordre[i]])
+            l_module[ordre[i]]->end();
+    }
+
+    ostringstream stats;
+    stats << "Tours de boucle: " << nbTours;
+    log(stats.str());
 }
 
 
@@ -104,6 +323,44 @@ void Core::registerModule(Module* module)
 }
 
 
+/**
+ * Abonne un module a un ou plusieurs groupes d'actions.
+ * Doit être appelé avant Core::main (lors de la construction des modules).
+ * Un module déja abonné a un groupe, ou un groupe complet, est ignoré.
+ *
+ * @param module        Module a abonner
+ * @param topicMask     Combinaison de TOPIC_MASK
+ */
+void Core::subscribe(Module* module, irr::u32 topicMask)
+{
+    for(int topic=0; topic<TOPIC_COUNT; topic++) {
+        if(!(topicMask & TOPIC_MASK(topic)))
+            continue;
+
+        bool abonne = false;
+        for(irr::u32 i=0; i<nbSubscribers[topic]; i++)
+            if(l_subscriber[topic][i] == module)
+                abonne = true;
+
+        ostringstream erreur;
+        if(abonne)
+            erreur << "'" << module->getName() << "' deja abonne au groupe "
+                   << topic;
+        else if(nbSubscribers[topic] >= MODULE_COUNT)
+            erreur << "Groupe " << topic << " complet: '"
+                   << module->getName() << "' non abonne";
+
+        if(!erreur.str().empty()) {
+            log(erreur.str(), WARNING);
+            continue;
+        }
+
+        l_subscriber[topic][nbSubscribers[topic]] = module;
+        nbSubscribers[topic]++;
+    }
+}
+
+
 /**
  * Envoit un message vers un module
  *
@@ -111,9 +368,102 @@ void Core::registerModule(Module* module)
  */
 void Core::sendMessage(module_message& msg)
 {
-    try {
-        l_module[msg.idDestination]->pushMessage(msg);
-    } catch(int e) {}
+    if(msg.idDestination < 0 || msg.idDestination >= MODULE_COUNT ||
+        !l_module[msg.idDestination])
+    {
+        log("Message envoye a un module inexistant", WARNING);
+        return;
+    }
+
+    if(!msg.sendTime)
+        msg.sendTime = TimeService::now();
+    recorder.recordMessage(msg);
+
+    deliver(l_module[msg.idDestination], msg);
+}
+
+
+/**
+ * Publie un message vers tout les modules abonnés au groupe de son action,
+ * excepté l'expediteur.
+ *
+ * @param msg       Message que l'on souhaite publier
+ */
+void Core::publish(module_message& msg)
+{
+    EnumTopic topic = msg.getTopic();
+
+    if(!msg.sendTime)
+        msg.sendTime = TimeService::now();
+    recorder.recordMessage(msg);
+
+    for(irr::u32 i=0; i<nbSubscribers[topic]; i++) {
+        Module* module = l_subscriber[topic][i];
+
+        if(module->getId() == msg.idExpediteur)
+            continue;
+
+        deliver(module, msg);
+    }
+}
+
+
+/**
+ * Envoit un message a tout les modules
+ *
+ * @param msg       Message que l'on souhaite diffuser
+ */
+void Core::broadcast(module_message& msg)
+{
+    if(!msg.sendTime)
+        msg.sendTime = TimeService::now();
+    recorder.recordMessage(msg);
+
+    for(int i=0; i<MODULE_COUNT; i++) {
+        if(l_module[i])
+            deliver(l_module[i], msg);
+    }
+}
+
+
+/**
+ * Ecrit les statistiques de traçage de tout les modules dans un fichier.
+ * Peut être appelé a tout moment (touche F12) et l'est a la fermeture.
+ *
+ * @param fichier   Chemin du fichier de destination (écrasé)
+ */
+void Core::dumpStatistics(string fichier)
+{
+    boost::mutex::scoped_lock l(mutexStatistics);
+
+    ofstream out(fichier.c_str(), ios::out | ios::trunc);
+    if(!out) {
+        log("Impossible d'ecrire les statistiques dans " + fichier, WARNING);
+        return;
+    }
+
+    out << "Duree: " << (TimeService::now() - debut) / 1000000 << " ms"
+        << endl << endl;
+
+    for(int i=0; i<MODULE_COUNT; i++) {
+        if(l_module[i])
+            l_module[i]->writeStatistics(out);
+    }
+
+    log("Statistiques ecrites dans " + fichier);
+}
+
+
+/**
+ * Dépose un message dans la file d'un module
+ *
+ * @param module    Module destinataire
+ * @param msg       Message a déposer
+ */
+void Core::deliver(Module* module, module_message& msg)
+{
+    msg.idDestination = module->getId();
+    module->pushMessage(msg);
 }
 
 
@@ -121,34 +471,30 @@ void Core::sendMessage(module_message& msg)
  * Indique si le programme tourne
  */
 bool Core::getIsRunning() {
-    boost::mutex::scoped_lock l(mutexRunning);
-    return isRunning;
+    return getGameState().isRunning();
 };
 
 
+/**
+ * Indique si le programme tourne sans fenêtre (section HEADLESS)
+ *
+ * @return      true en mode headless
+ */
+bool Core::isHeadless()
+{
+    return headless;
+}
+
+
 /**
  * Arrete le programme
  */
 void Core::stop() {
-    boost::mutex::scoped_lock l(mutexRunning);
-    isRunning = false;
-
-    map<EnumModuleId, Module*>::iterator iteratorModule;
+    changeGameState(GAME_STATE_RUNNING, 0);
 
     // Previent tout les modules que l'application doit finir
-    for(iteratorModule = l_module.begin();
-        iteratorModule != l_module.end();
-        iteratorModule++)
-    {
-        Module* module = iteratorModule->second;
-
-        module_message message = module_message(
-                CORE, module->getId(),
-                ACTION_QUITTER
-        );
-
-        module->pushMessage(message);
-    }
+    module_message message = module_message(CORE, CORE, ACTION_QUITTER);
+    broadcast(message);
 }
 
 
@@ -182,6 +528,78 @@ map<string, int> Core::loadConfig(string section)
 }
 
 
+/**
+ * Charge la section REPLAY et ouvre le journal de session en conséquence:
+ *  - mode: RECORDER_OFF, RECORDER_RECORD ou RECORDER_REPLAY
+ *  - messages: journalise aussi les messages entre modules (diagnostic)
+ */
+void Core::loadRecorderConfig()
+{
+    map<string, int> config = loadConfig("REPLAY");
+
+    if(config.find("mode") == config.end())     config["mode"] = RECORDER_OFF;
+    if(config.find("messages") == config.end()) config["messages"] = 0;
+    saveConfig("REPLAY", config);
+
+    recorder.setRecordMessages(config["messages"] != 0);
+
+    EnumRecorderMode mode = (EnumRecorderMode)config["mode"];
+    if(mode == RECORDER_OFF)
+        return;
+
+    if(!recorder.open(mode)) {
+        log("Impossible d'ouvrir le journal " RECORDER_FILE, ERROR);
+        return;
+    }
+
+    if(mode == RECORDER_RECORD)
+        log("Enregistrement de la session dans " RECORDER_FILE);
+    else
+        log("Relecture de la session depuis " RECORDER_FILE);
+}
+
+
+/**
+ * Charge la config du mode headless (section HEADLESS):
+ *  - enabled: simulation sans fenêtre, avec le driver nul d'Irrlicht
+ *  - level: niveau lancé au démarrage
+ *  - ticks: pas de simulation avant l'arrêt (0: pas de limite)
+ *  - fullSpeed: enchaine les pas sans attendre au lieu de suivre tickRate
+ *  - walk: le joueur avance pendant toute la partie
+ * Seul enabled est utilisé par le Core, le reste par GameEngine.
+ */
+void Core::loadHeadlessConfig()
+{
+    map<string, int> config = loadConfig("HEADLESS");
+
+    if(config.find("enabled") == config.end())      config["enabled"] = 0;
+    if(config.find("level") == config.end())        config["level"] = 0;
+    if(config.find("ticks") == config.end())        config["ticks"] = 0;
+    if(config.find("fullSpeed") == config.end())    config["fullSpeed"] = 0;
+    if(config.find("walk") == config.end())         config["walk"] = 0;
+    saveConfig("HEADLESS", config);
+
+    headless = config["enabled"] != 0;
+    if(headless)
+        log("Mode headless: simulation sans fenetre");
+}
+
+
+/**
+ * Charge l'échelle du temps de jeu (section TIME, clé scale en pourcents)
+ */
+void Core::loadTimeConfig()
+{
+    map<string, int> config = loadConfig("TIME");
+
+    if(config.find("scale") == config.end())    config["scale"] = TIME_SCALE_PERCENT;
+    if(config["scale"] < 0)                     config["scale"] = 0;
+    saveConfig("TIME", config);
+
+    timeService.setTimeScale(config["scale"] / 100.0f);
+}
+
+
 /**
  * Simplifie l'utilisation du Logger
  *
@@ -218,7 +636,67 @@ void Core::createGUIPage(irr::gui::IGUIEnvironment* guienv,
 }
 
 
+/**
+ * Applique une transition a l'état du jeu, sans verrou.
+ * Garantit que partieEnPause vaut false si partieEnCours vaut false.
+ * Si l'état change, les modules abonnés a TOPIC_GAME_STATE recoivent
+ * l'ancien et le nouveau mot d'état.
+ *
+ * @param masque        Bits a modifier
+ * @param valeur        Nouvelle valeur de ces bits
+ *
+ * @return              true si l'état a changé
+ */
+bool Core::changeGameState(irr::u32 masque, irr::u32 valeur)
+{
+    irr::u32 ancien, nouveau;
+
+    do {
+        ancien = atomicLoad(gameState);
+
+        nouveau = (ancien & ~masque) | (valeur & masque);
+        if(!(nouveau & GAME_STATE_PARTIE_EN_COURS))
+            nouveau &= ~GAME_STATE_PARTIE_EN_PAUSE;
+
+        if((nouveau & GAME_STATE_FLAGS_MASK) == (ancien & GAME_STATE_FLAGS_MASK))
+            return false;
+
+        // Nouvelle version de l'état
+        nouveau = (nouveau & GAME_STATE_FLAGS_MASK) |
+                ((ancien + (1 << GAME_STATE_VERSION_SHIFT)) &
+                ~GAME_STATE_FLAGS_MASK);
+    } while(!atomicCompareAndSwap(gameState, ancien, nouveau));
+
+    // L'horloge de jeu ne tourne que pendant une partie, hors pause.
+    // L'état est relu sous verrou: deux transitions concurrentes ne peuvent
+    // pas laisser l'horloge dans l'état de la plus ancienne.
+    if(GameState(nouveau).isPartieActive() != GameState(ancien).isPartieActive()) {
+        boost::mutex::scoped_lock l(mutexGameClock);
+        timeService.setPaused(!getGameState().isPartieActive());
+    }
+
+    // Previent les modules abonnés (RenderingEngine, GUIEngine)
+    module_message msg(CORE, CORE, ACTION_GAME_STATE_CHANGED);
+    msg.data.gameState.ancien = ancien;
+    msg.data.gameState.nouveau = nouveau;
+    publish(msg);
+
+    return true;
+}
+
+
 // Accesseur
+/**
+ * Donne un instantané de l'état du jeu (une seule lecture, sans verrou)
+ *
+ * @return      Etat du jeu
+ */
+GameState Core::getGameState()
+{
+    return GameState(atomicLoad(gameState));
+}
+
+
 /**
  * Indique si une partie est en cours
  *
@@ -226,8 +704,7 @@ void Core::createGUIPage(irr::gui::IGUIEnvironment* guienv,
  */
 bool Core::isPartieEnCours()
 {
-    boost::mutex::scoped_lock l(mutexPartieEnCours);
-    return partieEnCours;
+    return getGameState().isPartieEnCours();
 }
 
 
@@ -238,8 +715,7 @@ bool Core::isPartieEnCours()
  */
 bool Core::isPartieEnPause()
 {
-    boost::mutex::scoped_lock l(mutexPartieEnPause);
-    return partieEnPause;
+    return getGameState().isPartieEnPause();
 }
 
 
@@ -265,6 +741,63 @@ Player* Core::getPlayer()
 }
 
 
+/**
+ * Donne acces au dernier état du monde publié par la simulation.
+ * GameEngine en est le seul écrivain, RenderingEngine le seul lecteur.
+ *
+ * @return      Pointeur sur le TripleBuffer du WorldSnapshot
+ */
+TripleBuffer<WorldSnapshot>* Core::getWorldSnapshot()
+{
+    return &worldSnapshot;
+}
+
+
+/**
+ * Donne le dernier WorldSnapshot::inputTick lu par RenderingEngine: les
+ * entrées publiées jusqu'a ce pas sont mesurées
+ *
+ * @return      Pas acquitté (0: aucun)
+ */
+irr::u32 Core::getInputAck()
+{
+    return atomicLoad(inputAck);
+}
+
+
+/**
+ * Donne acces aux horloges du programme
+ *
+ * @return      Pointeur sur le TimeService
+ */
+TimeService* Core::getTimeService()
+{
+    return &timeService;
+}
+
+
+/**
+ * Donne acces a l'enregistreur de session
+ *
+ * @return      Pointeur sur l'enregistreur
+ */
+MessageRecorder* Core::getRecorder()
+{
+    return &recorder;
+}
+
+
+/**
+ * Donne acces au JobSystem, pour y soumettre des jobs
+ *
+ * @return      Pointeur sur le JobSystem
+ */
+JobSystem* Core::getJobSystem()
+{
+    return jobSystem;
+}
+
+
 /**
  * Donne le menu affiché actuellement
  *
@@ -272,8 +805,7 @@ Player* Core::getPlayer()
  */
 EnumGameState Core::getMenuState()
 {
-    boost::mutex::scoped_lock l(mutexMenuState);
-    return menuState;
+    return getGameState().getMenuState();
 }
 
 
@@ -290,40 +822,39 @@ map<EnumGameState, GUIPage*>* Core::getGUIPages()
 // Mutateur
 /**
  * Definit si une partie a lieu ou non
- * Garantit que partieEnPause vaut false si on partieEnCours vaut false
+ * Lancer ou quitter une partie enléve la pause
  */
 void Core::setPartieEnCours(bool partieEnCours)
 {
-    // Si on quitte la partie
-    if(partieEnCours)
-        setPartieEnPause(false);
-
-    boost::mutex::scoped_lock l(mutexPartieEnCours);
-    this->partieEnCours = partieEnCours;
+    changeGameState(
+            GAME_STATE_PARTIE_EN_COURS | GAME_STATE_PARTIE_EN_PAUSE,
+            partieEnCours ? GAME_STATE_PARTIE_EN_COURS : 0
+    );
 }
 
 
 /**
  * Definit si une partie est en pause
- * Garantit que partieEnPause vaut false si on partieEnCours vaut false
+ * Sans partie en cours, la pause reste a false
  */
 void Core::setPartieEnPause(bool partieEnPause)
 {
-    boost::mutex::scoped_lock l(mutexPartieEnPause);
-    // Si aucune partie en cours, ne peut valoir que false
-    if(!isPartieEnCours())
-        this->partieEnPause = false;
-    else {
-        this->partieEnPause = partieEnPause;
-        l.unlock();
+    changeGameState(
+            GAME_STATE_PARTIE_EN_PAUSE,
+            partieEnPause ? GAME_STATE_PARTIE_EN_PAUSE : 0
+    );
+}
 
-        // Previent le RenderingEngine
-        module_message msg(CORE, RENDERING, ACTION_UNPAUSE);
-        if(partieEnPause)
-            msg.codeAction = ACTION_PAUSE;
 
-        sendMessage(msg);
-    }
+/**
+ * Acquitte les entrées d'un WorldSnapshot (voir InputLatencyProbe).
+ * Appelé par RenderingEngine.
+ *
+ * @param inputTick     WorldSnapshot::inputTick lu
+ */
+void Core::setInputAck(irr::u32 inputTick)
+{
+    atomicStore(inputAck, inputTick);
 }
 
 
@@ -332,11 +863,6 @@ void Core::setPartieEnPause(bool partieEnPause)
  */
 void Core::setMenuState(EnumGameState menuState)
 {
-    boost::mutex::scoped_lock l(mutexMenuState);
-    this->menuState = menuState;
-
-    module_message msg = module_message(CORE, RENDERING, ACTION_AFFICHER_MENU);
-    msg.intData["menu"] = menuState;
-    sendMessage(msg);
+    changeGameState(GAME_STATE_MENU_MASK, GameState::menuBits(menuState));
 }
 
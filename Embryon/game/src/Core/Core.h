@@ -10,14 +10,31 @@
 #include <irrlicht.h>
 
 #include "ConfigLoader.h"
+#include "GameState.h"
+#include "MessageRecorder.h"
+#include "JobSystem.h"
+#include "ThreadPlacement.h"
+#include "TimeService.h"
+#include "TripleBuffer.h"
+#include "WorldSnapshot.h"
 #include "../common.h"
 #include "../Logger.h"
 #include "../module_message.h"
 #include "../Player.h"
 #include "../Level.h"
 
+#define STATISTICS_FILE "Statistiques.log"
+
 using namespace std;
 
+/** \enum   EnumScheduler
+ *  \brief  Exécution des modules (clé scheduler de la section CORE)
+ */
+enum EnumScheduler {
+    SCHEDULER_THREADS = 0,      // Un thread par module
+    SCHEDULER_COOPERATIVE       // Tout les modules a tour de rôle sur un thread
+};
+
 class GUIPage;
 class Module;
 
@@ -38,12 +55,19 @@ class Core
         void main();
         void registerModule(Module* module);
 
+        void subscribe(Module* module, irr::u32 topicMask);
+
         void sendMessage(module_message& msg);
+        void publish(module_message& msg);
+        void broadcast(module_message& msg);
+
+        void dumpStatistics(string fichier);
 
         // Simplifie l'acces au logger
         void log(string message, EnumLogLevel level=SIMPLE);
 
         bool getIsRunning();
+        bool isHeadless();
         void stop();
 
         void saveConfig(string section, map<string, int>& config);
@@ -51,11 +75,17 @@ class Core
         void createGUIPage(irr::gui::IGUIEnvironment* mGuienv,
                 map<int, irr::gui::IGUIElement*>* l_guiElement);
 
-        // Accesseurs
+        // Accesseurs (sans verrou, voir GameState)
+        GameState getGameState();
         bool isPartieEnCours();
         bool isPartieEnPause();
         Level* getLevel();
         Player* getPlayer();
+        TripleBuffer<WorldSnapshot>* getWorldSnapshot();
+        irr::u32 getInputAck();
+        MessageRecorder* getRecorder();
+        JobSystem* getJobSystem();
+        TimeService* getTimeService();
         EnumGameState getMenuState();
         map<EnumGameState, GUIPage*>* getGUIPages();
 
@@ -63,33 +93,68 @@ class Core
         void setPartieEnCours(bool partieEnCours);
         void setPartieEnPause(bool partieEnPause);
         void setMenuState(EnumGameState menuState);
+        void setInputAck(irr::u32 inputTick);
     protected:
     private:
-        map<EnumModuleId, Module*>  l_module;
+        // Modules indexés par leur identifiant
+        Module* l_module[MODULE_COUNT];
+
+        // Abonnés de chaque groupe d'actions
+        Module* l_subscriber[TOPIC_COUNT][MODULE_COUNT];
+        irr::u32 nbSubscribers[TOPIC_COUNT];
+
         Logger logger;
 
         boost::mutex mutexConfig;
         ConfigLoader configLoader;
 
-        // L'application tourne
-        boost::mutex mutexRunning;
-        bool isRunning;
+        // Enregistrement / relecture de la session
+        MessageRecorder recorder;
+        void loadRecorderConfig();
+
+        // Simulation sans fenêtre (section HEADLESS)
+        bool headless;
+        void loadHeadlessConfig();
+
+        void deliver(Module* module, module_message& msg);
+
+        // Ordonnancement des modules
+        EnumScheduler scheduler;
+        JobSystem* jobSystem;
+        void runThreads();
+        void runCooperative();
+
+        // Placement des threads par module (section THREADS), CORE
+        // désignant le thread principal
+        irr::u32 threadAffinity[MODULE_COUNT];
+        EnumThreadPriority threadPriority[MODULE_COUNT];
+        bool threadNames;
+        boost::uint64_t cpuTime;
+        void loadThreadConfig();
+        void placeThread(EnumModuleId id, string nom);
+        void runModuleThread(Module* module);
+
+        // Ecriture du fichier de statistiques
+        boost::mutex mutexStatistics;
+        boost::uint64_t debut;
+
+        // Horloges, l'horloge de jeu suit la pause
+        TimeService timeService;
+        boost::mutex mutexGameClock;
+        void loadTimeConfig();
 
         Player player;
         Level level;
-        map<EnumGameState, GUIPage*> l_GUIPage;
 
-        // Si une partie est en cours
-        boost::mutex mutexPartieEnCours;
-        bool partieEnCours;
-
-        // Si la pause est activée
-        boost::mutex mutexPartieEnPause;
-        bool partieEnPause;
+        // Etat du monde publié par GameEngine, lu par RenderingEngine
+        TripleBuffer<WorldSnapshot> worldSnapshot;
+        volatile irr::u32 inputAck;     // Dernier inputTick lu par le rendu
+        map<EnumGameState, GUIPage*> l_GUIPage;
 
-        // Menu ou l'on se trouve
-        boost::mutex mutexMenuState;
-        EnumGameState menuState;
+        // Etat du jeu: application lancée, partie en cours, pause et menu
+        // affiché (voir GameState)
+        volatile irr::u32 gameState;
+        bool changeGameState(irr::u32 masque, irr::u32 valeur);
 };
 
 #endif // CORE_H
@@ -0,0 +1,231 @@
+/** \file   FramePacer.cpp
+ *  \brief  Implémente la classe FramePacer
+ */
+#include "FramePacer.h"
+
+#include <cmath>
+#include <sstream>
+#include <boost/thread/thread.hpp>
+
+#include "TimeService.h"
+
+
+/**
+ * Constructeur de FramePacer. Sans durée cible, les images ne sont pas
+ * limitées mais restent mesurées.
+ */
+FramePacer::FramePacer()
+{
+    targetFrameTime = 0;
+    spinMargin = FRAME_PACER_SPIN * 1000ULL;
+    vsync = false;
+
+    deadline = 0;
+    lastFrame = 0;
+    oversleep = 0;
+
+    count = 0;
+    mean = 0;
+    m2 = 0;
+}
+
+/**
+ * Destructeur de FramePacer
+ */
+FramePacer::~FramePacer()
+{
+}
+
+
+/**
+ * Modifie la durée cible d'une image
+ *
+ * @param targetFrameTime   Durée en ns, 0 pour ne pas limiter
+ */
+void FramePacer::setTargetFrameTime(boost::uint64_t targetFrameTime)
+{
+    this->targetFrameTime = targetFrameTime;
+}
+
+
+/**
+ * Modifie la marge d'attente active avant l'échéance
+ *
+ * @param spinMargin        Marge en ns
+ */
+void FramePacer::setSpinMargin(boost::uint64_t spinMargin)
+{
+    this->spinMargin = spinMargin;
+}
+
+
+/**
+ * Indique si la présentation des images est synchronisée avec l'écran
+ *
+ * @param vsync             true si la synchronisation verticale est active
+ */
+void FramePacer::setVsync(bool vsync)
+{
+    this->vsync = vsync;
+}
+
+
+/**
+ * Commence le cadencement a partir de maintenant
+ */
+void FramePacer::start()
+{
+    lastFrame = TimeService::now();
+    deadline = lastFrame;
+}
+
+
+/**
+ * Attend l'échéance de l'image en cours et passe a la suivante.
+ * A appeler une fois par image, aprés sa présentation.
+ *
+ * @return          Durée de l'image qui se termine (ns)
+ */
+boost::uint64_t FramePacer::waitNextFrame()
+{
+    boost::uint64_t maintenant;
+    boost::uint64_t frameTime;
+
+    if(targetFrameTime) {
+        deadline += targetFrameTime;
+        maintenant = TimeService::now();
+
+        if(maintenant > deadline + targetFrameTime) {
+            // Trop en retard pour rattraper
+            deadline = maintenant;
+        } else if(maintenant < deadline) {
+            sleepUntil(deadline);
+
+            if(!vsync) {
+                while(TimeService::now() < deadline)
+                    boost::this_thread::yield();
+            }
+        }
+    }
+
+    maintenant = TimeService::now();
+    frameTime = maintenant - lastFrame;
+    lastFrame = maintenant;
+
+    addFrameTime(frameTime);
+
+    return frameTime;
+}
+
+
+/**
+ * Dort jusqu'a la marge d'attente active avant une échéance, en anticipant
+ * le retard de réveil habituel
+ *
+ * @param echeance      Temps (TimeService::now) a ne pas dépasser
+ */
+void FramePacer::sleepUntil(boost::uint64_t echeance)
+{
+    boost::uint64_t debut = TimeService::now();
+    boost::uint64_t marge = spinMargin + oversleep;
+
+    if(debut + marge >= echeance)
+        return;
+
+    boost::uint64_t demande = echeance - marge - debut;
+
+    boost::this_thread::sleep(
+            boost::posix_time::microseconds(demande / 1000)
+    );
+
+    // Moyenne glissante du retard de réveil
+    boost::uint64_t dormi = TimeService::now() - debut;
+    boost::uint64_t retard = dormi > demande ? dormi - demande : 0;
+
+    oversleep += (retard >> FRAME_PACER_OVERSLEEP)
+            - (oversleep >> FRAME_PACER_OVERSLEEP);
+}
+
+
+/**
+ * Ajoute la durée d'une image aux statistiques
+ *
+ * @param frameTime     Durée de l'image (ns)
+ */
+void FramePacer::addFrameTime(boost::uint64_t frameTime)
+{
+    double x = (double)frameTime;
+    double delta = x - mean;
+
+    count++;
+    mean += delta / count;
+    m2 += delta * (x - mean);
+
+    histogram.add((irr::u32)(frameTime / 1000));
+}
+
+
+/**
+ * Donne le nombre d'images cadencées
+ */
+irr::u32 FramePacer::getFrameCount() const
+{
+    return count;
+}
+
+
+/**
+ * Donne la durée moyenne d'une image (ns)
+ */
+boost::uint64_t FramePacer::getMeanFrameTime() const
+{
+    return (boost::uint64_t)mean;
+}
+
+
+/**
+ * Donne la variance de la durée des images (ns²)
+ */
+double FramePacer::getFrameTimeVariance() const
+{
+    if(count < 2)
+        return 0;
+
+    return m2 / (count - 1);
+}
+
+
+/**
+ * Donne le retard de réveil moyen du sommeil (ns)
+ */
+boost::uint64_t FramePacer::getOversleep() const
+{
+    return oversleep;
+}
+
+
+/**
+ * Donne la répartition des durées d'images (us)
+ */
+const LatencyHistogram& FramePacer::getHistogram() const
+{
+    return histogram;
+}
+
+
+/**
+ * Résumé des statistiques
+ */
+string FramePacer::toString() const
+{
+    ostringstream resume;
+
+    resume  << count << " images, cible " << (targetFrameTime / 1000)
+            << "us, moyenne " << (getMeanFrameTime() / 1000)
+            << "us, ecart-type " << (boost::uint64_t)(sqrt(getFrameTimeVariance()) / 1000)
+            << "us, p99 " << histogram.getPercentile(0.99f)
+            << "us, max " << histogram.getMax()
+            << "us, retard de reveil " << (oversleep / 1000) << "us";
+
+    return resume.str();
+}
@@ -0,0 +1,78 @@
+/** \file   FramePacer.h
+ *  \brief  Définit la classe FramePacer
+ */
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#include <string>
+#include <boost/cstdint.hpp>
+#include <irrlicht.h>
+
+#include "LatencyHistogram.h"
+
+#define FRAME_PACER_SPIN        2000    // Marge d'attente active (us, défaut)
+#define FRAME_PACER_OVERSLEEP   3       // Lissage du retard de réveil (1/2^n)
+
+using namespace std;
+
+
+/** \class  FramePacer
+ *  \brief  Cadence les images sur une durée cible.
+ *
+ * L'attente se fait en deux temps: un sommeil grossier qui s'arrête avant
+ * l'échéance, puis une attente active jusqu'a l'échéance. Le sommeil est
+ * raccourci du retard de réveil moyen observé, et les échéances sont
+ * absolues: une image en retard raccourcit la suivante au lieu de décaler
+ * toutes les autres. Au dela d'une image de retard, le cadencement repart
+ * de maintenant plutôt que d'enchaîner des images sans attendre.
+ *
+ * Avec la synchronisation verticale, la présentation de l'image bloque
+ * déja jusqu'au rafraichissement de l'écran: seul le sommeil est conservé,
+ * l'attente active ne ferait que consommer du CPU.
+ *
+ * Une instance ne doit être utilisée que par un seul thread.
+ */
+class FramePacer
+{
+    public:
+        FramePacer();
+        virtual ~FramePacer();
+
+        void setTargetFrameTime(boost::uint64_t targetFrameTime);
+        void setSpinMargin(boost::uint64_t spinMargin);
+        void setVsync(bool vsync);
+
+        void start();
+        boost::uint64_t waitNextFrame();
+
+        // Statistiques (ns)
+        irr::u32 getFrameCount() const;
+        boost::uint64_t getMeanFrameTime() const;
+        double getFrameTimeVariance() const;
+        boost::uint64_t getOversleep() const;
+        const LatencyHistogram& getHistogram() const;
+        string toString() const;
+    protected:
+    private:
+        boost::uint64_t targetFrameTime;
+        boost::uint64_t spinMargin;
+        bool vsync;
+
+        // Echéance de l'image en cours et fin de la précédente
+        boost::uint64_t deadline;
+        boost::uint64_t lastFrame;
+
+        // Retard de réveil moyen du sommeil
+        boost::uint64_t oversleep;
+
+        // Durées des images (Welford)
+        irr::u32 count;
+        double mean;
+        double m2;
+        LatencyHistogram histogram;
+
+        void sleepUntil(boost::uint64_t echeance);
+        void addFrameTime(boost::uint64_t frameTime);
+};
+
+#endif // FRAMEPACER_H
@@ -0,0 +1,67 @@
+/** \file   GameState.h
+ *  \brief  Définit la classe GameState
+ */
+#ifndef GAMESTATE_H
+#define GAMESTATE_H
+
+#include <irrlicht.h>
+
+#include "../common.h"
+
+// Disposition du mot d'état
+#define GAME_STATE_RUNNING          0x00000001  // L'application tourne
+#define GAME_STATE_PARTIE_EN_COURS  0x00000002  // Une partie a lieu
+#define GAME_STATE_PARTIE_EN_PAUSE  0x00000004  // La partie est en pause
+#define GAME_STATE_MENU_SHIFT       8
+#define GAME_STATE_MENU_MASK        0x0000ff00  // Menu affiché
+#define GAME_STATE_FLAGS_MASK       0x0000ffff  // Tout sauf la version
+#define GAME_STATE_VERSION_SHIFT    16          // Compteur de transitions
+
+
+/** \class  GameState
+ *  \brief  Instantané de l'état du jeu, tenant sur un seul mot.
+ *
+ * Le Core conserve l'état du jeu dans un mot de 32 bits modifié par
+ * compare-and-swap: un instantané s'obtient en une seule lecture, sans
+ * verrou. Les 16 bits de poids fort comptent les transitions, ce qui permet
+ * aux modules d'ignorer une notification plus ancienne que leur copie.
+ */
+class GameState
+{
+    public:
+        GameState(irr::u32 value=0) : value(value) {}
+
+        // Accesseurs
+        bool isRunning() const
+            { return (value & GAME_STATE_RUNNING) != 0; }
+        bool isPartieEnCours() const
+            { return (value & GAME_STATE_PARTIE_EN_COURS) != 0; }
+        bool isPartieEnPause() const
+            { return (value & GAME_STATE_PARTIE_EN_PAUSE) != 0; }
+        EnumGameState getMenuState() const
+            { return (EnumGameState)
+                ((value & GAME_STATE_MENU_MASK) >> GAME_STATE_MENU_SHIFT); }
+        irr::u16 getVersion() const
+            { return (irr::u16)(value >> GAME_STATE_VERSION_SHIFT); }
+        irr::u32 getValue() const
+            { return value; }
+
+        // La partie avance (en cours et pas en pause)
+        bool isPartieActive() const
+            { return isPartieEnCours() && !isPartieEnPause(); }
+
+        /**
+         * Indique si cet état est postérieur a un autre
+         * (tient compte du rebouclage du compteur)
+         */
+        bool isNewerThan(const GameState& other) const
+            { return (irr::s16)(getVersion() - other.getVersion()) > 0; }
+
+        static irr::u32 menuBits(EnumGameState menu)
+            { return ((irr::u32)menu << GAME_STATE_MENU_SHIFT)
+                & GAME_STATE_MENU_MASK; }
+    private:
+        irr::u32 value;
+};
+
+#endif // GAMESTATE_H
@@ -0,0 +1,139 @@
+/** \file   InputLatencyProbe.cpp
+ *  \brief  Implémente la classe InputLatencyProbe
+ */
+#include "InputLatencyProbe.h"
+
+#include <sstream>
+
+
+/**
+ * Constructeur de InputLatencyProbe: aucune mesure, pas de CSV
+ */
+InputLatencyProbe::InputLatencyProbe()
+{
+    count = 0;
+    max = 0;
+    for(int i=0; i<LATENCY_PROBE_SIZE; i++)
+        buckets[i] = 0;
+}
+
+/**
+ * Destructeur de InputLatencyProbe
+ */
+InputLatencyProbe::~InputLatencyProbe()
+{
+    close();
+}
+
+
+/**
+ * Ouvre le CSV des mesures (remplace le précédent)
+ *
+ * @param fichier       Chemin du CSV
+ *
+ * @return              false si le fichier ne peut pas être créé
+ */
+bool InputLatencyProbe::open(const string& fichier)
+{
+    close();
+
+    csv.open(fichier.c_str(), ios::out | ios::trunc);
+    if(!csv)
+        return false;
+
+    csv << "capture_ns,affichage_ns,pas,latence_ms" << endl;
+    return true;
+}
+
+
+/**
+ * Ferme le CSV des mesures
+ */
+void InputLatencyProbe::close()
+{
+    if(csv.is_open())
+        csv.close();
+}
+
+
+/**
+ * Ajoute une mesure
+ *
+ * @param capture       Réception de l'entrée (TimeService::now)
+ * @param affichage     Fin de l'image qui en montre l'effet
+ * @param tick          Pas de simulation qui a appliqué l'entrée
+ */
+void InputLatencyProbe::add(boost::uint64_t capture, boost::uint64_t affichage,
+        irr::u32 tick)
+{
+    boost::uint64_t latence = affichage > capture ? affichage - capture : 0;
+    irr::u32 us = (irr::u32)(latence / 1000);
+
+    irr::u32 index = us / LATENCY_PROBE_BUCKET;
+    if(index >= LATENCY_PROBE_SIZE)
+        index = LATENCY_PROBE_SIZE - 1;
+
+    buckets[index]++;
+    count++;
+    if(us > max)
+        max = us;
+
+    if(csv.is_open())
+        csv << capture << "," << affichage << "," << tick << ","
+            << (latence / 1000000.0) << "\n";
+}
+
+
+/**
+ * Donne le nombre de mesures
+ */
+irr::u32 InputLatencyProbe::getCount() const
+{
+    return count;
+}
+
+
+/**
+ * Donne un percentile des latences, a 0.1ms prés (borne haute de sa
+ * tranche, au plus la latence maximale)
+ *
+ * @param percentile    Entre 0 et 1
+ *
+ * @return              Latence en ms (0 sans mesure)
+ */
+irr::f32 InputLatencyProbe::getPercentile(irr::f32 percentile) const
+{
+    if(count == 0)
+        return 0;
+
+    irr::u32 rang = (irr::u32)(percentile * (count - 1) + 0.5f);
+    irr::u32 cumul = 0;
+
+    for(int i=0; i<LATENCY_PROBE_SIZE - 1; i++) {
+        cumul += buckets[i];
+
+        if(cumul > rang) {
+            irr::u32 borne = (i + 1) * LATENCY_PROBE_BUCKET;
+            return ((borne < max) ? borne : max) / 1000.0f;
+        }
+    }
+
+    return max / 1000.0f;
+}
+
+
+/**
+ * Résumé des mesures
+ */
+string InputLatencyProbe::toString() const
+{
+    ostringstream resume;
+
+    resume.setf(ios::fixed);
+    resume.precision(1);
+    resume  << getCount() << " entrees, p50 " << getPercentile(0.50f)
+            << "ms, p95 " << getPercentile(0.95f)
+            << "ms, p99 " << getPercentile(0.99f) << "ms";
+
+    return resume.str();
+}
@@ -0,0 +1,57 @@
+/** \file   InputLatencyProbe.h
+ *  \brief  Définit la classe InputLatencyProbe
+ */
+#ifndef INPUTLATENCYPROBE_H
+#define INPUTLATENCYPROBE_H
+
+#include <fstream>
+#include <string>
+#include <boost/cstdint.hpp>
+#include <irrlicht.h>
+
+#define LATENCY_CSV_FILE        "latency.csv"
+#define LATENCY_PROBE_BUCKET    100     // Largeur d'une tranche (us)
+#define LATENCY_PROBE_SIZE      2000    // Tranches: 0 a 200ms, puis au dela
+
+using namespace std;
+
+
+/** \class  InputLatencyProbe
+ *  \brief  Mesure la latence entre la capture d'une entrée et la premiére
+ *          image qui en montre l'effet.
+ *
+ * Chaque déplacement est daté par EventsEngine a sa réception, appliqué
+ * par GameEngine au pas correspondant puis transmis au rendu par le
+ * WorldSnapshot (inputTick, inputTime). RenderingEngine ajoute une mesure
+ * aprés le premier endScene qui affiche ce pas.
+ *
+ * Les mesures sont rangées dans des tranches de 0.1ms: la mémoire ne
+ * dépend pas de la durée de la session, et les percentiles sont lus sans
+ * copie ni tri. Chaque mesure est aussi écrite au fil de l'eau dans un CSV.
+ * Une instance ne doit être utilisée que par un seul thread.
+ */
+class InputLatencyProbe
+{
+    public:
+        InputLatencyProbe();
+        virtual ~InputLatencyProbe();
+
+        bool open(const string& fichier);
+        void close();
+
+        void add(boost::uint64_t capture, boost::uint64_t affichage,
+                irr::u32 tick);
+
+        // Accesseurs
+        irr::u32 getCount() const;
+        irr::f32 getPercentile(irr::f32 percentile) const;
+        string toString() const;
+    protected:
+    private:
+        irr::u32 count;
+        irr::u32 max;                   // us
+        irr::u32 buckets[LATENCY_PROBE_SIZE];
+        ofstream csv;
+};
+
+#endif // INPUTLATENCYPROBE_H
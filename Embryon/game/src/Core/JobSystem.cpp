@@ -0,0 +1,439 @@
+/** \file   JobSystem.cpp
+ *  \brief  Implémente les classes JobSystem et JobQueue
+ */
+#include "JobSystem.h"
+
+#include <sstream>
+#include <boost/bind.hpp>
+
+#include "../common.h"
+
+#define JOB_SPIN_COUNT      64      // Tentatives avant de s'endormir
+
+
+/**
+ * Constructeur d'une file de jobs vide
+ */
+JobQueue::JobQueue()
+{
+    top = 0;
+    bottom = 0;
+    verrou = 0;
+}
+
+
+/**
+ * Ajoute un job en bas de la file
+ *
+ * @param job           Job a ajouter
+ *
+ * @return              false si la file est pleine
+ */
+bool JobQueue::push(const Job& job)
+{
+    lock();
+
+    if(bottom - top >= JOB_QUEUE_SIZE) {
+        unlock();
+        return false;
+    }
+
+    jobs[bottom & (JOB_QUEUE_SIZE - 1)] = job;
+    bottom++;
+
+    unlock();
+    return true;
+}
+
+
+/**
+ * Retire le job le plus récent (propriétaire de la file)
+ *
+ * @param job           Job retiré
+ *
+ * @return              false si la file est vide
+ */
+bool JobQueue::pop(Job& job)
+{
+    lock();
+
+    if(bottom == top) {
+        unlock();
+        return false;
+    }
+
+    bottom--;
+    job = jobs[bottom & (JOB_QUEUE_SIZE - 1)];
+
+    unlock();
+    return true;
+}
+
+
+/**
+ * Retire le job le plus ancien (vol par un autre thread)
+ *
+ * @param job           Job retiré
+ *
+ * @return              false si la file est vide
+ */
+bool JobQueue::steal(Job& job)
+{
+    lock();
+
+    if(bottom == top) {
+        unlock();
+        return false;
+    }
+
+    job = jobs[top & (JOB_QUEUE_SIZE - 1)];
+    top++;
+
+    unlock();
+    return true;
+}
+
+
+/**
+ * Prend le verrou de la file
+ */
+void JobQueue::lock()
+{
+    while(!atomicCompareAndSwap(verrou, 0, 1)) {
+        while(atomicLoad(verrou))
+            ;
+    }
+}
+
+
+/**
+ * Rend le verrou de la file
+ */
+void JobQueue::unlock()
+{
+    atomicStore(verrou, 0);
+}
+
+
+
+/**
+ * Constructeur du JobSystem. Lance les workers.
+ *
+ * @param nbWorkers     Nombre de threads workers. Avec 0, les jobs sont
+ *                      exécutés par les threads qui les attendent.
+ */
+JobSystem::JobSystem(irr::u32 nbWorkers)
+{
+    if(nbWorkers > JOB_MAX_WORKERS)
+        nbWorkers = JOB_MAX_WORKERS;
+
+    this->nbWorkers = nbWorkers;
+
+    nbPending = 0;
+    nbSleeping = 0;
+    quit = 0;
+
+    for(irr::u32 i=0; i<=JOB_MAX_WORKERS; i++) {
+        nbExecuted[i] = 0;
+        nbStolen[i] = 0;
+    }
+
+    l_queue = new JobQueue[nbWorkers + 1];
+
+    for(irr::u32 i=0; i<nbWorkers; i++) {
+        l_worker.push_back(new boost::thread(
+                boost::bind(&JobSystem::workerMain, this, i)
+        ));
+    }
+}
+
+/**
+ * Destructeur du JobSystem. Attend la fin des workers: les jobs encore
+ * en attente ne sont pas exécutés.
+ */
+JobSystem::~JobSystem()
+{
+    atomicStore(quit, 1);
+
+    boost::mutex::scoped_lock l(mutexSleep);
+    condSleep.notify_all();
+    l.unlock();
+
+    for(irr::u32 i=0; i<l_worker.size(); i++) {
+        l_worker[i]->join();
+        delete l_worker[i];
+    }
+
+    delete[] l_queue;
+}
+
+
+/**
+ * Soumet un job. Peut être appelé depuis n'importe quel thread.
+ *
+ * @param function      Fonction a exécuter
+ * @param data          Paramétre de la fonction
+ * @param counter       Compteur décrémenté a la fin du job. Doit avoir
+ *                      été incrémenté par l'appelant.
+ */
+void JobSystem::submit(JobFunction function, void* data,
+        volatile irr::u32* counter)
+{
+    Job job;
+    job.function = function;
+    job.data = data;
+    job.counter = counter;
+
+    irr::u32 index = getQueueIndex();
+
+    // File pleine ou aucun worker: exécution immédiate
+    atomicAdd(nbPending, 1);
+    if(nbWorkers == 0 || !l_queue[index].push(job)) {
+        atomicAdd(nbPending, (irr::u32)-1);
+        execute(index, job);
+        return;
+    }
+
+    // Réveille un worker endormi
+    atomicFence();
+    if(atomicLoad(nbSleeping)) {
+        boost::mutex::scoped_lock l(mutexSleep);
+        condSleep.notify_one();
+    }
+}
+
+
+/**
+ * Attend qu'un compteur revienne a 0 en exécutant des jobs
+ *
+ * @param counter       Compteur partagé par les jobs attendus
+ */
+void JobSystem::waitFor(volatile irr::u32* counter)
+{
+    irr::u32 index = getQueueIndex();
+    Job job;
+
+    while(atomicLoad(*counter)) {
+        if(getJob(index, job))
+            execute(index, job);
+        else
+            boost::this_thread::yield();
+    }
+}
+
+
+/**
+ * Paramétres d'une tranche de parallelFor
+ */
+struct ParallelForRange {
+    ParallelForFunction function;
+    void* data;
+    irr::u32 begin;
+    irr::u32 end;
+};
+
+/**
+ * Exécute une tranche de parallelFor
+ *
+ * @param data          ParallelForRange a traiter
+ */
+static void parallelForJob(void* data)
+{
+    ParallelForRange* range = (ParallelForRange*)data;
+    range->function(range->data, range->begin, range->end);
+}
+
+
+/**
+ * Découpe [0, count[ en tranches de grain éléments, les traite en
+ * parallèle et attend la fin de toutes les tranches
+ *
+ * @param count         Nombre d'éléments
+ * @param grain         Nombre d'éléments par job
+ * @param function      Fonction appelée sur chaque tranche
+ * @param data          Paramétre de la fonction
+ */
+void JobSystem::parallelFor(irr::u32 count, irr::u32 grain,
+        ParallelForFunction function, void* data)
+{
+    if(grain == 0)
+        grain = 1;
+
+    if(count <= grain || nbWorkers == 0) {
+        if(count > 0)
+            function(data, 0, count);
+        return;
+    }
+
+    irr::u32 nbRanges = (count + grain - 1) / grain;
+    vector<ParallelForRange> l_range(nbRanges);
+    volatile irr::u32 counter = nbRanges;
+
+    for(irr::u32 i=0; i<nbRanges; i++) {
+        l_range[i].function = function;
+        l_range[i].data = data;
+        l_range[i].begin = i * grain;
+        l_range[i].end = (i + 1) * grain;
+        if(l_range[i].end > count)
+            l_range[i].end = count;
+    }
+
+    // La premiére tranche est gardée pour le thread appelant
+    for(irr::u32 i=1; i<nbRanges; i++)
+        submit(&parallelForJob, &l_range[i], &counter);
+
+    parallelForJob(&l_range[0]);
+    atomicAdd(counter, (irr::u32)-1);
+
+    waitFor(&counter);
+}
+
+
+/**
+ * Boucle d'un worker
+ *
+ * @param index         Index du worker (et de sa file)
+ */
+void JobSystem::workerMain(irr::u32 index)
+{
+    workerIndex.reset(new irr::u32(index));
+
+    Job job;
+    irr::u32 echecs = 0;
+
+    while(!atomicLoad(quit)) {
+        if(getJob(index, job)) {
+            execute(index, job);
+            echecs = 0;
+            continue;
+        }
+
+        if(++echecs < JOB_SPIN_COUNT) {
+            boost::this_thread::yield();
+            continue;
+        }
+
+        sleep();
+        echecs = 0;
+    }
+}
+
+
+/**
+ * Endort le worker courant jusqu'a la soumission d'un job
+ */
+void JobSystem::sleep()
+{
+    boost::mutex::scoped_lock l(mutexSleep);
+
+    atomicAdd(nbSleeping, 1);
+    atomicFence();
+
+    while(!atomicLoad(nbPending) && !atomicLoad(quit))
+        condSleep.wait(l);
+
+    atomicAdd(nbSleeping, (irr::u32)-1);
+}
+
+
+/**
+ * Donne la file du thread courant: la sienne pour un worker, la file
+ * commune pour les autres threads
+ *
+ * @return              Index de la file
+ */
+irr::u32 JobSystem::getQueueIndex()
+{
+    irr::u32* index = workerIndex.get();
+    if(index)
+        return *index;
+
+    return nbWorkers;
+}
+
+
+/**
+ * Cherche un job: dans sa file, puis dans la file commune, puis chez
+ * les autres workers
+ *
+ * @param index         File du thread courant
+ * @param job           Job trouvé
+ *
+ * @return              false si aucun job n'est disponible
+ */
+bool JobSystem::getJob(irr::u32 index, Job& job)
+{
+    bool trouve = false;
+
+    if(index < nbWorkers)
+        trouve = l_queue[index].pop(job);
+
+    if(!trouve)
+        trouve = l_queue[nbWorkers].steal(job);
+
+    // Vol, en commençant par le voisin
+    for(irr::u32 i=1; !trouve && i<=nbWorkers; i++) {
+        irr::u32 victime = (index + i) % (nbWorkers + 1);
+        if(victime == nbWorkers || victime == index)
+            continue;
+
+        if(l_queue[victime].steal(job)) {
+            atomicAdd(nbStolen[index], 1);
+            trouve = true;
+        }
+    }
+
+    if(trouve)
+        atomicAdd(nbPending, (irr::u32)-1);
+
+    return trouve;
+}
+
+
+/**
+ * Exécute un job et signale sa fin
+ *
+ * @param index         File du thread courant
+ * @param job           Job a exécuter
+ */
+void JobSystem::execute(irr::u32 index, Job& job)
+{
+    job.function(job.data);
+
+    atomicAdd(nbExecuted[index], 1);
+    if(job.counter)
+        atomicAdd(*job.counter, (irr::u32)-1);
+}
+
+
+// Accesseurs
+/**
+ * Donne le nombre de workers
+ *
+ * @return      Nombre de threads workers
+ */
+irr::u32 JobSystem::getNbWorkers()
+{
+    return nbWorkers;
+}
+
+
+/**
+ * Donne le nombre de jobs exécutés et volés par chaque file
+ *
+ * @return      Statistiques sous forme de texte
+ */
+string JobSystem::getStatistics()
+{
+    ostringstream stats;
+    stats << "Jobs executes (voles):";
+
+    for(irr::u32 i=0; i<=nbWorkers; i++) {
+        if(i == nbWorkers)  stats << " autres=";
+        else                stats << " w" << i << "=";
+
+        stats << nbExecuted[i] << "(" << nbStolen[i] << ")";
+    }
+
+    return stats.str();
+}
@@ -0,0 +1,122 @@
+/** \file   JobSystem.h
+ *  \brief  Définit la classe JobSystem
+ */
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <string>
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/thread/tss.hpp>
+#include <irrlicht.h>
+
+#include "Atomic.h"
+
+#define JOB_QUEUE_SIZE      1024    // Jobs en attente par file
+#define JOB_MAX_WORKERS     64
+
+using namespace std;
+
+/// Fonction exécutée par un job
+typedef void (*JobFunction)(void* data);
+
+/// Fonction exécutée par parallelFor sur l'intervalle [begin, end[
+typedef void (*ParallelForFunction)(void* data, irr::u32 begin, irr::u32 end);
+
+
+/** \struct Job
+ *  \brief  Tâche élémentaire confiée au JobSystem
+ */
+struct Job {
+    JobFunction function;
+    void* data;
+    volatile irr::u32* counter;     // Décrémenté a la fin du job (ou NULL)
+};
+
+
+/** \class  JobQueue
+ *  \brief  File de jobs d'un worker.
+ *
+ * Le propriétaire empile et dépile par le bas (dernier entré, premier
+ * sorti: le job le plus récent a ses données en cache), les autres threads
+ * volent par le haut. Les sections critiques sont trés courtes: un simple
+ * verrou actif suffit.
+ */
+class JobQueue
+{
+    public:
+        JobQueue();
+
+        bool push(const Job& job);
+        bool pop(Job& job);
+        bool steal(Job& job);
+    private:
+        Job jobs[JOB_QUEUE_SIZE];
+        irr::u32 top;
+        irr::u32 bottom;
+
+        volatile irr::u32 verrou;
+        char padding[64];           // Evite le faux partage entre files
+
+        void lock();
+        void unlock();
+};
+
+
+/** \class  JobSystem
+ *  \brief  Ordonnanceur de tâches par vol de travail.
+ *
+ * Chaque worker posséde sa file. Un job soumis par un worker va dans sa
+ * propre file, un job soumis par un autre thread (les modules) va dans la
+ * file commune. Un worker sans travail vole les jobs des autres files,
+ * puis s'endort s'il n'y a plus rien.
+ *
+ * Un thread qui attend la fin de ses jobs (waitFor, parallelFor) exécute
+ * lui aussi des jobs en attendant: un job peut donc en lancer d'autres
+ * sans risque d'interblocage.
+ */
+class JobSystem
+{
+    public:
+        JobSystem(irr::u32 nbWorkers);
+        virtual ~JobSystem();
+
+        void submit(JobFunction function, void* data,
+                volatile irr::u32* counter=NULL);
+        void waitFor(volatile irr::u32* counter);
+        void parallelFor(irr::u32 count, irr::u32 grain,
+                ParallelForFunction function, void* data);
+
+        // Accesseurs
+        irr::u32 getNbWorkers();
+        string getStatistics();
+    protected:
+    private:
+        irr::u32 nbWorkers;
+        vector<boost::thread*> l_worker;
+
+        // Une file par worker, plus la file commune (derniére)
+        JobQueue* l_queue;
+
+        // Index de la file du thread courant
+        boost::thread_specific_ptr<irr::u32> workerIndex;
+
+        // Endormissement des workers
+        volatile irr::u32 nbPending;
+        volatile irr::u32 nbSleeping;
+        volatile irr::u32 quit;
+        boost::mutex mutexSleep;
+        boost::condition_variable condSleep;
+
+        // Statistiques, par file
+        volatile irr::u32 nbExecuted[JOB_MAX_WORKERS + 1];
+        volatile irr::u32 nbStolen[JOB_MAX_WORKERS + 1];
+
+        void workerMain(irr::u32 index);
+        irr::u32 getQueueIndex();
+        bool getJob(irr::u32 index, Job& job);
+        void execute(irr::u32 index, Job& job);
+        void sleep();
+};
+
+#endif // JOBSYSTEM_H
@@ -0,0 +1,166 @@
+/** \file   LatencyHistogram.cpp
+ *  \brief  Implémente la classe LatencyHistogram
+ */
+#include "LatencyHistogram.h"
+
+#include <sstream>
+
+
+/**
+ * Constructeur de LatencyHistogram
+ */
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+/**
+ * Destructeur de LatencyHistogram
+ */
+LatencyHistogram::~LatencyHistogram()
+{
+    //dtor
+}
+
+
+/**
+ * Ajoute une mesure
+ *
+ * @param latency       Latence en microsecondes
+ */
+void LatencyHistogram::add(irr::u32 latency)
+{
+    count++;
+    total += latency;
+    if(latency > max)
+        max = latency;
+
+    // Tranche = position du bit de poids fort
+    int index = 0;
+    while((latency >> (index + 1)) && index < LATENCY_HISTOGRAM_SIZE - 1)
+        index++;
+
+    buckets[index]++;
+}
+
+
+/**
+ * Ajoute les mesures d'un autre histogramme
+ *
+ * @param histogram     Histogramme a ajouter
+ */
+void LatencyHistogram::merge(const LatencyHistogram& histogram)
+{
+    count += histogram.count;
+    total += histogram.total;
+    if(histogram.max > max)
+        max = histogram.max;
+
+    for(int i=0; i<LATENCY_HISTOGRAM_SIZE; i++)
+        buckets[i] += histogram.buckets[i];
+}
+
+
+/**
+ * Supprimme toutes les mesures
+ */
+void LatencyHistogram::reset()
+{
+    count = 0;
+    total = 0;
+    max = 0;
+
+    for(int i=0; i<LATENCY_HISTOGRAM_SIZE; i++)
+        buckets[i] = 0;
+}
+
+
+// Accesseurs
+/**
+ * Donne le nombre de mesures
+ */
+irr::u32 LatencyHistogram::getCount() const
+{
+    return count;
+}
+
+
+/**
+ * Donne la latence maximale mesurée
+ *
+ * @return      Latence en microsecondes
+ */
+irr::u32 LatencyHistogram::getMax() const
+{
+    return max;
+}
+
+
+/**
+ * Donne la latence moyenne
+ *
+ * @return      Latence en microsecondes
+ */
+irr::u32 LatencyHistogram::getMean() const
+{
+    if(count == 0)
+        return 0;
+
+    return (irr::u32)(total / count);
+}
+
+
+/**
+ * Donne une estimation du percentile demandé. La précision est celle
+ * d'une tranche: la borne haute de la tranche est retournée.
+ *
+ * @param percentile    Percentile voulu, entre 0 et 1 (0.99 pour p99)
+ *
+ * @return              Latence en microsecondes
+ */
+irr::u32 LatencyHistogram::getPercentile(float percentile) const
+{
+    if(count == 0)
+        return 0;
+
+    irr::u32 rang = (irr::u32)(percentile * count);
+    irr::u32 cumul = 0;
+
+    for(int i=0; i<LATENCY_HISTOGRAM_SIZE; i++) {
+        cumul += buckets[i];
+
+        if(cumul > rang) {
+            irr::u32 borne = (2u << i) - 1;
+            return (borne < max) ? borne : max;
+        }
+    }
+
+    return max;
+}
+
+
+/**
+ * Donne le nombre de mesures d'une tranche
+ *
+ * @param index         Tranche [2^index, 2^(index+1)[
+ */
+irr::u32 LatencyHistogram::getBucket(int index) const
+{
+    return buckets[index];
+}
+
+
+/**
+ * Résume l'histogramme en une ligne
+ */
+string LatencyHistogram::toString() const
+{
+    ostringstream resume;
+
+    resume  << count << " mesures, moyenne " << getMean()
+            << "us, p50 " << getPercentile(0.50f)
+            << "us, p99 " << getPercentile(0.99f)
+            << "us, max " << max << "us";
+
+    return resume.str();
+}
@@ -0,0 +1,49 @@
+/** \file   LatencyHistogram.h
+ *  \brief  Définit la classe LatencyHistogram
+ */
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <string>
+#include <boost/cstdint.hpp>
+#include <irrlicht.h>
+
+#define LATENCY_HISTOGRAM_SIZE  24      // Tranches de 1us a 2^23us (~8s)
+
+using namespace std;
+
+
+/** \class  LatencyHistogram
+ *  \brief  Accumule des mesures de latence en microsecondes.
+ *
+ * Les mesures sont rangées dans des tranches de puissances de 2: l'ajout
+ * d'une mesure ne coûte que quelques opérations et aucune allocation.
+ * Une instance ne doit être alimentée que par un seul thread.
+ */
+class LatencyHistogram
+{
+    public:
+        LatencyHistogram();
+        virtual ~LatencyHistogram();
+
+        void add(irr::u32 latency);
+        void merge(const LatencyHistogram& histogram);
+        void reset();
+
+        // Accesseurs
+        irr::u32 getCount() const;
+        irr::u32 getMax() const;
+        irr::u32 getMean() const;
+        irr::u32 getPercentile(float percentile) const;
+        irr::u32 getBucket(int index) const;
+        string toString() const;
+    protected:
+    private:
+        irr::u32 count;
+        boost::uint64_t total;
+        irr::u32 max;
+
+        irr::u32 buckets[LATENCY_HISTOGRAM_SIZE];
+};
+
+#endif // LATENCYHISTOGRAM_H
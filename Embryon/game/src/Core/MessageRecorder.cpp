@@ -0,0 +1,429 @@
+/** \file   MessageRecorder.cpp
+ *  \brief  Implémente la classe MessageRecorder
+ */
+#include "MessageRecorder.h"
+
+#include <cstring>
+
+#include "Atomic.h"
+#include "TimeService.h"
+
+
+/**
+ * Constructeur de MessageRecorder. L'enregistreur est inactif tant
+ * que open n'a pas été appelé.
+ */
+MessageRecorder::MessageRecorder()
+{
+    mode = RECORDER_OFF;
+    recordMessages = false;
+    debut = 0;
+    nbRecords = 0;
+    nextInputIndex = 0;
+    nextTickInputIndex = 0;
+    replayTick = 0;
+}
+
+/**
+ * Destructeur de MessageRecorder
+ */
+MessageRecorder::~MessageRecorder()
+{
+    close();
+}
+
+
+/**
+ * Ouvre le journal dans le mode demandé
+ *
+ * @param mode          RECORDER_RECORD ou RECORDER_REPLAY
+ * @param chemin        Chemin du journal
+ *
+ * @return              false si le journal n'a pu être ouvert
+ */
+bool MessageRecorder::open(EnumRecorderMode mode, string chemin)
+{
+    boost::mutex::scoped_lock l(mutexFichier);
+
+    this->mode = RECORDER_OFF;
+    nbRecords = 0;
+    debut = TimeService::now();
+
+    l_input.clear();
+    l_tickInput.clear();
+    nextInputIndex = 0;
+    nextTickInputIndex = 0;
+    replayTick = 0;
+
+    irr::u32 magic = RECORDER_MAGIC;
+    irr::u32 version = RECORDER_VERSION;
+
+    switch(mode) {
+    case RECORDER_RECORD:
+        fichier.open(chemin.c_str(), ios::out | ios::binary | ios::trunc);
+        if(!fichier)
+            return false;
+
+        write(magic);
+        write(version);
+        break;
+
+    case RECORDER_REPLAY:
+        fichier.open(chemin.c_str(), ios::in | ios::binary);
+        if(!fichier)
+            return false;
+
+        if(!read(magic) || !read(version) ||
+            magic != RECORDER_MAGIC || version != RECORDER_VERSION)
+        {
+            fichier.close();
+            return false;
+        }
+
+        // Lu une fois pour toutes: EventsEngine et GameEngine relisent
+        // chacun leur part sans partager le fichier
+        load();
+        fichier.close();
+        break;
+
+    default:
+        return true;
+    }
+
+    this->mode = mode;
+    return true;
+}
+
+
+/**
+ * Ferme le journal
+ */
+void MessageRecorder::close()
+{
+    boost::mutex::scoped_lock l(mutexFichier);
+
+    if(fichier.is_open())
+        fichier.close();
+
+    mode = RECORDER_OFF;
+}
+
+
+/**
+ * Enregistre un message envoyé par le Core, si REPLAY messages est activé.
+ * Seul le membre de MessageData utilisé par son code action est écrit.
+ * Appelé depuis tout les threads.
+ *
+ * @param msg           Message a enregistrer
+ */
+void MessageRecorder::recordMessage(const module_message& msg)
+{
+    if(mode != RECORDER_RECORD || !recordMessages)
+        return;
+
+    const void* payload;
+    irr::u8 size = (irr::u8)getPayload(msg, payload);
+
+    boost::mutex::scoped_lock l(mutexFichier);
+
+    writeHeader(RECORD_MESSAGE);
+    write((irr::u8)msg.idExpediteur);
+    write((irr::u8)msg.idDestination);
+    write((irr::u8)msg.codeAction);
+    write(size);
+    fichier.write((const char*)payload, size);
+}
+
+
+/**
+ * Enregistre un événement d'entrée reçu par EventsEngine
+ *
+ * @param type          Type de l'entrée (RECORD_KEY, ...)
+ * @param value         Touche, identifiant du bouton ou curseur
+ * @param pressedDown   Touche enfoncée
+ * @param partieEnCours Une partie est en cours
+ */
+void MessageRecorder::recordInput(EnumRecordType type, irr::s32 value,
+        bool pressedDown, bool partieEnCours)
+{
+    if(mode != RECORDER_RECORD)
+        return;
+
+    boost::mutex::scoped_lock l(mutexFichier);
+
+    irr::u8 flags = 0;
+    if(pressedDown)     flags |= 1;
+    if(partieEnCours)   flags |= 2;
+
+    writeHeader(type);
+    write(value);
+    write(flags);
+}
+
+
+/**
+ * Enregistre un déplacement avec le pas de simulation qui l'applique.
+ * Appelé par GameEngine.
+ *
+ * @param tick          Numéro du pas
+ * @param codeAction    Déplacement (ACTION_START_*, ACTION_STOP_*)
+ */
+void MessageRecorder::recordTickInput(irr::u32 tick, EnumCodesAction codeAction)
+{
+    if(mode != RECORDER_RECORD)
+        return;
+
+    boost::mutex::scoped_lock l(mutexFichier);
+
+    writeHeader(RECORD_TICK_INPUT);
+    write((irr::s32)codeAction);
+    write((irr::u8)2);
+    write(tick);
+}
+
+
+/**
+ * Donne le prochain événement d'entrée du journal a réinjecter dans
+ * EventsEngine. Les RECORD_TICK_INPUT y restent, a leur place, pour que
+ * le thread de relecture attende que GameEngine les ait appliqués.
+ * Appelé par le seul thread de relecture.
+ *
+ * @param input         Evénement lu
+ *
+ * @return              false a la fin du journal
+ */
+bool MessageRecorder::nextInput(InputRecord& input)
+{
+    if(mode != RECORDER_REPLAY || nextInputIndex >= l_input.size())
+        return false;
+
+    input = l_input[nextInputIndex++];
+    return true;
+}
+
+
+/**
+ * Donne le prochain déplacement appliqué par un pas. Les déplacements
+ * d'un pas déja passé (session divergente) sont abandonnés.
+ * Appelé par le seul GameEngine, avant chaque pas.
+ *
+ * @param tick          Numéro du pas sur le point d'être simulé
+ * @param codeAction    Déplacement lu
+ *
+ * @return              false s'il ne reste aucun déplacement pour ce pas
+ */
+bool MessageRecorder::nextTickInput(irr::u32 tick, EnumCodesAction& codeAction)
+{
+    if(mode != RECORDER_REPLAY)
+        return false;
+
+    while(nextTickInputIndex < l_tickInput.size()
+            && l_tickInput[nextTickInputIndex].tick < tick)
+        nextTickInputIndex++;
+
+    atomicStore(replayTick, tick);
+
+    if(nextTickInputIndex >= l_tickInput.size()
+            || l_tickInput[nextTickInputIndex].tick != tick)
+        return false;
+
+    codeAction = (EnumCodesAction)l_tickInput[nextTickInputIndex++].value;
+    return true;
+}
+
+
+/**
+ * Charge le journal ouvert en relecture. Les messages enregistrés sont
+ * ignorés: ils seront régénérés par les modules.
+ *
+ * @return              false si le journal est tronqué
+ */
+bool MessageRecorder::load()
+{
+    while(true) {
+        InputRecord input;
+        irr::u8 type;
+        if(!read(type) || !read(input.time))
+            return fichier.eof();
+
+        nbRecords++;
+
+        if(type == RECORD_MESSAGE) {
+            irr::u8 id[3];
+            irr::u8 size;
+            if(!read(id) || !read(size))
+                return false;
+
+            fichier.seekg(size, ios::cur);
+            continue;
+        }
+
+        irr::u8 flags;
+        if(!read(input.value) || !read(flags))
+            return false;
+
+        input.type = (EnumRecordType)type;
+        input.pressedDown = (flags & 1) != 0;
+        input.partieEnCours = (flags & 2) != 0;
+        input.tick = 0;
+
+        if(type == RECORD_TICK_INPUT) {
+            if(!read(input.tick))
+                return false;
+
+            l_tickInput.push_back(input);
+        }
+
+        l_input.push_back(input);
+    }
+}
+
+
+/**
+ * Donne le membre de MessageData utilisé par le code action d'un message.
+ * Le noeud d'une activation n'est pas gardé: un pointeur n'a pas de sens
+ * d'une session a l'autre.
+ *
+ * @param msg           Message a enregistrer
+ * @param payload       Début des données utiles
+ *
+ * @return              Taille des données utiles (octets)
+ */
+irr::u32 MessageRecorder::getPayload(const module_message& msg,
+        const void*& payload)
+{
+    const MessageData& data = msg.data;
+    payload = &data;
+
+    switch(msg.codeAction) {
+    case ACTION_CHANGE_MENU:
+        payload = &data.menu;
+        return sizeof(data.menu);
+
+    case ACTION_NOUVELLE_PARTIE:
+        payload = &data.nouvellePartie;
+        return sizeof(data.nouvellePartie);
+
+    case ACTION_INIT_GAME:
+        payload = data.initGame.niveau;
+        return strlen(data.initGame.niveau) + 1;
+
+    case ACTION_PLAYER_SPAWN:
+        payload = &data.spawn;
+        return sizeof(data.spawn);
+
+    case ACTION_ACTIVATE_ENTITY:
+        payload = &data.activation.type;
+        return sizeof(data.activation.type);
+
+    case ACTION_PLAYER_ACTION:
+    case ACTION_START_WALKING_FORWARDS:
+    case ACTION_START_WALKING_BACKWARDS:
+    case ACTION_START_STRAFE_LEFT:
+    case ACTION_START_STRAFE_RIGHT:
+    case ACTION_STOP_WALKING_FORWARDS:
+    case ACTION_STOP_WALKING_BACKWARDS:
+    case ACTION_STOP_STRAFE_LEFT:
+    case ACTION_STOP_STRAFE_RIGHT:
+        payload = &data.input;
+        return sizeof(data.input);
+
+    case ACTION_CURSOR_MOVED:
+        payload = &data.cursor;
+        return sizeof(data.cursor);
+
+    case ACTION_GAME_STATE_CHANGED:
+        payload = &data.gameState;
+        return sizeof(data.gameState);
+
+    default:
+        return 0;
+    }
+}
+
+
+/**
+ * Ecrit l'entête commune a tout les enregistrements
+ *
+ * @param type          Type de l'enregistrement
+ */
+void MessageRecorder::writeHeader(EnumRecordType type)
+{
+    write((irr::u8)type);
+    write((boost::uint64_t)(TimeService::now() - debut));
+
+    nbRecords++;
+}
+
+
+/**
+ * Ecrit une valeur brute dans le journal
+ *
+ * @param value         Valeur a écrire
+ */
+template<typename T>
+void MessageRecorder::write(const T& value)
+{
+    fichier.write((const char*)&value, sizeof(T));
+}
+
+
+/**
+ * Lit une valeur brute depuis le journal
+ *
+ * @param value         Valeur lue
+ *
+ * @return              false si la lecture a échoué
+ */
+template<typename T>
+bool MessageRecorder::read(T& value)
+{
+    fichier.read((char*)&value, sizeof(T));
+    return fichier.good();
+}
+
+
+// Accesseurs
+/**
+ * Donne le mode de l'enregistreur
+ *
+ * @return      Mode courant
+ */
+EnumRecorderMode MessageRecorder::getMode()
+{
+    return mode;
+}
+
+
+/**
+ * Donne le nombre d'enregistrements écrits ou lus
+ *
+ * @return      Nombre d'enregistrements
+ */
+irr::u32 MessageRecorder::getNbRecords()
+{
+    return nbRecords;
+}
+
+
+/**
+ * Donne le dernier pas pour lequel GameEngine a relu ses déplacements
+ *
+ * @return      Numéro du pas
+ */
+irr::u32 MessageRecorder::getReplayTick()
+{
+    return atomicLoad(replayTick);
+}
+
+
+// Mutateurs
+/**
+ * Active la journalisation des messages (REPLAY messages)
+ *
+ * @param recordMessages    true pour enregistrer les messages
+ */
+void MessageRecorder::setRecordMessages(bool recordMessages)
+{
+    this->recordMessages = recordMessages;
+}
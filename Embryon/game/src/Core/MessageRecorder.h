@@ -0,0 +1,137 @@
+/** \file   MessageRecorder.h
+ *  \brief  Définit la classe MessageRecorder
+ */
+#ifndef MESSAGERECORDER_H
+#define MESSAGERECORDER_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+#include <irrlicht.h>
+
+#include "../common.h"
+#include "../module_message.h"
+
+#define RECORDER_FILE       "Session.replay"
+#define RECORDER_MAGIC      0x524D4245      // "EBMR"
+#define RECORDER_VERSION    6
+
+// Position du curseur dans un enregistrement RECORD_CURSOR
+// (décalages sur des non signés: y peut être négatif)
+#define RECORD_CURSOR_VALUE(x, y)   ((irr::s32)(((irr::u32)(y) << 16) \
+                                        | ((irr::u32)(x) & 0xFFFF)))
+#define RECORD_CURSOR_X(value)      ((irr::s32)(irr::s16)((irr::u32)(value) & 0xFFFF))
+#define RECORD_CURSOR_Y(value)      ((irr::s32)(irr::s16)((irr::u32)(value) >> 16))
+
+using namespace std;
+
+
+/** \enum   EnumRecorderMode
+ *  \brief  Mode de fonctionnement de l'enregistreur (section REPLAY)
+ */
+enum EnumRecorderMode {
+    RECORDER_OFF = 0,       // Aucun enregistrement
+    RECORDER_RECORD,        // Enregistre la session
+    RECORDER_REPLAY         // Rejoue la session enregistrée
+};
+
+/** \enum   EnumRecordType
+ *  \brief  Type d'un enregistrement du journal
+ */
+enum EnumRecordType {
+    RECORD_MESSAGE = 0,     // Message entre modules
+    RECORD_KEY,             // Touche clavier
+    RECORD_GUI_BUTTON,      // Clic sur un bouton de la GUI
+    RECORD_INPUT,           // Souris ou manette (code d'entrée, KeyBindings)
+    RECORD_CURSOR,          // Position du curseur (RECORD_CURSOR_VALUE)
+    RECORD_TICK_INPUT       // Déplacement appliqué par un pas de simulation
+};
+
+
+/** \struct InputRecord
+ *  \brief  Evénement d'entrée enregistré
+ */
+struct InputRecord {
+    EnumRecordType type;
+    boost::uint64_t time;   // Depuis le début de la session (ns)
+    irr::s32 value;         // Touche, bouton, curseur ou code action
+    bool pressedDown;
+    bool partieEnCours;     // Etat de la partie lors de l'enregistrement
+    irr::u32 tick;          // RECORD_TICK_INPUT: pas qui l'a appliqué
+};
+
+
+/** \class  MessageRecorder
+ *  \brief  Enregistre et rejoue une session de jeu.
+ *
+ * En enregistrement, chaque événement d'entrée reçu par EventsEngine est
+ * écrit avec son horodatage dans un journal binaire, ainsi que chaque
+ * déplacement avec le numéro du pas de simulation qui l'a appliqué. Les
+ * messages envoyés par le Core peuvent aussi être journalisés (REPLAY
+ * messages), réduits au membre de MessageData utilisé par leur code action.
+ *
+ * En relecture, le journal est chargé en mémoire. Les événements d'entrée
+ * sont réinjectés dans EventsEngine a la place de ceux de la fenêtre, et
+ * GameEngine applique les déplacements au pas enregistré (nextTickInput):
+ * la simulation ne dépend pas de l'ordonnancement des threads.
+ *
+ * Le journal n'est relisible que sur une machine de même boutisme.
+ */
+class MessageRecorder
+{
+    public:
+        MessageRecorder();
+        virtual ~MessageRecorder();
+
+        bool open(EnumRecorderMode mode, string chemin=RECORDER_FILE);
+        void close();
+
+        void recordMessage(const module_message& msg);
+        void recordInput(EnumRecordType type, irr::s32 value,
+                bool pressedDown, bool partieEnCours);
+        void recordTickInput(irr::u32 tick, EnumCodesAction codeAction);
+
+        bool nextInput(InputRecord& input);
+        bool nextTickInput(irr::u32 tick, EnumCodesAction& codeAction);
+
+        // Accesseurs
+        EnumRecorderMode getMode();
+        irr::u32 getNbRecords();
+        irr::u32 getReplayTick();
+
+        // Mutateurs
+        void setRecordMessages(bool recordMessages);
+    protected:
+    private:
+        EnumRecorderMode mode;
+        bool recordMessages;
+
+        boost::mutex mutexFichier;
+        fstream fichier;
+
+        boost::uint64_t debut;
+        irr::u32 nbRecords;
+
+        // Relecture: entrées pour EventsEngine, déplacements pour GameEngine
+        vector<InputRecord> l_input;
+        vector<InputRecord> l_tickInput;
+        irr::u32 nextInputIndex;
+        irr::u32 nextTickInputIndex;
+        volatile irr::u32 replayTick;       // Dernier pas relu par GameEngine
+
+        bool load();
+        void writeHeader(EnumRecordType type);
+
+        static irr::u32 getPayload(const module_message& msg,
+                const void*& payload);
+
+        template<typename T>
+        void write(const T& value);
+
+        template<typename T>
+        bool read(T& value);
+};
+
+#endif // MESSAGERECORDER_H
@@ -0,0 +1,128 @@
+/** \file   RingBuffer.h
+ *  \brief  Définit la classe RingBuffer
+ */
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <irrlicht.h>
+
+#include "Atomic.h"
+
+
+/** \class  RingBuffer
+ *  \brief  File circulaire bornée sans verrou, multi-producteurs et
+ *          mono-consommateur.
+ *
+ * Chaque case porte un numéro de séquence indiquant si elle est libre ou
+ * occupée: les producteurs se réservent une case avec un compare-and-swap,
+ * le consommateur lit sans aucune opération atomique coûteuse.
+ *
+ * SIZE doit être une puissance de 2. Seul un thread a la fois peut appeler
+ * pop().
+ */
+template<class T, irr::u32 SIZE>
+class RingBuffer
+{
+    public:
+        RingBuffer()
+        {
+            for(irr::u32 i=0; i<SIZE; i++)
+                buffer[i].sequence = i;
+
+            enqueuePos = 0;
+            dequeuePos = 0;
+        }
+
+
+        /**
+         * Ajoute un élément dans la file. Peut être appelé par n'importe
+         * quel thread.
+         *
+         * @param data          Element a ajouter
+         *
+         * @return              false si la file est pleine
+         */
+        bool push(const T& data)
+        {
+            Cell* cell;
+            irr::u32 pos = atomicLoad(enqueuePos);
+
+            while(true) {
+                cell = &buffer[pos & (SIZE - 1)];
+                irr::s32 diff = (irr::s32)(atomicLoad(cell->sequence) - pos);
+
+                if(diff == 0) {
+                    // Case libre, on tente de la réserver
+                    if(atomicCompareAndSwap(enqueuePos, pos, pos + 1))
+                        break;
+                    pos = atomicLoad(enqueuePos);
+                } else if(diff < 0)
+                    return false;               // File pleine
+                else
+                    pos = atomicLoad(enqueuePos);
+            }
+
+            cell->data = data;
+            atomicStore(cell->sequence, pos + 1);
+
+            return true;
+        }
+
+
+        /**
+         * Retire le plus ancien élément de la file. Réservé au consommateur.
+         *
+         * @param data          Reçoit l'élément retiré
+         *
+         * @return              false si la file est vide
+         */
+        bool pop(T& data)
+        {
+            Cell* cell = &buffer[dequeuePos & (SIZE - 1)];
+
+            if((irr::s32)(atomicLoad(cell->sequence) - (dequeuePos + 1)) < 0)
+                return false;
+
+            data = cell->data;
+            atomicStore(cell->sequence, dequeuePos + SIZE);
+            dequeuePos++;
+
+            return true;
+        }
+
+
+        /**
+         * Indique si la file est vide. Exact du point de vue du
+         * consommateur, approximatif pour les autres threads.
+         */
+        bool empty()
+        {
+            Cell* cell = &buffer[dequeuePos & (SIZE - 1)];
+            return (irr::s32)(atomicLoad(cell->sequence) - (dequeuePos + 1)) < 0;
+        }
+
+
+        /**
+         * Donne le nombre d'éléments en attente (approximatif)
+         */
+        irr::u32 size()
+        {
+            return atomicLoad(enqueuePos) - atomicLoad(dequeuePos);
+        }
+    protected:
+    private:
+        struct Cell {
+            volatile irr::u32 sequence;
+            T data;
+        };
+
+        Cell buffer[SIZE];
+
+        // Séparés pour que producteurs et consommateur ne se partagent
+        // pas la même ligne de cache
+        volatile irr::u32 enqueuePos;
+        char padding[64];
+        volatile irr::u32 dequeuePos;
+};
+
+#endif // RINGBUFFER_H
@@ -0,0 +1,142 @@
+/** \file   ThreadPlacement.cpp
+ *  \brief  Implémente le placement des threads
+ */
+#include "ThreadPlacement.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <pthread.h>
+    #include <sched.h>
+    #include <time.h>
+    #include <unistd.h>
+    #include <sys/resource.h>
+    #include <sys/syscall.h>
+#endif
+
+
+/**
+ * Restreint le thread appelant aux coeurs donnés
+ *
+ * @param masque        Un bit par coeur (bit 0: premier coeur)
+ *
+ * @return              false si le systéme a refusé
+ */
+bool setCurrentThreadAffinity(irr::u32 masque)
+{
+    if(masque == 0)
+        return false;
+
+#ifdef _WIN32
+    return SetThreadAffinityMask(GetCurrentThread(), masque) != 0;
+#else
+    cpu_set_t coeurs;
+    CPU_ZERO(&coeurs);
+
+    for(int i=0; i<32; i++) {
+        if(masque & (1u << i))
+            CPU_SET(i, &coeurs);
+    }
+
+    return pthread_setaffinity_np(
+            pthread_self(), sizeof(coeurs), &coeurs) == 0;
+#endif
+}
+
+
+/**
+ * Modifie la priorité du thread appelant.
+ * Sous Linux la priorité est une valeur de nice propre au thread: l'élever
+ * au dessus de la normale demande des droits.
+ *
+ * @param priorite      Priorité souhaitée
+ *
+ * @return              false si le systéme a refusé
+ */
+bool setCurrentThreadPriority(EnumThreadPriority priorite)
+{
+#ifdef _WIN32
+    int valeur;
+
+    switch(priorite) {
+    case PRIORITE_MINIMALE:     valeur = THREAD_PRIORITY_LOWEST;        break;
+    case PRIORITE_BASSE:        valeur = THREAD_PRIORITY_BELOW_NORMAL;  break;
+    case PRIORITE_HAUTE:        valeur = THREAD_PRIORITY_ABOVE_NORMAL;  break;
+    case PRIORITE_MAXIMALE:     valeur = THREAD_PRIORITY_HIGHEST;       break;
+    default:                    valeur = THREAD_PRIORITY_NORMAL;        break;
+    }
+
+    return SetThreadPriority(GetCurrentThread(), valeur) != 0;
+#else
+    // Nice de 10 (minimale) a -10 (maximale)
+    int nice = -5 * (int)priorite;
+
+    return setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), nice) == 0;
+#endif
+}
+
+
+/**
+ * Nomme le thread appelant (visible dans les debuggers et profileurs).
+ * Le nom est tronqué a THREAD_NAME_SIZE caractéres.
+ *
+ * @param nom           Nom du thread
+ *
+ * @return              false si le systéme ne permet pas de nommer un thread
+ */
+bool setCurrentThreadName(const string& nom)
+{
+    string court = nom.substr(0, THREAD_NAME_SIZE);
+
+#ifdef _WIN32
+    // SetThreadDescription n'existe que depuis Windows 10
+    typedef HRESULT (WINAPI *SetThreadDescriptionFunction)(HANDLE, PCWSTR);
+
+    HMODULE kernel = GetModuleHandleA("kernel32.dll");
+    if(!kernel)
+        return false;
+
+    SetThreadDescriptionFunction setThreadDescription =
+            (SetThreadDescriptionFunction)
+            GetProcAddress(kernel, "SetThreadDescription");
+    if(!setThreadDescription)
+        return false;
+
+    wstring large(court.begin(), court.end());
+    return SUCCEEDED(setThreadDescription(GetCurrentThread(), large.c_str()));
+#else
+    return pthread_setname_np(pthread_self(), court.c_str()) == 0;
+#endif
+}
+
+
+/**
+ * Donne le temps CPU consommé par le thread appelant (utilisateur et
+ * systéme)
+ *
+ * @return              Temps CPU en nanosecondes
+ */
+boost::uint64_t getCurrentThreadCpuTime()
+{
+#ifdef _WIN32
+    FILETIME creation, fin, noyau, utilisateur;
+
+    if(!GetThreadTimes(GetCurrentThread(),
+            &creation, &fin, &noyau, &utilisateur))
+        return 0;
+
+    // Unités de 100 ns
+    boost::uint64_t total =
+            ((boost::uint64_t)noyau.dwHighDateTime << 32 | noyau.dwLowDateTime) +
+            ((boost::uint64_t)utilisateur.dwHighDateTime << 32 |
+                    utilisateur.dwLowDateTime);
+
+    return total * 100;
+#else
+    struct timespec temps;
+    if(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &temps) != 0)
+        return 0;
+
+    return (boost::uint64_t)temps.tv_sec * 1000000000ULL + temps.tv_nsec;
+#endif
+}
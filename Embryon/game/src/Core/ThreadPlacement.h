@@ -0,0 +1,35 @@
+/** \file   ThreadPlacement.h
+ *  \brief  Placement des threads: affinité, priorité, nom et temps CPU
+ *
+ * Chaque fonction agit sur le thread appelant. Les valeurs non supportées
+ * par le systéme sont ignorées et signalées par un retour false.
+ */
+#ifndef THREADPLACEMENT_H
+#define THREADPLACEMENT_H
+
+#include <string>
+#include <boost/cstdint.hpp>
+#include <irrlicht.h>
+
+#define THREAD_NAME_SIZE        15      // Taille max d'un nom (Linux)
+
+using namespace std;
+
+
+/** \enum   EnumThreadPriority
+ *  \brief  Priorités d'ordonnancement (clés <Module>Priority, section THREADS)
+ */
+enum EnumThreadPriority {
+    PRIORITE_MINIMALE = -2,
+    PRIORITE_BASSE = -1,
+    PRIORITE_NORMALE = 0,
+    PRIORITE_HAUTE = 1,
+    PRIORITE_MAXIMALE = 2
+};
+
+bool setCurrentThreadAffinity(irr::u32 masque);
+bool setCurrentThreadPriority(EnumThreadPriority priorite);
+bool setCurrentThreadName(const string& nom);
+boost::uint64_t getCurrentThreadCpuTime();
+
+#endif // THREADPLACEMENT_H
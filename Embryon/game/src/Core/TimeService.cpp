@@ -0,0 +1,184 @@
+/** \file   TimeService.cpp
+ *  \brief  Implémente la classe TimeService
+ */
+#include "TimeService.h"
+
+#include <time.h>
+
+#include "Atomic.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+#endif
+
+
+/**
+ * Constructeur de TimeService. L'horloge de jeu part de 0, en pause
+ * jusqu'au début d'une partie.
+ */
+TimeService::TimeService()
+{
+    sequence = 0;
+    baseReal = now();
+    baseGame = 0;
+    timeScale = 1.0f;
+    paused = true;
+}
+
+/**
+ * Destructeur de TimeService
+ */
+TimeService::~TimeService()
+{
+}
+
+
+/**
+ * Donne le temps d'une horloge monotone en nanosecondes.
+ * Ne s'arrête pas quand le thread dort et ne dépend pas du coeur.
+ *
+ * @return      Temps en nanosecondes depuis une origine arbitraire
+ */
+boost::uint64_t TimeService::now()
+{
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    static bool initialized = false;
+    LARGE_INTEGER counter;
+
+    if(!initialized) {
+        QueryPerformanceFrequency(&frequency);
+        initialized = true;
+    }
+
+    QueryPerformanceCounter(&counter);
+
+    // Evite le dépassement de capacité de counter * 10^9
+    boost::uint64_t secondes = counter.QuadPart / frequency.QuadPart;
+    boost::uint64_t reste = counter.QuadPart % frequency.QuadPart;
+
+    return secondes * 1000000000ULL + (reste * 1000000000ULL) / frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (boost::uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+
+/**
+ * Donne le temps de jeu: ne s'écoule pas pendant la pause et suit
+ * l'échelle du temps. Sans verrou.
+ *
+ * @return      Temps de jeu en nanosecondes
+ */
+boost::uint64_t TimeService::getGameTime()
+{
+    irr::u32 debut;
+    boost::uint64_t reel, jeu;
+    irr::f32 echelle;
+    bool pause;
+
+    do {
+        debut = atomicLoad(sequence);
+
+        reel = baseReal;
+        jeu = baseGame;
+        echelle = timeScale;
+        pause = paused;
+
+        atomicFence();
+    } while((debut & 1) || debut != atomicLoad(sequence));
+
+    if(pause)
+        return jeu;
+
+    return jeu + (boost::uint64_t)((now() - reel) * (double)echelle);
+}
+
+
+/**
+ * Convertit une durée réelle en durée de jeu (échelle du temps)
+ *
+ * @param duree     Durée réelle (ns)
+ *
+ * @return          Durée de jeu (ns)
+ */
+boost::uint64_t TimeService::toGameDuration(boost::uint64_t duree)
+{
+    return (boost::uint64_t)(duree * (double)getTimeScale());
+}
+
+
+/**
+ * Indique si l'horloge de jeu est arrêtée
+ */
+bool TimeService::isPaused()
+{
+    boost::mutex::scoped_lock l(mutexWrite);
+    return paused;
+}
+
+
+/**
+ * Donne l'échelle du temps de jeu (1: temps réel)
+ */
+irr::f32 TimeService::getTimeScale()
+{
+    boost::mutex::scoped_lock l(mutexWrite);
+    return timeScale;
+}
+
+
+/**
+ * Arrête ou relance l'horloge de jeu
+ *
+ * @param paused        true pour arrêter l'horloge
+ */
+void TimeService::setPaused(bool paused)
+{
+    boost::mutex::scoped_lock l(mutexWrite);
+    if(this->paused == paused)
+        return;
+
+    atomicAdd(sequence, 1);
+    rebase(now());
+    this->paused = paused;
+    atomicAdd(sequence, 1);
+}
+
+
+/**
+ * Modifie l'échelle du temps de jeu. Le temps de jeu déja écoulé n'est
+ * pas modifié.
+ *
+ * @param timeScale     Nouvelle échelle (1: temps réel, 0.5: ralenti)
+ */
+void TimeService::setTimeScale(irr::f32 timeScale)
+{
+    if(timeScale < 0)
+        timeScale = 0;
+
+    boost::mutex::scoped_lock l(mutexWrite);
+
+    atomicAdd(sequence, 1);
+    rebase(now());
+    this->timeScale = timeScale;
+    atomicAdd(sequence, 1);
+}
+
+
+/**
+ * Déplace le point de référence de l'horloge de jeu a maintenant.
+ * Appelé par un écrivain, sequence impaire.
+ *
+ * @param maintenant    Temps réel actuel
+ */
+void TimeService::rebase(boost::uint64_t maintenant)
+{
+    if(!paused)
+        baseGame += (boost::uint64_t)((maintenant - baseReal) * (double)timeScale);
+
+    baseReal = maintenant;
+}
@@ -0,0 +1,59 @@
+/** \file   TimeService.h
+ *  \brief  Définit la classe TimeService
+ */
+#ifndef TIMESERVICE_H
+#define TIMESERVICE_H
+
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+#include <irrlicht.h>
+
+#include "../common.h"
+
+#define TIME_SCALE_PERCENT      100     // Echelle du temps de jeu (défaut)
+
+
+/** \class  TimeService
+ *  \brief  Horloges du programme.
+ *
+ * Fournit:
+ *  - now(): horloge monotone en nanosecondes, qui continue quand les
+ *    threads dorment (contrairement a clock()) ;
+ *  - une horloge de jeu, arrêtée pendant la pause et accélérée ou ralentie
+ *    par l'échelle du temps. Le Core la met en pause a chaque transition
+ *    de l'état du jeu.
+ *
+ * L'horloge de jeu se lit sans verrou (seqlock): les changements de pause
+ * et d'échelle sont rares, les lectures fréquentes.
+ */
+class TimeService
+{
+    public:
+        TimeService();
+        virtual ~TimeService();
+
+        static boost::uint64_t now();
+
+        // Horloge de jeu
+        boost::uint64_t getGameTime();
+        boost::uint64_t toGameDuration(boost::uint64_t duree);
+        bool isPaused();
+        irr::f32 getTimeScale();
+        void setPaused(bool paused);
+        void setTimeScale(irr::f32 timeScale);
+    protected:
+    private:
+        // Point de référence de l'horloge de jeu, protégé par sequence
+        volatile irr::u32 sequence;
+        boost::uint64_t baseReal;
+        boost::uint64_t baseGame;
+        irr::f32 timeScale;
+        bool paused;
+
+        // Sérialise les écrivains
+        boost::mutex mutexWrite;
+
+        void rebase(boost::uint64_t maintenant);
+};
+
+#endif // TIMESERVICE_H
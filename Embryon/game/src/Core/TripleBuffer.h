@@ -0,0 +1,95 @@
+/** \file   TripleBuffer.h
+ *  \brief  Définit la classe TripleBuffer
+ */
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <irrlicht.h>
+
+#include "Atomic.h"
+
+#define TRIPLE_BUFFER_INDEX     0x3     // Index du tampon du milieu
+#define TRIPLE_BUFFER_DIRTY     0x4     // Le tampon du milieu n'a pas été lu
+
+
+/** \class  TripleBuffer
+ *  \brief  Transmet la derniére version d'une donnée d'un thread a un
+ *          autre, sans verrou.
+ *
+ * L'écrivain remplit son tampon puis l'échange avec celui du milieu, le
+ * lecteur échange le sien avec celui du milieu quand il a été publié.
+ * Chacun travaille sur un tampon que l'autre ne touche pas: le lecteur voit
+ * toujours une version compléte, la plus récente, et l'écrivain n'attend
+ * jamais.
+ *
+ * Un seul écrivain et un seul lecteur. Le tampon d'écriture contient une
+ * ancienne version: l'écrivain doit le remplir entiérement avant publish().
+ */
+template<class T>
+class TripleBuffer
+{
+    public:
+        TripleBuffer()
+        {
+            writeIndex = 0;
+            middle = 1;
+            readIndex = 2;
+        }
+
+
+        /**
+         * Donne le tampon a remplir. Réservé a l'écrivain.
+         *
+         * @return              Tampon d'écriture
+         */
+        T& getWriteBuffer()
+        {
+            return buffer[writeIndex];
+        }
+
+
+        /**
+         * Publie le tampon d'écriture. Réservé a l'écrivain.
+         */
+        void publish()
+        {
+            writeIndex = atomicExchange(middle, writeIndex | TRIPLE_BUFFER_DIRTY)
+                    & TRIPLE_BUFFER_INDEX;
+        }
+
+
+        /**
+         * Récupére la derniére version publiée. Réservé au lecteur.
+         *
+         * @return              true si une nouvelle version a été récupérée
+         */
+        bool update()
+        {
+            if(!(atomicLoad(middle) & TRIPLE_BUFFER_DIRTY))
+                return false;
+
+            readIndex = atomicExchange(middle, readIndex) & TRIPLE_BUFFER_INDEX;
+
+            return true;
+        }
+
+
+        /**
+         * Donne la version récupérée par le dernier update(). Réservé au
+         * lecteur.
+         *
+         * @return              Tampon de lecture
+         */
+        const T& getReadBuffer()
+        {
+            return buffer[readIndex];
+        }
+    private:
+        T buffer[3];
+
+        irr::u32 writeIndex;            // Propriété de l'écrivain
+        volatile irr::u32 middle;       // Echangé par les deux threads
+        irr::u32 readIndex;             // Propriété du lecteur
+};
+
+#endif // TRIPLEBUFFER_H
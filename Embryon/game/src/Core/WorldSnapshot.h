@@ -0,0 +1,84 @@
+/** \file   WorldSnapshot.h
+ *  \brief  Définit la structure WorldSnapshot
+ */
+#ifndef WORLDSNAPSHOT_H
+#define WORLDSNAPSHOT_H
+
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <irrlicht.h>
+
+#define SNAPSHOT_INPUT_MAX      8       // Entrées datées par pas
+
+using namespace std;
+
+
+/** \struct EntityTransform
+ *  \brief  Position d'une entité bloc a la fin d'un pas de simulation
+ */
+struct EntityTransform {
+    irr::scene::ISceneNode* node;
+    irr::core::vector3df position;
+    irr::core::vector3df rotation;
+};
+
+
+/** \struct WorldSnapshot
+ *  \brief  Etat du monde publié par la simulation a chaque pas.
+ *
+ * GameEngine remplit un WorldSnapshot complet a la fin de chaque pas et le
+ * publie par un TripleBuffer du Core. RenderingEngine affiche le plus
+ * récent, sans verrou.
+ *
+ * Les nodes ne sont valides que si generation correspond au niveau
+ * construit par le rendu (voir Level::getGeneration).
+ */
+struct WorldSnapshot {
+    WorldSnapshot() : generation(0), tick(0), tickTime(0), tickDuration(0),
+            inputTick(0), nbInputs(0) {}
+
+    irr::u32 generation;                // Niveau simulé (0: aucun)
+    irr::u32 tick;                      // Numéro du pas
+    boost::uint64_t tickTime;           // Fin du pas (horloge de jeu, ns)
+    boost::uint64_t tickDuration;       // ns
+
+    // Joueur
+    irr::core::vector3df previousPosition;
+    irr::core::vector3df position;
+    irr::core::vector3df rotation;
+    irr::core::line3df viseurRay;
+    int vie;
+    int armure;
+
+    // Entités bloc du niveau
+    vector<EntityTransform> l_entity;
+
+    // Déplacements appliqués depuis le dernier inputTick acquitté par le
+    // rendu (Core::setInputAck), répétés jusque la: un snapshot peut ne
+    // jamais être affiché
+    irr::u32 inputTick;                 // Dernier pas qui en a appliqué (0: aucun)
+    irr::u32 nbInputs;
+    boost::uint64_t inputTime[SNAPSHOT_INPUT_MAX];  // Captures (TimeService::now)
+
+
+    /**
+     * Donne la position du joueur interpolée entre les deux derniers pas,
+     * selon le temps écoulé depuis le dernier.
+     *
+     * @param maintenant    Heure de l'affichage (horloge de jeu, ns)
+     *
+     * @return              Position a afficher
+     */
+    irr::core::vector3df getInterpolatedPosition(
+            boost::uint64_t maintenant) const
+    {
+        boost::uint64_t ecoule = maintenant - tickTime;
+        if(maintenant < tickTime || ecoule >= tickDuration)
+            return position;
+
+        irr::f32 alpha = (irr::f32)ecoule / (irr::f32)tickDuration;
+        return previousPosition.getInterpolated(position, 1.0f - alpha);
+    }
+};
+
+#endif // WORLDSNAPSHOT_H
@@ -0,0 +1,75 @@
+/** \file   CullingSceneNode.cpp
+ *  \brief  Implémente la classe CullingSceneNode
+ */
+#include "CullingSceneNode.h"
+
+
+/**
+ * Constructeur de CullingSceneNode
+ *
+ * @param parent        Parent des nodes a masquer (racine de la scene)
+ * @param smgr          Gestionnaire de la scene
+ * @param callBack      Appelé a chaque drawAll
+ */
+CullingSceneNode::CullingSceneNode(irr::scene::ISceneNode* parent,
+        irr::scene::ISceneManager* smgr, CullingCallBack* callBack) :
+    irr::scene::ISceneNode(parent, smgr, -1)
+{
+    this->callBack = callBack;
+}
+
+/**
+ * Destructeur de CullingSceneNode
+ */
+CullingSceneNode::~CullingSceneNode()
+{
+}
+
+
+/**
+ * Replace le node aprés les enfants ajoutés depuis: a appeler avant
+ * drawAll
+ */
+void CullingSceneNode::moveLast()
+{
+    if(getParent())
+        getParent()->addChild(this);
+}
+
+
+// ISceneNode
+/**
+ * Appelle le callback: les autres enfants du parent sont déja animés
+ *
+ * @param timeMs        Temps d'Irrlicht
+ */
+void CullingSceneNode::OnAnimate(irr::u32 timeMs)
+{
+    if(IsVisible && callBack)
+        callBack->OnCull();
+}
+
+
+/**
+ * N'a rien a afficher
+ */
+void CullingSceneNode::OnRegisterSceneNode()
+{
+}
+
+
+/**
+ * N'a rien a afficher
+ */
+void CullingSceneNode::render()
+{
+}
+
+
+/**
+ * Donne une boite vide
+ */
+const irr::core::aabbox3df& CullingSceneNode::getBoundingBox() const
+{
+    return box;
+}
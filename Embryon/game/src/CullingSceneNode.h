@@ -0,0 +1,51 @@
+/** \file   CullingSceneNode.h
+ *  \brief  Définit la classe CullingSceneNode
+ */
+#ifndef CULLINGSCENENODE_H
+#define CULLINGSCENENODE_H
+
+#include <irrlicht.h>
+
+
+/** \class  CullingCallBack
+ *  \brief  Reçoit l'appel de CullingSceneNode pendant drawAll
+ */
+class CullingCallBack
+{
+    public:
+        virtual ~CullingCallBack() {}
+
+        virtual void OnCull() = 0;
+};
+
+
+/** \class  CullingSceneNode
+ *  \brief  Node invisible qui appelle un CullingCallBack entre l'animation
+ *          et l'enregistrement des nodes, pendant drawAll.
+ *
+ * Irrlicht n'anime ni n'enregistre un node masqué. Placé en dernier parmi
+ * les enfants de son parent (moveLast), ce node est animé aprés tout les
+ * autres: les nodes masqués par le callback ont donc avancé normalement,
+ * et ne sont pas enregistrés pour le rendu.
+ */
+class CullingSceneNode : public irr::scene::ISceneNode
+{
+    public:
+        CullingSceneNode(irr::scene::ISceneNode* parent,
+                irr::scene::ISceneManager* smgr, CullingCallBack* callBack);
+        virtual ~CullingSceneNode();
+
+        void moveLast();
+
+        // ISceneNode
+        virtual void OnAnimate(irr::u32 timeMs);
+        virtual void OnRegisterSceneNode();
+        virtual void render();
+        virtual const irr::core::aabbox3df& getBoundingBox() const;
+    protected:
+    private:
+        CullingCallBack* callBack;
+        irr::core::aabbox3df box;           // Vide
+};
+
+#endif // CULLINGSCENENODE_H
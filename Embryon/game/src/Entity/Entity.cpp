@@ -20,6 +20,7 @@ Entity::Entity(vector<Entity*>* l_entity,
     this->l_entity = l_entity;
     this->properties = properties;
 
+    node = NULL;
     targetCache = false;
 }
 
@@ -50,6 +51,9 @@ void Entity::attachToCore(Core* core)
 void Entity::attachToNode(irr::scene::ISceneNode* node)
 {
     this->node = node;
+
+    position = node->getPosition();
+    rotation = node->getRotation();
 }
 
 
@@ -66,6 +70,16 @@ bool Entity::isThisNode(irr::scene::ISceneNode* node)
 }
 
 
+/**
+ * Avance l'entité d'un pas de simulation. Par défaut, elle est immobile.
+ *
+ * @param dt        Durée du pas (ms)
+ */
+void Entity::update(irr::f32 dt)
+{
+}
+
+
 // Accesseurs
 /**
  * Donne le nom de l'entité.
@@ -103,6 +117,51 @@ bool Entity::getIsBlocEntity()
 }
 
 
+/**
+ * Indique si le joueur est bloqué par l'entité. Par défaut, on la traverse
+ * (trigger).
+ *
+ * @return          true si l'entité bloque le joueur
+ */
+bool Entity::isSolid()
+{
+    return false;
+}
+
+
+/**
+ * Donne la node qui représente l'entité
+ *
+ * @return          Node de l'entité (NULL si ce n'est pas une entité bloc)
+ */
+irr::scene::ISceneNode* Entity::getNode()
+{
+    return node;
+}
+
+
+/**
+ * Donne la position simulée de l'entité
+ *
+ * @return          Position de l'entité
+ */
+irr::core::vector3df Entity::getPosition()
+{
+    return position;
+}
+
+
+/**
+ * Donne la rotation simulée de l'entité
+ *
+ * @return          Rotation de l'entité
+ */
+irr::core::vector3df Entity::getRotation()
+{
+    return rotation;
+}
+
+
 // Mutateurs
 /**
  * Modifie le nom de l'entité
@@ -124,19 +183,6 @@ void Entity::setIsBlocEntity(bool isBlocEntity)
 }
 
 
-/**
- * Appelé en cas de colision
- *
- * @param animator      Infos sur la colision
- */
-bool Entity::onCollision(
-        const irr::scene::ISceneNodeAnimatorCollisionResponse &animator)
-{
-    onActivated(ENTITY_ACTIVATION_COLLIDE);
-
-    return true;
-}
-
 
 /**
  * Trouve les entité lié a celle-ci
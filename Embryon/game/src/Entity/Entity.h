@@ -22,9 +22,12 @@ class Core;
  *
  * Jette les bases des interactions inter-entités (trigger, light, func_door,
  * ...).
+ *
+ * Les entités appartiennent a la simulation (GameEngine): leur position est
+ * avancée a chaque pas par update() et publiée dans le WorldSnapshot, le
+ * rendu la recopie sur leur node.
  */
-class Entity :
-    public irr::scene::ICollisionCallback
+class Entity
 {
     public:
         Entity(vector<Entity*>* l_entity,
@@ -34,11 +37,16 @@ class Entity :
         void attachToCore(Core* core);
         virtual void attachToNode(irr::scene::ISceneNode* node);
         bool isThisNode(irr::scene::ISceneNode* node);
+        virtual void update(irr::f32 dt);
 
         // Accesseurs
         string getName();
         irr::core::stringc getProperty(irr::core::stringc name);
         bool getIsBlocEntity();
+        virtual bool isSolid();
+        irr::scene::ISceneNode* getNode();
+        irr::core::vector3df getPosition();
+        irr::core::vector3df getRotation();
 
         // Mutateurs
         void setName(string name);
@@ -46,16 +54,16 @@ class Entity :
 
         // Callback
         virtual void onActivated(EnumEntityActivation activationType) =0;
-
-        // Callback de collisions joueur
-        bool onCollision (
-                const irr::scene::ISceneNodeAnimatorCollisionResponse &animator);
     private:
     protected:
         Core* core;
         vector<Entity*>* l_entity;
         irr::scene::ISceneNode* node;
 
+        // Position simulée, appliquée a la node par le rendu
+        irr::core::vector3df position;
+        irr::core::vector3df rotation;
+
         string name;
         map<irr::core::stringc, irr::core::stringc> properties;
         bool isBlocEntity;
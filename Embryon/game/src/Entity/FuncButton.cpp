@@ -45,12 +45,11 @@ void FuncButton::onActivated(EnumEntityActivation activationType)
 
 
 /**
- * Appelé en cas de colision
+ * Indique si le joueur est bloqué par le bouton
  *
- * @param animator      Infos sur la colision
+ * @return          true
  */
-bool FuncButton::onCollision(
-        const irr::scene::ISceneNodeAnimatorCollisionResponse &animator)
+bool FuncButton::isSolid()
 {
-    return false;
+    return true;
 }
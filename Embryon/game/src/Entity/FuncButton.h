@@ -22,8 +22,8 @@ class FuncButton : public Entity
 
         // Callback
         virtual void onActivated(EnumEntityActivation activationType);
-        bool onCollision (
-                const irr::scene::ISceneNodeAnimatorCollisionResponse &animator);
+
+        bool isSolid();
     protected:
     private:
 };
@@ -13,6 +13,9 @@ FuncDoor::FuncDoor(vector<Entity*>* l_entity,
 {
     setName("func_door");
     setIsBlocEntity(true);
+
+    enMouvement = false;
+    progression = 0;
 }
 
 
@@ -36,44 +39,44 @@ void FuncDoor::onActivated(EnumEntityActivation activationType)
         return;
 
     // Vérifie que la porte est stable
-    if(!node->getAnimators().empty()) {
-        irr::core::list<irr::scene::ISceneNodeAnimator*>::ConstIterator tempAnim = node->getAnimators().begin();
-        irr::scene::ISceneNodeAnimator* anim = (irr::scene::ISceneNodeAnimator*)*tempAnim;
+    if(enMouvement)
+        return;
 
-        if(!anim->hasFinished())
-            return;
+    depart = position;
+    arrivee = position;
+    arrivee.Y += DOOR_HAUTEUR;
 
-        // Detruit les anciennes animations
-        node->removeAnimators();
-    }
+    progression = 0;
+    enMouvement = true;
+}
 
-    irr::core::vector3df start = node->getPosition();
-    irr::core::vector3df end = node->getPosition();
-    end.Y += 100;
 
-    irr::scene::ISceneNodeAnimator* anim;
-    anim = node->getSceneManager()->createFlyStraightAnimator(
-            start, end, 1000, false, true
-    );
+/**
+ * Avance l'ouverture de la porte
+ *
+ * @param dt        Durée du pas (ms)
+ */
+void FuncDoor::update(irr::f32 dt)
+{
+    if(!enMouvement)
+        return;
+
+    progression += dt / DOOR_DUREE;
+    if(progression >= 1.0f) {
+        progression = 1.0f;
+        enMouvement = false;
+    }
 
-    node->addAnimator(anim);
-    anim->drop();
+    position = arrivee.getInterpolated(depart, progression);
 }
 
 
 /**
- * Appelé en cas de colision
+ * Indique si le joueur est bloqué par la porte
  *
- * @param animator      Infos sur la colision
+ * @return          false si on peut passer au travers
  */
-bool FuncDoor::onCollision(
-        const irr::scene::ISceneNodeAnimatorCollisionResponse &animator)
+bool FuncDoor::isSolid()
 {
-    onActivated(ENTITY_ACTIVATION_COLLIDE);
-
-    // Si on peut passer au travers
-    if(getProperty("solid") == "false")
-        return true;
-
-    return false;
+    return getProperty("solid") != "false";
 }
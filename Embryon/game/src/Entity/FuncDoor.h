@@ -6,6 +6,8 @@
 
 #include "Entity.h"
 
+#define DOOR_HAUTEUR        100         // Ouverture de la porte
+#define DOOR_DUREE          1000        // Durée de l'ouverture (ms)
 
 
 /** \class  FuncDoor
@@ -17,6 +19,8 @@
  *
  * Lorsque targetname est spécifié, la porte ne peut être activée via le
  * boutton d'action.
+ *
+ * L'ouverture est avancée par la simulation (update), a pas fixe.
  */
 class FuncDoor : public Entity
 {
@@ -27,10 +31,17 @@ class FuncDoor : public Entity
 
         // Callback
         virtual void onActivated(EnumEntityActivation activationType);
-        bool onCollision (
-                const irr::scene::ISceneNodeAnimatorCollisionResponse &animator);
+
+        void update(irr::f32 dt);
+
+        bool isSolid();
     protected:
     private:
+        // Ouverture en cours
+        bool enMouvement;
+        irr::f32 progression;           // De 0 a 1
+        irr::core::vector3df depart;
+        irr::core::vector3df arrivee;
 };
 
 #endif // FUNCDOOR_H
@@ -32,7 +32,7 @@ TriggerMultiple::~TriggerMultiple()
  */
 void TriggerMultiple::attachToNode(irr::scene::ISceneNode* node)
 {
-    this->node = node;
+    Entity::attachToNode(node);
     this->node->setVisible(false);
 }
 
@@ -0,0 +1,89 @@
+/** \file   LoadingMenu.cpp
+ *  \brief  Implémente la classe LoadingMenu
+ */
+#include "LoadingMenu.h"
+
+
+/**
+ * Constructeur de LoadingMenu
+ */
+LoadingMenu::LoadingMenu(Core* core) :
+    GUIPage(core)
+{
+    setId(IN_LOADING_MENU);
+}
+
+
+/**
+ * Destructeur de LoadingMenu
+ */
+LoadingMenu::~LoadingMenu()
+{
+    //dtor
+}
+
+
+/**
+ * Crée la page du menu
+ */
+irr::gui::IGUIElement* LoadingMenu::createPage(irr::gui::IGUIEnvironment* guienv)
+{
+    irr::gui::IGUIElement* parent = new irr::gui::IGUIElement(
+            irr::gui::EGUIET_ELEMENT, guienv, guienv->getRootGUIElement(), -1,
+            guienv->getRootGUIElement()->getAbsolutePosition()
+    );
+
+    irr::gui::IGUIStaticText* etape = guienv->addStaticText(
+            L"Chargement du niveau",
+            irr::core::rect<irr::s32>(10, 50, 10 + LOADING_BAR_WIDTH, 70),
+            false, false, parent, GUI_LOADINGMENU_ETAPE
+    );
+    etape->setTextAlignment(irr::gui::EGUIA_UPPERLEFT, irr::gui::EGUIA_CENTER);
+
+    // Cadre puis barre, élargie par setProgress
+    guienv->addStaticText(
+            L"", irr::core::rect<irr::s32>(10, 80, 10 + LOADING_BAR_WIDTH, 100),
+            true, false, parent
+    );
+
+    irr::gui::IGUIStaticText* barre = guienv->addStaticText(
+            L"", irr::core::rect<irr::s32>(10, 80, 10, 100),
+            false, false, parent, GUI_LOADINGMENU_BARRE, true
+    );
+    barre->setBackgroundColor(irr::video::SColor(255, 80, 160, 255));
+
+    parent->setVisible(false);
+
+    return parent;
+}
+
+
+/**
+ * Met a jour l'étape affichée et la barre de progression
+ *
+ * @param page          Page créée par createPage
+ * @param progression   Entre 0 et 1
+ * @param etape         Nom de l'étape en cours
+ */
+void LoadingMenu::setProgress(irr::gui::IGUIElement* page,
+        irr::f32 progression, const wchar_t* etape)
+{
+    if(progression < 0)     progression = 0;
+    if(progression > 1)     progression = 1;
+
+    page->getElementFromId(GUI_LOADINGMENU_ETAPE)->setText(etape);
+
+    irr::s32 largeur = (irr::s32)(progression * LOADING_BAR_WIDTH);
+    page->getElementFromId(GUI_LOADINGMENU_BARRE)->setRelativePosition(
+            irr::core::rect<irr::s32>(10, 80, 10 + largeur, 100));
+}
+
+
+// Callback
+/**
+ * Action lors de l'appuit sur escape: le chargement ne peut pas être
+ * interrompu
+ */
+void LoadingMenu::onEscape()
+{
+}
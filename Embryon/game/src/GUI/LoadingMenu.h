@@ -0,0 +1,35 @@
+/** \file   LoadingMenu.h
+ *  \brief  Définit la classe LoadingMenu.
+ */
+#ifndef LOADINGMENU_H
+#define LOADINGMENU_H
+
+#include "GUIPage.h"
+
+#define LOADING_BAR_WIDTH       400     // Largeur de la barre de progression
+
+
+/** \class  LoadingMenu
+ *  \brief  Ecran affiché pendant le chargement d'un niveau.
+ *
+ * Affiche l'étape en cours et une barre de progression, mises a jour par
+ * RenderingEngine entre deux étapes du chargement.
+ */
+class LoadingMenu : public GUIPage
+{
+    public:
+        LoadingMenu(Core* core);
+        virtual ~LoadingMenu();
+
+        irr::gui::IGUIElement* createPage(irr::gui::IGUIEnvironment* guienv);
+
+        static void setProgress(irr::gui::IGUIElement* page,
+                irr::f32 progression, const wchar_t* etape);
+
+        // Callback
+        void onEscape();
+    protected:
+    private:
+};
+
+#endif // LOADINGMENU_H
@@ -0,0 +1,188 @@
+/** \file   KeyBindings.cpp
+ *  \brief  Implémente la classe KeyBindings
+ */
+#include "KeyBindings.h"
+
+#include <sstream>
+
+// Nom des actions dans la section KEYS (ordre de EnumCodePlayerAction)
+static const char* l_actionName[PLAYER_ACTION_COUNT] = {
+    "forward", "backward", "left", "right", "shoot", "action"
+};
+
+
+/**
+ * Constructeur de KeyBindings: aucune affectation, toutes les entrées
+ * relachées
+ */
+KeyBindings::KeyBindings()
+{
+    for(irr::u32 i=0; i<PLAYER_ACTION_COUNT; i++)
+        nbBindings[i] = 0;
+
+    for(irr::u32 i=0; i<INPUT_CODE_COUNT; i++) {
+        l_affected[i] = 0;
+        l_inputState[i] = false;
+    }
+
+    actionState = 0;
+}
+
+/**
+ * Destructeur de KeyBindings
+ */
+KeyBindings::~KeyBindings()
+{
+}
+
+
+/**
+ * Compile la table depuis la section KEYS. L'état des entrées est conservé,
+ * celui des actions est recalculé sans signaler de changement.
+ *
+ * @param config        Section KEYS
+ */
+void KeyBindings::build(map<string, int>& config)
+{
+    for(irr::u32 i=0; i<INPUT_CODE_COUNT; i++)
+        l_affected[i] = 0;
+
+    for(irr::u32 action=0; action<PLAYER_ACTION_COUNT; action++) {
+        nbBindings[action] = 0;
+
+        for(irr::u32 slot=0; slot<BINDING_MAX; slot++) {
+            string key = getConfigKey((EnumCodePlayerAction)action, slot);
+            if(config.find(key) == config.end())
+                continue;
+
+            irr::u32 valeur = (irr::u32)config[key];
+            irr::u32 input = valeur & BINDING_INPUT_MASK;
+            irr::u32 modifier = valeur >> BINDING_MODIFIER_SHIFT;
+
+            // 0: emplacement libre
+            if(input == 0 || input >= INPUT_CODE_COUNT
+                    || modifier >= INPUT_CODE_COUNT)
+                continue;
+
+            Binding& binding = l_binding[action][nbBindings[action]++];
+            binding.input = input;
+            binding.modifier = modifier;
+
+            l_affected[input] |= 1 << action;
+            if(modifier)
+                l_affected[modifier] |= 1 << action;
+        }
+    }
+
+    actionState = 0;
+    for(irr::u32 action=0; action<PLAYER_ACTION_COUNT; action++)
+        if(computeAction(action))
+            actionState |= 1 << action;
+}
+
+
+/**
+ * Change l'état d'une entrée et recalcule les actions qui en dépendent
+ *
+ * @param input         Code d'entrée
+ * @param down          true si l'entrée est enfoncée
+ * @param changes       Reçoit les actions (bits) qui ont changé d'état
+ *
+ * @return              false si l'entrée était déja dans cet état
+ */
+bool KeyBindings::setInput(irr::u32 input, bool down, irr::u32& changes)
+{
+    changes = 0;
+
+    if(input >= INPUT_CODE_COUNT || l_inputState[input] == down)
+        return false;
+
+    l_inputState[input] = down;
+
+    irr::u32 affected = l_affected[input];
+    for(irr::u32 action=0; affected; action++, affected >>= 1) {
+        if(!(affected & 1))
+            continue;
+
+        bool etat = computeAction(action);
+        if(etat != ((actionState >> action) & 1)) {
+            actionState ^= 1 << action;
+            changes |= 1 << action;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * Indique si une action est active: l'une de ses affectations est
+ * enfoncée, modificateur compris
+ *
+ * @param action        Action (EnumCodePlayerAction)
+ */
+bool KeyBindings::computeAction(irr::u32 action) const
+{
+    for(irr::u32 i=0; i<nbBindings[action]; i++) {
+        const Binding& binding = l_binding[action][i];
+
+        if(l_inputState[binding.input]
+                && (!binding.modifier || l_inputState[binding.modifier]))
+            return true;
+    }
+
+    return false;
+}
+
+
+/**
+ * Indique si une entrée est enfoncée
+ *
+ * @param input         Code d'entrée
+ */
+bool KeyBindings::isInputDown(irr::u32 input) const
+{
+    return input < INPUT_CODE_COUNT && l_inputState[input];
+}
+
+
+/**
+ * Indique si une action est active
+ *
+ * @param action        Action du joueur
+ */
+bool KeyBindings::isActionDown(EnumCodePlayerAction action) const
+{
+    return (actionState >> action) & 1;
+}
+
+
+/**
+ * Donne la clé de config d'une affectation
+ *
+ * @param action        Action du joueur
+ * @param slot          Numéro de l'affectation (0 a BINDING_MAX-1)
+ *
+ * @return              "forward" pour la premiére, puis "forward2", ...
+ */
+string KeyBindings::getConfigKey(EnumCodePlayerAction action, irr::u32 slot)
+{
+    ostringstream key;
+    key << l_actionName[action];
+    if(slot > 0)
+        key << (slot + 1);
+
+    return key.str();
+}
+
+
+/**
+ * Compose la valeur de config d'une affectation
+ *
+ * @param input         Code d'entrée
+ * @param modifier      Entrée a maintenir en même temps (0: aucune)
+ */
+irr::s32 KeyBindings::makeBinding(irr::u32 input, irr::u32 modifier)
+{
+    return (irr::s32)(input | (modifier << BINDING_MODIFIER_SHIFT));
+}
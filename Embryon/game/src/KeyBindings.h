@@ -0,0 +1,80 @@
+/** \file   KeyBindings.h
+ *  \brief  Définit la classe KeyBindings
+ */
+#ifndef KEYBINDINGS_H
+#define KEYBINDINGS_H
+
+#include <irrlicht.h>
+#include <map>
+#include <string>
+
+#include "common.h"
+
+#define BINDING_MAX             4       // Affectations par action
+#define BINDING_MODIFIER_SHIFT  16      // Entrée a maintenir (accord)
+#define BINDING_INPUT_MASK      0xffff
+
+// Codes d'entrée: les EKEY_CODE, dont KEY_LBUTTON, KEY_RBUTTON et
+// KEY_MBUTTON pour la souris, puis les boutons et les axes de la manette
+// (un code par sens)
+#define INPUT_JOYSTICK_BUTTON   irr::KEY_KEY_CODES_COUNT
+#define INPUT_JOYSTICK_AXIS     (INPUT_JOYSTICK_BUTTON + \
+        irr::SEvent::SJoystickEvent::NUMBER_OF_BUTTONS)
+#define INPUT_CODE_COUNT        (INPUT_JOYSTICK_AXIS + \
+        2 * irr::SEvent::SJoystickEvent::NUMBER_OF_AXES)
+
+#define INPUT_AXIS_POSITIVE(axe)    (INPUT_JOYSTICK_AXIS + 2 * (axe))
+#define INPUT_AXIS_NEGATIVE(axe)    (INPUT_JOYSTICK_AXIS + 2 * (axe) + 1)
+
+using namespace std;
+
+
+/** \class  KeyBindings
+ *  \brief  Table des affectations des entrées aux actions du joueur.
+ *
+ * Compilée depuis la section KEYS: chaque action a jusqu'a BINDING_MAX
+ * affectations (clés "forward", "forward2", ... "forward4"). Une
+ * affectation vaut code | (modificateur << BINDING_MODIFIER_SHIFT): avec un
+ * modificateur, l'action n'est active que si les deux entrées sont
+ * enfoncées (accord).
+ *
+ * Un changement d'état d'entrée ne coûte qu'un accés par code d'entrée et
+ * le recalcul des actions qui en dépendent, sans recherche dans la config.
+ * Les actions sont des bits: PLAYER_ACTION_COUNT doit rester inférieur a 32.
+ */
+class KeyBindings
+{
+    public:
+        KeyBindings();
+        virtual ~KeyBindings();
+
+        void build(map<string, int>& config);
+
+        bool setInput(irr::u32 input, bool down, irr::u32& changes);
+
+        // Accesseurs
+        bool isInputDown(irr::u32 input) const;
+        bool isActionDown(EnumCodePlayerAction action) const;
+
+        static string getConfigKey(EnumCodePlayerAction action, irr::u32 slot);
+        static irr::s32 makeBinding(irr::u32 input, irr::u32 modifier=0);
+    protected:
+    private:
+        struct Binding {
+            irr::u16 input;
+            irr::u16 modifier;          // 0: aucun
+        };
+
+        Binding l_binding[PLAYER_ACTION_COUNT][BINDING_MAX];
+        irr::u32 nbBindings[PLAYER_ACTION_COUNT];
+
+        // Actions (bits) qui dépendent de chaque entrée
+        irr::u32 l_affected[INPUT_CODE_COUNT];
+
+        bool l_inputState[INPUT_CODE_COUNT];
+        irr::u32 actionState;
+
+        bool computeAction(irr::u32 action) const;
+};
+
+#endif // KEYBINDINGS_H
@@ -9,6 +9,10 @@
  */
 Level::Level()
 {
+    l_irrEntity = NULL;
+    generation = 0;
+    collisionManager = NULL;
+    solidSelector = NULL;
 }
 
 /**
@@ -16,32 +20,74 @@ Level::Level()
  */
 Level::~Level()
 {
+    setCollisionWorld(NULL, NULL);
     clearEntity();
 }
 
 
+/**
+ * Paramétres de l'extraction des propriétés des entités
+ */
+struct EntityPropertiesJob {
+    const irr::scene::quake3::tQ3EntityList* l_irrEntity;
+    vector< map<irr::core::stringc, irr::core::stringc> >* l_properties;
+};
+
+/**
+ * Charge les propriétés des entités [begin, end[. Exécuté par le JobSystem.
+ *
+ * @param data          EntityPropertiesJob
+ * @param begin         Premiére entité
+ * @param end           Fin de l'intervalle (exclue)
+ */
+static void loadEntityProperties(void* data, irr::u32 begin, irr::u32 end)
+{
+    EntityPropertiesJob* job = (EntityPropertiesJob*)data;
+
+    for(irr::u32 i=begin; i<end; i++) {
+        const irr::scene::quake3::SVarGroup *group =
+                (*job->l_irrEntity)[i].getGroup(1);
+
+        map<irr::core::stringc, irr::core::stringc>& properties =
+                (*job->l_properties)[i];
+        for(unsigned int j=0; j<group->Variable.size(); j++) {
+            const irr::scene::quake3::SVariable& var = group->Variable[j];
+            properties[var.name] = var.content;
+        }
+    }
+}
+
+
 /**
  * Crée un objet adapté a chaque entité.
+ * Les propriétés sont extraites en parallèle, les entités sont ensuite
+ * créées dans l'ordre du niveau.
  *
- * @param meshMap      Informations concernant le niveau chargé
+ * @param l_irrEntity  Entités du niveau chargé (BSP ou LevelCache)
+ * @param jobSystem    JobSystem du Core
  */
-void Level::loadEntityList(irr::scene::IQ3LevelMesh* meshMap)
+void Level::loadEntityList(
+        const irr::scene::quake3::tQ3EntityList& l_irrEntity,
+        JobSystem* jobSystem)
 {
     clearEntity();
 
     boost::mutex::scoped_lock l(mutexLevel);
+    generation++;
 
-    irr::scene::quake3::tQ3EntityList l_irrEntity = meshMap->getEntityList();
+    // Charge toutes les proprietés des entités
+    vector< map<irr::core::stringc, irr::core::stringc> >
+            l_properties(l_irrEntity.size());
 
-    for(unsigned int i=0; i<l_irrEntity.size(); i++) {
-        const irr::scene::quake3::SVarGroup *group = l_irrEntity[i].getGroup(1);
+    EntityPropertiesJob job;
+    job.l_irrEntity = &l_irrEntity;
+    job.l_properties = &l_properties;
+    jobSystem->parallelFor(l_irrEntity.size(), 16,
+            &loadEntityProperties, &job);
 
-        // Charge toutes les proprietés de l'entité
-        map<irr::core::stringc, irr::core::stringc> properties;
-        for(unsigned int j=0; j<group->Variable.size(); j++) {
-            irr::scene::quake3::SVariable var = group->Variable[j];
-            properties[var.name] = var.content;
-        }
+    for(unsigned int i=0; i<l_irrEntity.size(); i++) {
+        map<irr::core::stringc, irr::core::stringc>& properties =
+                l_properties[i];
 
         // Crée l'entité correspondante
         if(properties["classname"] == "trigger_multiple")
@@ -60,12 +106,12 @@ void Level::loadEntityList(irr::scene::IQ3LevelMesh* meshMap)
  * Initialise les collisions des entités.
  *
  * @param mSmgr         Scene manager
- * @param meshmap       Niveau chargé
- * @param nodePlayer    Node du joueur (pour les collisions)
+ * @param l_brushMesh   Meshes des entités bloc (index: modéle "*n")
+ * @param solidSelector Selecteur recevant les entités qui bloquent le joueur
  */
 void Level::initializeCollisionsEntities(irr::scene::ISceneManager* mSmgr,
-        irr::scene::IQ3LevelMesh* meshMap,
-        irr::scene::IAnimatedMeshSceneNode* nodePlayer)
+        const vector<irr::scene::IMesh*>& l_brushMesh,
+        irr::scene::IMetaTriangleSelector* solidSelector)
 {
     for(unsigned int i=0; i<l_entity.size(); i++) {
         Entity* entity = l_entity[i];
@@ -80,7 +126,8 @@ void Level::initializeCollisionsEntities(irr::scene::ISceneManager* mSmgr,
         irr::scene::IMesh *mesh = 0;
         irr::s32 modelId = atoi(model.subString(1, model.size()).c_str());
 
-        mesh = meshMap->getBrushEntityMesh(modelId);
+        if(modelId >= 0 && modelId < (irr::s32)l_brushMesh.size())
+            mesh = l_brushMesh[modelId];
 
         if (!mesh)
             cout << "Entite bloc erronee: Aucun model associe !" << endl;
@@ -93,29 +140,72 @@ void Level::initializeCollisionsEntities(irr::scene::ISceneManager* mSmgr,
 
             entity->attachToNode(node);
 
-            // Selecteur
+            // Selecteur du rendu (sélection a la souris)
             irr::scene::ITriangleSelector* selector;
             selector = mSmgr->createTriangleSelectorFromBoundingBox(node);
             node->setTriangleSelector(selector);
-
-            // Collision reponse
-            irr::scene::ISceneNodeAnimatorCollisionResponse* anim;
-            anim = mSmgr->createCollisionResponseAnimator(
-                    selector, nodePlayer,
-                    irr::core::vector3df(30,50,30),
-                    irr::core::vector3df(0,0,0),
-                    irr::core::vector3df(0,0,0)
-            );
-            anim->setCollisionCallback(entity);
-
             selector->drop();
-            nodePlayer->addAnimator(anim);
-            anim->drop();
+
+            // Boite de la simulation, a la position de l'entité
+            EntityBox box;
+            box.entity = entity;
+            box.selector = new BoxTriangleSelector(
+                    node, SCENE_NODE_ENTITY, node->getBoundingBox());
+            box.selector->setTransform(
+                    entity->getPosition(), entity->getRotation());
+            l_entityBox.push_back(box);
+
+            // Le joueur est bloqué par l'entité, sinon il la traverse
+            // et la déclenche (voir getTouchedEntities)
+            if(entity->isSolid())
+                solidSelector->addTriangleSelector(box.selector);
         }
     }
 }
 
 
+/**
+ * Ajoute un mob aux collisions du joueur. Appelé par le rendu pendant le
+ * chargement: le mob est déplacé par ses animateurs, sa position est
+ * ensuite recopiée par setMobTransform.
+ *
+ * @param node          Node du mob
+ * @param solidSelector Selecteur recevant les obstacles du joueur
+ */
+void Level::addMob(irr::scene::ISceneNode* node,
+        irr::scene::IMetaTriangleSelector* solidSelector)
+{
+    boost::mutex::scoped_lock l(mutexCollision);
+
+    BoxTriangleSelector* selector = new BoxTriangleSelector(
+            node, node->getID(), node->getBoundingBox());
+    selector->setTransform(node->getPosition(), node->getRotation());
+
+    solidSelector->addTriangleSelector(selector);
+    l_mobBox.push_back(selector);
+}
+
+
+/**
+ * Recopie la position d'un mob pour la simulation. Appelé par le rendu
+ * aprés avoir animé la scene.
+ *
+ * @param node          Node du mob (voir addMob)
+ * @param position      Position de la node
+ * @param rotation      Rotation de la node
+ */
+void Level::setMobTransform(irr::scene::ISceneNode* node,
+        const irr::core::vector3df& position,
+        const irr::core::vector3df& rotation)
+{
+    boost::mutex::scoped_lock l(mutexCollision);
+
+    for(irr::u32 i=0; i<l_mobBox.size(); i++)
+        if(l_mobBox[i]->getNode() == node)
+            l_mobBox[i]->setTransform(position, rotation);
+}
+
+
 /**
  * Permet de lier le core aux entités afin qu'elle puisse agir sur le
  * jeu.
@@ -130,7 +220,8 @@ void Level::attachEntitiesToCore(Core* core)
 
 
 /**
- * Déclenche l'entité correspondant au scene node donné
+ * Déclenche l'entité correspondant au scene node donné.
+ * Appelé par la simulation.
  *
  * @param node                  Scene node de l'entité
  * @param activationType        Type d'activation souhaitée
@@ -138,6 +229,12 @@ void Level::attachEntitiesToCore(Core* core)
 void Level::triggerEntityBySceneNode(irr::scene::ISceneNode* node,
         EnumEntityActivation activationType)
 {
+    boost::mutex::scoped_lock l(mutexCollision);
+
+    // Niveau en cours de construction
+    if(!solidSelector)
+        return;
+
     for(unsigned int i=0; i<l_entity.size(); i++) {
         Entity* entity = l_entity[i];
 
@@ -147,6 +244,211 @@ void Level::triggerEntityBySceneNode(irr::scene::ISceneNode* node,
 }
 
 
+/**
+ * Paramétres des jobs de la simulation
+ */
+struct EntityStepJob {
+    Entity* const* l_entity;
+    const EntityBox* l_entityBox;
+    irr::f32 dt;
+    irr::core::aabbox3df zone;          // Portée du joueur
+    irr::u8* l_touched;
+};
+
+/**
+ * Avance les entités [begin, end[. Exécuté par le JobSystem: chaque
+ * entité ne modifie que sa propre position.
+ *
+ * @param data          EntityStepJob
+ * @param begin         Premiére entité
+ * @param end           Fin de l'intervalle (exclue)
+ */
+static void updateEntities(void* data, irr::u32 begin, irr::u32 end)
+{
+    EntityStepJob* job = (EntityStepJob*)data;
+
+    for(irr::u32 i=begin; i<end; i++)
+        job->l_entity[i]->update(job->dt);
+}
+
+
+/**
+ * Avance les entités d'un pas de simulation, en parallèle, puis replace
+ * leurs boites de collision
+ *
+ * @param dt            Durée du pas (ms)
+ * @param jobSystem     JobSystem du Core
+ */
+void Level::update(irr::f32 dt, JobSystem* jobSystem)
+{
+    boost::mutex::scoped_lock l(mutexCollision);
+
+    if(!solidSelector || l_entity.empty())
+        return;
+
+    EntityStepJob job;
+    job.l_entity = &l_entity[0];
+    job.dt = dt;
+    jobSystem->parallelFor(l_entity.size(), ENTITY_JOB_GRAIN,
+            &updateEntities, &job);
+
+    for(unsigned int i=0; i<l_entityBox.size(); i++)
+        l_entityBox[i].selector->setTransform(
+                l_entityBox[i].entity->getPosition(),
+                l_entityBox[i].entity->getRotation());
+}
+
+
+/**
+ * Copie la position des entités bloc dans le WorldSnapshot du pas en cours
+ *
+ * @param snapshot      Snapshot a remplir
+ */
+void Level::writeSnapshot(WorldSnapshot& snapshot)
+{
+    boost::mutex::scoped_lock l(mutexCollision);
+
+    // Conserve la capacité du tampon: pas d'allocation une fois rempli
+    snapshot.l_entity.clear();
+    snapshot.generation = 0;
+    if(!solidSelector)
+        return;
+
+    snapshot.generation = generation;
+
+    for(unsigned int i=0; i<l_entity.size(); i++) {
+        Entity* entity = l_entity[i];
+        if(!entity->getNode())
+            continue;
+
+        EntityTransform transform;
+        transform.node = entity->getNode();
+        transform.position = entity->getPosition();
+        transform.rotation = entity->getRotation();
+        snapshot.l_entity.push_back(transform);
+    }
+}
+
+
+/**
+ * Définit le monde de collision du niveau. Doit être remis a NULL avant de
+ * détruire la scene: la simulation peut l'utiliser depuis un autre thread.
+ *
+ * @param collisionManager      Gestionnaire de collision de la scene
+ * @param solidSelector         Triangles qui bloquent le joueur
+ */
+void Level::setCollisionWorld(
+        irr::scene::ISceneCollisionManager* collisionManager,
+        irr::scene::IMetaTriangleSelector* solidSelector)
+{
+    boost::mutex::scoped_lock l(mutexCollision);
+
+    if(solidSelector)
+        solidSelector->grab();
+    if(this->solidSelector)
+        this->solidSelector->drop();
+
+    this->collisionManager = collisionManager;
+    this->solidSelector = solidSelector;
+}
+
+
+/**
+ * Déplace l'ellipsoide du joueur en glissant le long des obstacles.
+ * Le déplacement est balayé: il ne peut pas traverser un mur quelle que
+ * soit sa longueur.
+ *
+ * @param position      Position du joueur, modifiée
+ * @param deplacement   Déplacement souhaité
+ * @param cibleId       Type de la boite heurtée (SCENE_NODE_AUCUN pour la
+ *                      carte ou si aucune)
+ * @param ciblePosition Position de la boite heurtée
+ *
+ * @return              false si aucun niveau n'est chargé
+ */
+bool Level::collide(irr::core::vector3df& position,
+        const irr::core::vector3df& deplacement,
+        irr::s32& cibleId, irr::core::vector3df& ciblePosition)
+{
+    boost::mutex::scoped_lock l(mutexCollision);
+
+    cibleId = SCENE_NODE_AUCUN;
+    if(!solidSelector)
+        return false;
+
+    irr::core::triangle3df triangle;
+    irr::core::vector3df impact;
+    bool chute = false;
+    const irr::scene::ISceneNode* cible = NULL;
+
+    position = collisionManager->getCollisionResultPosition(
+            solidSelector, position, PLAYER_ELLIPSOID, deplacement,
+            triangle, impact, chute, cible
+    );
+
+    // Copie: la boite peut disparaitre au changement de niveau
+    const BoxTriangleSelector* box = findBox(cible);
+    if(box) {
+        cibleId = box->getID();
+        ciblePosition = box->getPosition();
+    }
+
+    return true;
+}
+
+
+/**
+ * Teste les boites [begin, end[ contre la portée du joueur. Exécuté par
+ * le JobSystem.
+ *
+ * @param data          EntityStepJob
+ * @param begin         Premiére boite
+ * @param end           Fin de l'intervalle (exclue)
+ */
+static void testTouchedBoxes(void* data, irr::u32 begin, irr::u32 end)
+{
+    EntityStepJob* job = (EntityStepJob*)data;
+
+    for(irr::u32 i=begin; i<end; i++)
+        job->l_touched[i] = job->zone.intersectsWithBox(
+                job->l_entityBox[i].selector->getTransformedBoundingBox());
+}
+
+
+/**
+ * Donne les entités bloc a portée du joueur. Les boites sont testées en
+ * parallèle, le résultat garde l'ordre du niveau.
+ *
+ * @param position      Position du joueur
+ * @param l_node        Nodes des entités touchées (identifiants)
+ * @param jobSystem     JobSystem du Core
+ */
+void Level::getTouchedEntities(const irr::core::vector3df& position,
+        vector<irr::scene::ISceneNode*>& l_node, JobSystem* jobSystem)
+{
+    boost::mutex::scoped_lock l(mutexCollision);
+
+    l_node.clear();
+    if(!solidSelector || l_entityBox.empty())
+        return;
+
+    // Garde sa capacité d'un pas a l'autre
+    l_touchedBox.resize(l_entityBox.size());
+
+    EntityStepJob job;
+    job.l_entityBox = &l_entityBox[0];
+    job.zone = irr::core::aabbox3df(
+            position - ENTITY_TOUCH_RADIUS, position + ENTITY_TOUCH_RADIUS);
+    job.l_touched = &l_touchedBox[0];
+    jobSystem->parallelFor(l_entityBox.size(), ENTITY_JOB_GRAIN,
+            &testTouchedBoxes, &job);
+
+    for(unsigned int i=0; i<l_entityBox.size(); i++)
+        if(l_touchedBox[i])
+            l_node.push_back(l_entityBox[i].selector->getNode());
+}
+
+
 // Mutateurs
 /**
  * Donne la liste d'entité au niveau
@@ -205,7 +507,20 @@ map<irr::core::stringc, irr::core::stringc>
 
 
 /**
- * Supprimme les entités
+ * Donne le numéro du niveau chargé, incrémenté a chaque chargement.
+ * Permet au rendu d'ignorer un WorldSnapshot d'un niveau précédent.
+ *
+ * @return              Numéro du niveau (0: aucun)
+ */
+irr::u32 Level::getGeneration()
+{
+    boost::mutex::scoped_lock l(mutexLevel);
+    return generation;
+}
+
+
+/**
+ * Supprimme les entités et les boites de collision
  */
 void Level::clearEntity()
 {
@@ -216,4 +531,36 @@ void Level::clearEntity()
     }
 
     l_entity.clear();
+
+    for(unsigned int i=0; i<l_entityBox.size(); i++)
+        l_entityBox[i].selector->drop();
+    for(unsigned int i=0; i<l_mobBox.size(); i++)
+        l_mobBox[i]->drop();
+
+    l_entityBox.clear();
+    l_mobBox.clear();
+}
+
+
+/**
+ * Donne la boite de collision d'une node, sans lire la node
+ *
+ * @param node          Node renvoyée par le gestionnaire de collision
+ *
+ * @return              NULL pour la carte
+ */
+const BoxTriangleSelector* Level::findBox(const irr::scene::ISceneNode* node)
+{
+    if(!node)
+        return NULL;
+
+    for(unsigned int i=0; i<l_mobBox.size(); i++)
+        if(l_mobBox[i]->getNode() == node)
+            return l_mobBox[i];
+
+    for(unsigned int i=0; i<l_entityBox.size(); i++)
+        if(l_entityBox[i].selector->getNode() == node)
+            return l_entityBox[i].selector;
+
+    return NULL;
 }
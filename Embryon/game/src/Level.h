@@ -9,19 +9,47 @@
 #include <map>
 #include <vector>
 
+#include "BoxTriangleSelector.h"
 #include "Entity/FuncButton.h"
 #include "Entity/FuncDoor.h"
 #include "Entity/TargetKill.h"
 #include "Entity/TriggerMultiple.h"
+#include "Core/JobSystem.h"
+#include "Core/WorldSnapshot.h"
+
+// Rayons de l'ellipsoide de collision du joueur
+#define PLAYER_ELLIPSOID        irr::core::vector3df(10, 25, 10)
+// Distance a laquelle le joueur déclenche une entité
+#define ENTITY_TOUCH_RADIUS     irr::core::vector3df(30, 50, 30)
+// Entités par job de la simulation (voir update, getTouchedEntities)
+#define ENTITY_JOB_GRAIN        32
 
 using namespace std;
 
 
+/** \struct EntityBox
+ *  \brief  Boite de collision d'une entité bloc, tenue par la simulation
+ */
+struct EntityBox {
+    Entity* entity;
+    BoxTriangleSelector* selector;
+};
+
+
 /** \class  Level
  *  \brief  Permet de stocker et de charger un niveau.
  *
  * Fournit différents accesseurs et mutateurs permettant de manipuler
  * le niveau.
+ *
+ * Le rendu construit le niveau pendant que le monde de collision est
+ * détaché. Une fois attaché, les entités ne sont plus utilisées que par la
+ * simulation (GameEngine).
+ *
+ * La simulation ne lit aucune node: les entités bloc et les mobs y sont
+ * des BoxTriangleSelector, placés a la position simulée des entités et a
+ * celle des mobs recopiée par le rendu (setMobTransform). Les nodes ne
+ * servent plus que d'identifiants.
  */
 class Level
 {
@@ -29,14 +57,35 @@ class Level
         Level();
         virtual ~Level();
 
-        void loadEntityList(irr::scene::IQ3LevelMesh* meshMap);
+        void loadEntityList(
+                const irr::scene::quake3::tQ3EntityList& l_irrEntity,
+                JobSystem* jobSystem);
         void initializeCollisionsEntities(irr::scene::ISceneManager* mSmgr,
-                irr::scene::IQ3LevelMesh* meshMap,
-                irr::scene::IAnimatedMeshSceneNode* nodePlayer);
+                const vector<irr::scene::IMesh*>& l_brushMesh,
+                irr::scene::IMetaTriangleSelector* solidSelector);
+        void addMob(irr::scene::ISceneNode* node,
+                irr::scene::IMetaTriangleSelector* solidSelector);
+        void setMobTransform(irr::scene::ISceneNode* node,
+                const irr::core::vector3df& position,
+                const irr::core::vector3df& rotation);
+
+        // Collisions, utilisées par la simulation (GameEngine)
+        void setCollisionWorld(
+                irr::scene::ISceneCollisionManager* collisionManager,
+                irr::scene::IMetaTriangleSelector* solidSelector);
+        bool collide(irr::core::vector3df& position,
+                const irr::core::vector3df& deplacement,
+                irr::s32& cibleId, irr::core::vector3df& ciblePosition);
+        void getTouchedEntities(const irr::core::vector3df& position,
+                vector<irr::scene::ISceneNode*>& l_node,
+                JobSystem* jobSystem);
 
+        // Entités, avancées par la simulation
         void attachEntitiesToCore(Core* core);
         void triggerEntityBySceneNode(irr::scene::ISceneNode* node,
                 EnumEntityActivation activationType);
+        void update(irr::f32 dt, JobSystem* jobSystem);
+        void writeSnapshot(WorldSnapshot& snapshot);
 
         // Mutateurs
         void setEntityList(const irr::scene::quake3::tQ3EntityList& l_entity);
@@ -44,6 +93,7 @@ class Level
         // Accesseurs
         map<irr::core::stringc, irr::core::stringc>
                 getEntity(irr::core::stringc name);
+        irr::u32 getGeneration();
     protected:
     private:
         boost::mutex mutexLevel;
@@ -51,7 +101,22 @@ class Level
         const irr::scene::quake3::tQ3EntityList* l_irrEntity;
         vector<Entity*> l_entity;
 
+        // Copies tenues par la simulation (voir BoxTriangleSelector)
+        vector<EntityBox> l_entityBox;
+        vector<BoxTriangleSelector*> l_mobBox;
+        vector<irr::u8> l_touchedBox;       // Voir getTouchedEntities
+
+        // Numéro du niveau chargé (0: aucun)
+        irr::u32 generation;
+
+        // Monde de collision, NULL tant que le niveau n'est pas chargé.
+        // Protége aussi les entités utilisées par la simulation.
+        boost::mutex mutexCollision;
+        irr::scene::ISceneCollisionManager* collisionManager;
+        irr::scene::IMetaTriangleSelector* solidSelector;
+
         void clearEntity();
+        const BoxTriangleSelector* findBox(const irr::scene::ISceneNode* node);
 };
 
 #endif // LEVEL_H
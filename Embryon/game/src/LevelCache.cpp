@@ -0,0 +1,955 @@
+/** \file   LevelCache.cpp
+ *  \brief  Implémente la classe LevelCache
+ */
+#include "LevelCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <boost/interprocess/exceptions.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#define LEVEL_CACHE_MAX_MODELS      1024    // Modéles "*n" d'une carte Q3
+
+
+/**
+ * Lecture séquentielle et bornée de la projection. Chaque bloc est aligné
+ * sur 4 octets. Un dépassement invalide toute la lecture.
+ */
+struct CacheReader
+{
+    const char* pos;
+    const char* end;
+    bool valid;
+
+    CacheReader(const void* data, size_t size)
+    {
+        pos = (const char*)data;
+        end = pos + size;
+        valid = true;
+    }
+
+    const void* read(boost::uint64_t size)
+    {
+        boost::uint64_t aligne = (size + 3) & ~3ULL;
+        if(!valid || aligne > (boost::uint64_t)(end - pos)) {
+            valid = false;
+            return NULL;
+        }
+
+        const void* data = pos;
+        pos += aligne;
+        return data;
+    }
+
+    irr::u32 readU32()
+    {
+        irr::u32 valeur = 0;
+        const void* data = read(sizeof(valeur));
+        if(data)
+            memcpy(&valeur, data, sizeof(valeur));
+        return valeur;
+    }
+
+    irr::s32 readS32()
+    {
+        return (irr::s32)readU32();
+    }
+
+    irr::f32 readF32()
+    {
+        irr::f32 valeur = 0;
+        const void* data = read(sizeof(valeur));
+        if(data)
+            memcpy(&valeur, data, sizeof(valeur));
+        return valeur;
+    }
+
+    boost::uint64_t readU64()
+    {
+        boost::uint64_t valeur = 0;
+        const void* data = read(sizeof(valeur));
+        if(data)
+            memcpy(&valeur, data, sizeof(valeur));
+        return valeur;
+    }
+
+    irr::core::stringc readString()
+    {
+        irr::u32 taille = readU32();
+        const char* data = (const char*)read(taille);
+        if(!data)
+            return "";
+        return irr::core::stringc(data, taille);
+    }
+};
+
+
+/**
+ * Complète un bloc de size octets jusqu'a l'alignement sur 4 octets
+ */
+static void writePadding(ostream& fichier, boost::uint64_t size)
+{
+    static const char zero[4] = {0, 0, 0, 0};
+
+    fichier.write(zero, ((size + 3) & ~3ULL) - size);
+}
+
+/**
+ * Ecrit un bloc aligné sur 4 octets
+ */
+static void writeBlock(ostream& fichier, const void* data, boost::uint64_t size)
+{
+    fichier.write((const char*)data, size);
+    writePadding(fichier, size);
+}
+
+static void writeU32(ostream& fichier, irr::u32 valeur)
+{
+    writeBlock(fichier, &valeur, sizeof(valeur));
+}
+
+static void writeF32(ostream& fichier, irr::f32 valeur)
+{
+    writeBlock(fichier, &valeur, sizeof(valeur));
+}
+
+static void writeU64(ostream& fichier, boost::uint64_t valeur)
+{
+    writeBlock(fichier, &valeur, sizeof(valeur));
+}
+
+static void writeString(ostream& fichier, const irr::core::stringc& texte)
+{
+    writeU32(fichier, texte.size());
+    writeBlock(fichier, texte.c_str(), texte.size());
+}
+
+
+/**
+ * Ecrit les groupes de variables d'un shader ou d'une entité
+ */
+static void writeGroups(ostream& fichier,
+        const irr::scene::quake3::IShader& shader)
+{
+    writeU32(fichier, shader.getGroupSize());
+
+    for(irr::u32 i=0; i<shader.getGroupSize(); i++) {
+        const irr::scene::quake3::SVarGroup* group = shader.getGroup(i);
+
+        writeU32(fichier, group->Variable.size());
+        for(irr::u32 j=0; j<group->Variable.size(); j++) {
+            writeString(fichier, group->Variable[j].name);
+            writeString(fichier, group->Variable[j].content);
+        }
+    }
+}
+
+/**
+ * Relit les groupes de variables d'un shader ou d'une entité
+ *
+ * @return              Groupes créés (une référence)
+ */
+static irr::scene::quake3::SVarGroupList* readGroups(CacheReader& lecture)
+{
+    irr::scene::quake3::SVarGroupList* l_group =
+            new irr::scene::quake3::SVarGroupList();
+
+    irr::u32 nbGroups = lecture.readU32();
+    for(irr::u32 i=0; i<nbGroups && lecture.valid; i++) {
+        irr::scene::quake3::SVarGroup group;
+
+        irr::u32 nbVariables = lecture.readU32();
+        for(irr::u32 j=0; j<nbVariables && lecture.valid; j++) {
+            irr::core::stringc name = lecture.readString();
+            irr::core::stringc content = lecture.readString();
+            group.Variable.push_back(irr::scene::quake3::SVariable(
+                    name.c_str(), content.c_str()));
+        }
+
+        l_group->VariableGroup.push_back(group);
+    }
+
+    return l_group;
+}
+
+
+/**
+ * Ecrit tout l'état d'un matériau, textures comprises
+ *
+ * @param l_textureIndex    Index des textures dans la table du cache
+ */
+static void writeMaterial(ostream& fichier,
+        const irr::video::SMaterial& material,
+        map<irr::video::ITexture*, irr::s32>& l_textureIndex)
+{
+    writeU32(fichier, material.MaterialType);
+    writeU32(fichier, material.AmbientColor.color);
+    writeU32(fichier, material.DiffuseColor.color);
+    writeU32(fichier, material.EmissiveColor.color);
+    writeU32(fichier, material.SpecularColor.color);
+    writeF32(fichier, material.Shininess);
+    writeF32(fichier, material.MaterialTypeParam);
+    writeF32(fichier, material.MaterialTypeParam2);
+    writeF32(fichier, material.Thickness);
+    writeU32(fichier, material.ZBuffer);
+    writeU32(fichier, material.AntiAliasing);
+    writeU32(fichier, material.ColorMask);
+    writeU32(fichier, material.ColorMaterial);
+    writeU32(fichier, (material.Wireframe ? 1 : 0)
+            | (material.PointCloud ? 2 : 0)
+            | (material.GouraudShading ? 4 : 0)
+            | (material.Lighting ? 8 : 0)
+            | (material.ZWriteEnable ? 16 : 0)
+            | (material.BackfaceCulling ? 32 : 0)
+            | (material.FrontfaceCulling ? 64 : 0)
+            | (material.FogEnable ? 128 : 0)
+            | (material.NormalizeNormals ? 256 : 0));
+
+    for(irr::u32 i=0; i<irr::video::MATERIAL_MAX_TEXTURES; i++) {
+        const irr::video::SMaterialLayer& layer = material.TextureLayer[i];
+
+        writeU32(fichier, layer.Texture ? l_textureIndex[layer.Texture] : -1);
+        writeU32(fichier, layer.TextureWrapU);
+        writeU32(fichier, layer.TextureWrapV);
+        writeU32(fichier, (layer.BilinearFilter ? 1 : 0)
+                | (layer.TrilinearFilter ? 2 : 0));
+        writeU32(fichier, layer.AnisotropicFilter);
+        writeU32(fichier, (irr::u32)(irr::s32)layer.LODBias);
+        writeBlock(fichier, material.getTextureMatrix(i).pointer(),
+                16 * sizeof(irr::f32));
+    }
+}
+
+/**
+ * Relit un matériau écrit par writeMaterial
+ *
+ * @param l_texture     Table des textures du cache
+ */
+static void readMaterial(CacheReader& lecture, irr::video::SMaterial& material,
+        const vector<irr::video::ITexture*>& l_texture)
+{
+    material.MaterialType = (irr::video::E_MATERIAL_TYPE)lecture.readU32();
+    material.AmbientColor.color = lecture.readU32();
+    material.DiffuseColor.color = lecture.readU32();
+    material.EmissiveColor.color = lecture.readU32();
+    material.SpecularColor.color = lecture.readU32();
+    material.Shininess = lecture.readF32();
+    material.MaterialTypeParam = lecture.readF32();
+    material.MaterialTypeParam2 = lecture.readF32();
+    material.Thickness = lecture.readF32();
+    material.ZBuffer = (irr::u8)lecture.readU32();
+    material.AntiAliasing = (irr::u8)lecture.readU32();
+    material.ColorMask = (irr::u8)lecture.readU32();
+    material.ColorMaterial = (irr::u8)lecture.readU32();
+
+    irr::u32 flags = lecture.readU32();
+    material.Wireframe = (flags & 1) != 0;
+    material.PointCloud = (flags & 2) != 0;
+    material.GouraudShading = (flags & 4) != 0;
+    material.Lighting = (flags & 8) != 0;
+    material.ZWriteEnable = (flags & 16) != 0;
+    material.BackfaceCulling = (flags & 32) != 0;
+    material.FrontfaceCulling = (flags & 64) != 0;
+    material.FogEnable = (flags & 128) != 0;
+    material.NormalizeNormals = (flags & 256) != 0;
+
+    for(irr::u32 i=0; i<irr::video::MATERIAL_MAX_TEXTURES; i++) {
+        irr::video::SMaterialLayer& layer = material.TextureLayer[i];
+
+        irr::s32 index = lecture.readS32();
+        layer.Texture = index >= 0 && index < (irr::s32)l_texture.size()
+                ? l_texture[index] : NULL;
+        layer.TextureWrapU = (irr::u8)lecture.readU32();
+        layer.TextureWrapV = (irr::u8)lecture.readU32();
+
+        irr::u32 filtres = lecture.readU32();
+        layer.BilinearFilter = (filtres & 1) != 0;
+        layer.TrilinearFilter = (filtres & 2) != 0;
+        layer.AnisotropicFilter = (irr::u8)lecture.readU32();
+        layer.LODBias = (irr::s8)lecture.readS32();
+
+        // Matrice allouée par Irrlicht seulement si elle n'est pas l'identité
+        const void* data = lecture.read(16 * sizeof(irr::f32));
+        if(!data)
+            break;
+
+        irr::core::matrix4 matrice;
+        memcpy(matrice.pointer(), data, 16 * sizeof(irr::f32));
+        if(!matrice.isIdentity())
+            material.setTextureMatrix(i, matrice);
+    }
+}
+
+
+/**
+ * Ecrit un mesh buffer: type de vertex, vertices, indices et matériau
+ *
+ * @param l_textureIndex    Index des textures dans la table du cache
+ */
+static void writeBuffer(ostream& fichier, const irr::scene::IMeshBuffer* buffer,
+        map<irr::video::ITexture*, irr::s32>& l_textureIndex)
+{
+    irr::video::E_VERTEX_TYPE type = buffer->getVertexType();
+
+    writeU32(fichier, type);
+    writeU32(fichier, buffer->getVertexCount());
+    writeU32(fichier, buffer->getIndexCount());
+    writeBlock(fichier, buffer->getVertices(), (boost::uint64_t)
+            buffer->getVertexCount() * irr::video::getVertexPitchFromType(type));
+    writeBlock(fichier, buffer->getIndices(),
+            (boost::uint64_t)buffer->getIndexCount() * sizeof(irr::u16));
+
+    writeMaterial(fichier, buffer->getMaterial(), l_textureIndex);
+}
+
+/**
+ * Crée un mesh buffer depuis ses vertices et ses indices projetés. Un
+ * index hors des vertices invalide toute la lecture.
+ */
+template<class Vertex>
+static irr::scene::IMeshBuffer* createBuffer(CacheReader& lecture,
+        irr::u32 nbVertices, irr::u32 nbIndices)
+{
+    const void* vertices = lecture.read(
+            (boost::uint64_t)nbVertices * sizeof(Vertex));
+    const void* indices = lecture.read(
+            (boost::uint64_t)nbIndices * sizeof(irr::u16));
+    if(!lecture.valid)
+        return NULL;
+
+    irr::scene::CMeshBuffer<Vertex>* buffer =
+            new irr::scene::CMeshBuffer<Vertex>();
+
+    buffer->Vertices.set_used(nbVertices);
+    memcpy(buffer->Vertices.pointer(), vertices, nbVertices * sizeof(Vertex));
+    buffer->Indices.set_used(nbIndices);
+    memcpy(buffer->Indices.pointer(), indices, nbIndices * sizeof(irr::u16));
+
+    for(irr::u32 i=0; i<nbIndices; i++)
+        if(buffer->Indices[i] >= nbVertices) {
+            lecture.valid = false;
+            buffer->drop();
+            return NULL;
+        }
+
+    buffer->recalculateBoundingBox();
+
+    return buffer;
+}
+
+/**
+ * Relit un mesh buffer écrit par writeBuffer
+ *
+ * @param l_texture     Table des textures du cache
+ *
+ * @return              NULL si le fichier est invalide
+ */
+static irr::scene::IMeshBuffer* readBuffer(CacheReader& lecture,
+        const vector<irr::video::ITexture*>& l_texture)
+{
+    irr::u32 type = lecture.readU32();
+    irr::u32 nbVertices = lecture.readU32();
+    irr::u32 nbIndices = lecture.readU32();
+
+    irr::scene::IMeshBuffer* buffer = NULL;
+    switch(type) {
+    case irr::video::EVT_STANDARD:
+        buffer = createBuffer<irr::video::S3DVertex>(
+                lecture, nbVertices, nbIndices);
+        break;
+    case irr::video::EVT_2TCOORDS:
+        buffer = createBuffer<irr::video::S3DVertex2TCoords>(
+                lecture, nbVertices, nbIndices);
+        break;
+    case irr::video::EVT_TANGENTS:
+        buffer = createBuffer<irr::video::S3DVertexTangents>(
+                lecture, nbVertices, nbIndices);
+        break;
+    default:
+        lecture.valid = false;
+        break;
+    }
+
+    if(!buffer)
+        return NULL;
+
+    readMaterial(lecture, buffer->getMaterial(), l_texture);
+
+    if(!lecture.valid) {
+        buffer->drop();
+        return NULL;
+    }
+
+    return buffer;
+}
+
+
+/**
+ * Ajoute les textures d'un mesh a la table du cache
+ */
+static void collectTextures(const irr::scene::IMesh* mesh,
+        vector<irr::video::ITexture*>& l_texture,
+        map<irr::video::ITexture*, irr::s32>& l_textureIndex)
+{
+    for(irr::u32 i=0; i<mesh->getMeshBufferCount(); i++) {
+        const irr::video::SMaterial& material =
+                mesh->getMeshBuffer(i)->getMaterial();
+
+        for(irr::u32 j=0; j<irr::video::MATERIAL_MAX_TEXTURES; j++) {
+            irr::video::ITexture* texture = material.getTexture(j);
+            if(!texture || l_textureIndex.find(texture) != l_textureIndex.end())
+                continue;
+
+            l_textureIndex[texture] = l_texture.size();
+            l_texture.push_back(texture);
+        }
+    }
+}
+
+
+/**
+ * Constructeur de LevelCache: aucun fichier ouvert
+ */
+LevelCache::LevelCache()
+{
+    mapping = NULL;
+    region = NULL;
+    dataOffset = 0;
+
+    assetCache = NULL;
+    geometry = NULL;
+}
+
+/**
+ * Destructeur de LevelCache
+ */
+LevelCache::~LevelCache()
+{
+    close();
+}
+
+
+/**
+ * Donne le chemin du cache d'un niveau
+ *
+ * @param archive       Archive du niveau (niveauN.pk3)
+ */
+string LevelCache::getPath(const string& archive)
+{
+    return archive + LEVEL_CACHE_EXTENSION;
+}
+
+
+/**
+ * Projette un cache en mémoire et vérifie son en-tête
+ *
+ * @param path          Chemin du cache
+ * @param l_source      Archives dont le cache est issu
+ *
+ * @return              false si le cache est absent, invalide ou périmé
+ */
+bool LevelCache::open(const string& path, const vector<string>& l_source)
+{
+    close();
+
+    try {
+        mapping = new boost::interprocess::file_mapping(
+                path.c_str(), boost::interprocess::read_only);
+        region = new boost::interprocess::mapped_region(
+                *mapping, boost::interprocess::read_only);
+    } catch(boost::interprocess::interprocess_exception&) {
+        unmap();
+        return false;
+    }
+
+    CacheReader lecture(region->get_address(), region->get_size());
+
+    bool valide = lecture.readU32() == LEVEL_CACHE_MAGIC
+            && lecture.readU32() == LEVEL_CACHE_VERSION
+            && lecture.readU32() == sizeof(irr::video::S3DVertex)
+            && lecture.readU32() == sizeof(irr::video::S3DVertex2TCoords)
+            && lecture.readU32() == sizeof(irr::video::S3DVertexTangents)
+            && lecture.readU32() == irr::video::MATERIAL_MAX_TEXTURES
+            && lecture.readU32() == l_source.size();
+
+    for(irr::u32 i=0; valide && i<l_source.size(); i++) {
+        boost::uint64_t size, date;
+        valide = getStamp(l_source[i], size, date)
+                && lecture.readU64() == size
+                && lecture.readU64() == date;
+    }
+
+    if(!valide || !lecture.valid) {
+        unmap();
+        return false;
+    }
+
+    this->path = path;
+    dataOffset = lecture.pos - (const char*)region->get_address();
+
+    return true;
+}
+
+
+/**
+ * Crée les textures, les meshes, les shaders et les entités du cache
+ * ouvert, puis libére la projection
+ *
+ * @param driver        Driver qui reçoit les lightmaps
+ * @param assetCache    Cache des textures
+ *
+ * @return              false si le fichier est invalide
+ */
+bool LevelCache::load(irr::video::IVideoDriver* driver, AssetCache* assetCache)
+{
+    if(!region)
+        return false;
+
+    this->assetCache = assetCache;
+
+    CacheReader lecture((const char*)region->get_address() + dataOffset,
+            region->get_size() - dataOffset);
+
+    // Textures: fichiers des archives ou pixels des lightmaps
+    irr::u32 nbTextures = lecture.readU32();
+    for(irr::u32 i=0; i<nbTextures && lecture.valid; i++) {
+        string name = lecture.readString().c_str();
+        irr::video::ITexture* texture = NULL;
+
+        if(lecture.readU32()) {
+            irr::video::ECOLOR_FORMAT format =
+                    (irr::video::ECOLOR_FORMAT)lecture.readU32();
+            irr::core::dimension2d<irr::u32> size;
+            size.Width = lecture.readU32();
+            size.Height = lecture.readU32();
+            const void* pixels = lecture.read((boost::uint64_t)size.Width
+                    * size.Height
+                    * irr::video::IImage::getBitsPerPixelFromFormat(format) / 8);
+            if(!lecture.valid)
+                break;
+
+            // Nommée d'aprés le cache: ne remplace pas celle du loader Q3
+            name = path + ":" + name;
+            if(assetCache->isCached(name))
+                texture = assetCache->getTexture(name);
+            else {
+                irr::video::IImage* image = driver->createImageFromData(
+                        format, size, (void*)pixels, false);
+                texture = assetCache->addTexture(name, image);
+                image->drop();
+            }
+        }
+        else
+            texture = assetCache->getTexture(name);
+
+        l_texture.push_back(texture);
+    }
+
+    // Géométrie puis entités bloc
+    irr::u32 nbMeshes = lecture.readU32();
+    for(irr::u32 i=0; i<nbMeshes && lecture.valid; i++) {
+        irr::s32 modelId = lecture.readS32();
+        irr::u32 nbBuffers = lecture.readU32();
+
+        irr::scene::SMesh* mesh = new irr::scene::SMesh();
+        for(irr::u32 j=0; j<nbBuffers && lecture.valid; j++) {
+            irr::scene::IMeshBuffer* buffer = readBuffer(lecture, l_texture);
+            if(!buffer)
+                break;
+
+            mesh->addMeshBuffer(buffer);
+            buffer->drop();
+        }
+        mesh->recalculateBoundingBox();
+
+        if(modelId < 0 && !geometry)
+            geometry = mesh;
+        else if(modelId >= 0 && modelId < LEVEL_CACHE_MAX_MODELS) {
+            if((irr::u32)modelId >= l_brushMesh.size())
+                l_brushMesh.resize(modelId + 1, NULL);
+            if(l_brushMesh[modelId])
+                l_brushMesh[modelId]->drop();
+            l_brushMesh[modelId] = mesh;
+        }
+        else
+            mesh->drop();
+    }
+
+    // Shaders de la géométrie, par index de matériau
+    irr::u32 nbShaders = lecture.readU32();
+    for(irr::u32 i=0; i<nbShaders && lecture.valid; i++) {
+        irr::s32 index = lecture.readS32();
+
+        irr::scene::quake3::IShader* shader = new irr::scene::quake3::IShader();
+        shader->ID = lecture.readS32();
+        shader->name = lecture.readString();
+        shader->VarGroup = readGroups(lecture);
+        l_varGroup.push_back(shader->VarGroup);
+
+        if(l_shader.find(index) != l_shader.end())
+            delete l_shader[index];
+        l_shader[index] = shader;
+    }
+
+    // Entités, déja triées par nom
+    irr::u32 nbEntities = lecture.readU32();
+    for(irr::u32 i=0; i<nbEntities && lecture.valid; i++) {
+        irr::scene::quake3::IEntity entity;
+        entity.ID = lecture.readS32();
+        entity.name = lecture.readString();
+        entity.VarGroup = readGroups(lecture);
+        l_varGroup.push_back(entity.VarGroup);
+
+        l_entity.push_back(entity);
+    }
+
+    // Arbre BSP et PVS (absents si la carte n'en a pas)
+    irr::u32 nbPlanes = lecture.readU32();
+    const void* l_plane = lecture.read(
+            (boost::uint64_t)nbPlanes * sizeof(LevelVisibility::Plane));
+    irr::u32 nbNodes = lecture.readU32();
+    const void* l_node = lecture.read(
+            (boost::uint64_t)nbNodes * sizeof(LevelVisibility::Node));
+    irr::u32 nbLeaves = lecture.readU32();
+    const void* l_leafCluster = lecture.read(
+            (boost::uint64_t)nbLeaves * sizeof(irr::s32));
+    irr::u32 nbClusters = lecture.readU32();
+    irr::u32 clusterSize = lecture.readU32();
+    const void* l_vis = lecture.read(
+            (boost::uint64_t)nbClusters * clusterSize);
+
+    if(lecture.valid && nbNodes > 0)
+        visibility.load((const LevelVisibility::Plane*)l_plane, nbPlanes,
+                (const LevelVisibility::Node*)l_node, nbNodes,
+                (const irr::s32*)l_leafCluster, nbLeaves,
+                nbClusters, clusterSize, (const irr::u8*)l_vis);
+
+    unmap();
+
+    if(!lecture.valid || !geometry) {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * Libére la projection et les objets créés par load
+ */
+void LevelCache::close()
+{
+    unmap();
+
+    for(irr::u32 i=0; i<l_texture.size(); i++)
+        if(l_texture[i])
+            assetCache->release(l_texture[i]);
+    l_texture.clear();
+
+    if(geometry)
+        geometry->drop();
+    geometry = NULL;
+
+    for(irr::u32 i=0; i<l_brushMesh.size(); i++)
+        if(l_brushMesh[i])
+            l_brushMesh[i]->drop();
+    l_brushMesh.clear();
+
+    map<irr::s32, irr::scene::quake3::IShader*>::iterator it;
+    for(it = l_shader.begin(); it != l_shader.end(); it++)
+        delete it->second;
+    l_shader.clear();
+
+    l_entity.clear();
+
+    for(irr::u32 i=0; i<l_varGroup.size(); i++)
+        l_varGroup[i]->drop();
+    l_varGroup.clear();
+
+    visibility.clear();
+}
+
+
+/**
+ * Libére la projection du fichier
+ */
+void LevelCache::unmap()
+{
+    if(region)
+        delete region;
+    region = NULL;
+
+    if(mapping)
+        delete mapping;
+    mapping = NULL;
+}
+
+
+/**
+ * Construit en mémoire le cache d'un niveau chargé depuis ses archives,
+ * a écrire ensuite par writeFile. Les textures du niveau doivent être
+ * chargées par le driver (lightmaps relues): thread de rendu uniquement.
+ *
+ * @param l_source      Archives du niveau
+ * @param meshMap       Niveau chargé
+ * @param l_brushMesh   Meshes des entités bloc (index: modéle "*n")
+ * @param visibility    Arbre BSP et PVS de la carte (vide s'il n'y en a pas)
+ * @param fileSystem    Distingue les textures des archives des lightmaps
+ * @param donnees       Contenu du fichier de cache
+ *
+ * @return              false si le cache n'a pas pu être construit
+ */
+bool LevelCache::serialize(const vector<string>& l_source,
+        irr::scene::IQ3LevelMesh* meshMap,
+        const vector<irr::scene::IMesh*>& l_brushMesh,
+        const LevelVisibility& visibility,
+        irr::io::IFileSystem* fileSystem, string& donnees)
+{
+    irr::scene::IMesh* geometry =
+            meshMap->getMesh(irr::scene::quake3::E_Q3_MESH_GEOMETRY);
+
+    // Table des textures
+    vector<irr::video::ITexture*> l_texture;
+    map<irr::video::ITexture*, irr::s32> l_textureIndex;
+    collectTextures(geometry, l_texture, l_textureIndex);
+    for(irr::u32 i=0; i<l_brushMesh.size(); i++)
+        if(l_brushMesh[i])
+            collectTextures(l_brushMesh[i], l_texture, l_textureIndex);
+
+    ostringstream fichier(ios::out | ios::binary);
+
+    writeU32(fichier, LEVEL_CACHE_MAGIC);
+    writeU32(fichier, LEVEL_CACHE_VERSION);
+    writeU32(fichier, sizeof(irr::video::S3DVertex));
+    writeU32(fichier, sizeof(irr::video::S3DVertex2TCoords));
+    writeU32(fichier, sizeof(irr::video::S3DVertexTangents));
+    writeU32(fichier, irr::video::MATERIAL_MAX_TEXTURES);
+    writeU32(fichier, l_source.size());
+
+    for(irr::u32 i=0; i<l_source.size(); i++) {
+        boost::uint64_t size, date;
+        if(!getStamp(l_source[i], size, date))
+            return false;
+
+        writeU64(fichier, size);
+        writeU64(fichier, date);
+    }
+
+    writeU32(fichier, l_texture.size());
+    for(irr::u32 i=0; i<l_texture.size(); i++) {
+        irr::video::ITexture* texture = l_texture[i];
+        irr::core::stringc name = texture->getName();
+        writeString(fichier, name);
+
+        if(fileSystem->existFile(name.c_str())) {
+            writeU32(fichier, 0);
+            continue;
+        }
+
+        // Lightmap: pixels relus, une ligne aprés l'autre sans le pitch
+        irr::video::ECOLOR_FORMAT format = texture->getColorFormat();
+        irr::core::dimension2d<irr::u32> size = texture->getSize();
+        irr::u32 ligne = size.Width
+                * irr::video::IImage::getBitsPerPixelFromFormat(format) / 8;
+
+        const char* pixels = (const char*)texture->lock(true);
+        if(!pixels)
+            return false;
+
+        writeU32(fichier, 1);
+        writeU32(fichier, format);
+        writeU32(fichier, size.Width);
+        writeU32(fichier, size.Height);
+        for(irr::u32 y=0; y<size.Height; y++)
+            fichier.write(pixels + y * texture->getPitch(), ligne);
+        writePadding(fichier, (boost::uint64_t)ligne * size.Height);
+
+        texture->unlock();
+    }
+
+    // Meshes: géométrie (-1) puis entités bloc
+    irr::u32 nbMeshes = 1;
+    for(irr::u32 i=0; i<l_brushMesh.size(); i++)
+        if(l_brushMesh[i])
+            nbMeshes++;
+
+    writeU32(fichier, nbMeshes);
+    for(irr::s32 i=-1; i<(irr::s32)l_brushMesh.size(); i++) {
+        const irr::scene::IMesh* mesh = i < 0 ? geometry : l_brushMesh[i];
+        if(!mesh)
+            continue;
+
+        writeU32(fichier, i);
+        writeU32(fichier, mesh->getMeshBufferCount());
+        for(irr::u32 j=0; j<mesh->getMeshBufferCount(); j++)
+            writeBuffer(fichier, mesh->getMeshBuffer(j), l_textureIndex);
+    }
+
+    // Shaders référencés par la géométrie
+    map<irr::s32, const irr::scene::quake3::IShader*> l_shader;
+    for(irr::u32 i=0; i<geometry->getMeshBufferCount(); i++) {
+        irr::s32 index = (irr::s32)
+                geometry->getMeshBuffer(i)->getMaterial().MaterialTypeParam2;
+        const irr::scene::quake3::IShader* shader = meshMap->getShader(index);
+        if(shader)
+            l_shader[index] = shader;
+    }
+
+    writeU32(fichier, l_shader.size());
+    map<irr::s32, const irr::scene::quake3::IShader*>::iterator it;
+    for(it = l_shader.begin(); it != l_shader.end(); it++) {
+        writeU32(fichier, it->first);
+        writeU32(fichier, it->second->ID);
+        writeString(fichier, it->second->name);
+        writeGroups(fichier, *it->second);
+    }
+
+    const irr::scene::quake3::tQ3EntityList& l_entity =
+            meshMap->getEntityList();
+
+    writeU32(fichier, l_entity.size());
+    for(irr::u32 i=0; i<l_entity.size(); i++) {
+        writeU32(fichier, l_entity[i].ID);
+        writeString(fichier, l_entity[i].name);
+        writeGroups(fichier, l_entity[i]);
+    }
+
+    const vector<LevelVisibility::Plane>& l_plane = visibility.getPlanes();
+    const vector<LevelVisibility::Node>& l_node = visibility.getNodes();
+    const vector<irr::s32>& l_leafCluster = visibility.getLeafClusters();
+    const vector<irr::u8>& l_vis = visibility.getVisData();
+
+    writeU32(fichier, l_plane.size());
+    if(!l_plane.empty())
+        writeBlock(fichier, &l_plane[0],
+                l_plane.size() * sizeof(LevelVisibility::Plane));
+    writeU32(fichier, l_node.size());
+    if(!l_node.empty())
+        writeBlock(fichier, &l_node[0],
+                l_node.size() * sizeof(LevelVisibility::Node));
+    writeU32(fichier, l_leafCluster.size());
+    if(!l_leafCluster.empty())
+        writeBlock(fichier, &l_leafCluster[0],
+                l_leafCluster.size() * sizeof(irr::s32));
+    writeU32(fichier, visibility.getClusterCount());
+    writeU32(fichier, visibility.getClusterSize());
+    if(!l_vis.empty())
+        writeBlock(fichier, &l_vis[0], l_vis.size());
+
+    donnees = fichier.str();
+    return true;
+}
+
+
+/**
+ * Ecrit un cache construit par serialize. N'utilise pas Irrlicht: peut
+ * être appelé depuis un job.
+ *
+ * @param path          Chemin du cache
+ * @param donnees       Contenu du fichier
+ *
+ * @return              false si le cache n'a pas pu être écrit
+ */
+bool LevelCache::writeFile(const string& path, const string& donnees)
+{
+    // Ecrit dans un fichier temporaire: un cache interrompu n'est jamais lu
+    string temporaire = path + ".tmp";
+    ofstream fichier(temporaire.c_str(), ios::out | ios::trunc | ios::binary);
+    if(!fichier)
+        return false;
+
+    fichier.write(donnees.data(), donnees.size());
+    fichier.close();
+    if(!fichier) {
+        remove(temporaire.c_str());
+        return false;
+    }
+
+    remove(path.c_str());
+    return rename(temporaire.c_str(), path.c_str()) == 0;
+}
+
+
+/**
+ * Donne la taille et la date de modification d'un fichier
+ *
+ * @return              false si le fichier n'existe pas
+ */
+bool LevelCache::getStamp(const string& path,
+        boost::uint64_t& size, boost::uint64_t& date)
+{
+    struct stat infos;
+    if(stat(path.c_str(), &infos) != 0)
+        return false;
+
+    size = infos.st_size;
+    date = infos.st_mtime;
+    return true;
+}
+
+
+// Accesseurs
+/**
+ * Indique si un cache valide est projeté (entre open et load)
+ */
+bool LevelCache::isOpen() const
+{
+    return region != NULL;
+}
+
+
+/**
+ * Donne la géométrie du niveau (E_Q3_MESH_GEOMETRY)
+ */
+irr::scene::IMesh* LevelCache::getGeometry()
+{
+    return geometry;
+}
+
+
+/**
+ * Donne les meshes des entités bloc, par numéro de modéle
+ */
+const vector<irr::scene::IMesh*>& LevelCache::getBrushMeshes() const
+{
+    return l_brushMesh;
+}
+
+
+/**
+ * Donne la table des entités, triée par nom
+ */
+const irr::scene::quake3::tQ3EntityList& LevelCache::getEntityList() const
+{
+    return l_entity;
+}
+
+
+/**
+ * Donne un shader de la géométrie
+ *
+ * @param index         MaterialTypeParam2 du mesh buffer
+ *
+ * @return              NULL si le mesh buffer n'a pas de shader
+ */
+const irr::scene::quake3::IShader* LevelCache::getShader(irr::s32 index) const
+{
+    map<irr::s32, irr::scene::quake3::IShader*>::const_iterator it =
+            l_shader.find(index);
+
+    return it != l_shader.end() ? it->second : NULL;
+}
+
+
+/**
+ * Donne l'arbre BSP et le PVS du cache chargé (vide s'il n'y en a pas)
+ */
+const LevelVisibility& LevelCache::getVisibility() const
+{
+    return visibility;
+}
@@ -0,0 +1,103 @@
+/** \file   LevelCache.h
+ *  \brief  Définit la classe LevelCache
+ */
+#ifndef LEVELCACHE_H
+#define LEVELCACHE_H
+
+#include <irrlicht.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+
+#include "AssetCache.h"
+#include "LevelVisibility.h"
+
+#define LEVEL_CACHE_MAGIC       0x4c424d45  // "EMBL"
+#define LEVEL_CACHE_VERSION     3
+#define LEVEL_CACHE_EXTENSION   ".cache"
+
+namespace boost { namespace interprocess {
+    class file_mapping;
+    class mapped_region;
+} }
+
+using namespace std;
+
+
+/** \class  LevelCache
+ *  \brief  Niveau précompilé: lu par une projection du fichier en mémoire
+ *          au lieu d'analyser le BSP.
+ *
+ * Le fichier (niveauN.pk3.cache) est écrit aprés le premier chargement du
+ * niveau depuis ses archives. Il contient, dans l'ordre:
+ * - l'en-tête: version, taille des vertices, nombre de couches de texture
+ *   d'un matériau, taille et date des archives sources (un cache périmé
+ *   est ignoré);
+ * - la table des textures: chemin, et pixels pour celles qui ne sont pas
+ *   des fichiers (lightmaps créées par le loader Q3);
+ * - les mesh buffers de la géométrie et des entités bloc, tels qu'envoyés
+ *   au driver (vertices, indices, matériau complet: couleurs, drapeaux,
+ *   et filtrage, répétition et matrice de chaque couche de texture);
+ * - les shaders Q3 utilisés par la géométrie et la table des entités;
+ * - l'arbre BSP et le PVS de la carte (voir LevelVisibility).
+ *
+ * Le format suit l'organisation mémoire de la plateforme: les vertices et
+ * les indices sont copiés d'un bloc depuis la projection. Irrlicht ne
+ * permettant pas de fournir un octree déja construit, ceux du node de la
+ * carte et du selecteur de collision sont reconstruits depuis la géométrie.
+ *
+ * Les objets créés par load appartiennent au cache jusqu'a close.
+ * Comme Irrlicht, ne doit être utilisé que depuis le thread de rendu,
+ * sauf writeFile qui écrit sur disque un cache construit par serialize.
+ */
+class LevelCache
+{
+    public:
+        LevelCache();
+        virtual ~LevelCache();
+
+        static string getPath(const string& archive);
+
+        bool open(const string& path, const vector<string>& l_source);
+        bool load(irr::video::IVideoDriver* driver, AssetCache* assetCache);
+        void close();
+
+        static bool serialize(const vector<string>& l_source,
+                irr::scene::IQ3LevelMesh* meshMap,
+                const vector<irr::scene::IMesh*>& l_brushMesh,
+                const LevelVisibility& visibility,
+                irr::io::IFileSystem* fileSystem, string& donnees);
+        static bool writeFile(const string& path, const string& donnees);
+
+        // Accesseurs
+        bool isOpen() const;
+        irr::scene::IMesh* getGeometry();
+        const vector<irr::scene::IMesh*>& getBrushMeshes() const;
+        const irr::scene::quake3::tQ3EntityList& getEntityList() const;
+        const irr::scene::quake3::IShader* getShader(irr::s32 index) const;
+        const LevelVisibility& getVisibility() const;
+    protected:
+    private:
+        boost::interprocess::file_mapping* mapping;
+        boost::interprocess::mapped_region* region;
+        string path;
+        size_t dataOffset;                  // Fin de l'en-tête
+
+        // Objets créés par load
+        AssetCache* assetCache;
+        vector<irr::video::ITexture*> l_texture;    // Index de la table
+        irr::scene::IMesh* geometry;
+        vector<irr::scene::IMesh*> l_brushMesh;     // Index: modéle "*n"
+        map<irr::s32, irr::scene::quake3::IShader*> l_shader;
+        irr::scene::quake3::tQ3EntityList l_entity;
+        vector<irr::scene::quake3::SVarGroupList*> l_varGroup;
+        LevelVisibility visibility;
+
+        void unmap();
+
+        static bool getStamp(const string& path,
+                boost::uint64_t& size, boost::uint64_t& date);
+};
+
+#endif // LEVELCACHE_H
@@ -0,0 +1,326 @@
+/** \file   LevelVisibility.cpp
+ *  \brief  Implémente la classe LevelVisibility
+ */
+#include "LevelVisibility.h"
+
+#include <cstring>
+
+// Lumps du fichier BSP utilisés
+#define BSP_LUMPS               17
+#define BSP_LUMP_PLANES         2
+#define BSP_LUMP_NODES          3
+#define BSP_LUMP_LEAFS          4
+#define BSP_LUMP_VISDATA        16
+
+// Taille des enregistrements dans le fichier
+#define BSP_PLANE_SIZE          16      // normal[3], dist
+#define BSP_NODE_SIZE           36      // plane, children[2], mins[3], maxs[3]
+#define BSP_LEAF_SIZE           48      // cluster, area, mins[3], maxs[3], ...
+
+
+/**
+ * Lit un lump du fichier BSP
+ *
+ * @param fichier       Fichier BSP
+ * @param entete        En-tête lu (magic, version, puis offset et taille
+ *                      de chaque lump)
+ * @param lump          Numéro du lump
+ * @param data          Reçoit le contenu
+ *
+ * @return              false si le lump déborde du fichier
+ */
+static bool readLump(irr::io::IReadFile* fichier, const irr::s32* entete,
+        irr::u32 lump, vector<irr::u8>& data)
+{
+    irr::s32 offset = entete[2 + 2*lump];
+    irr::s32 taille = entete[3 + 2*lump];
+    if(offset < 0 || taille < 0 || offset + (long)taille > fichier->getSize())
+        return false;
+
+    data.resize(taille);
+    if(taille == 0)
+        return true;
+
+    return fichier->seek(offset)
+        && fichier->read(&data[0], taille) == taille;
+}
+
+
+/**
+ * Constructeur de LevelVisibility: pas de PVS, tout est visible
+ */
+LevelVisibility::LevelVisibility()
+{
+    nbClusters = 0;
+    clusterSize = 0;
+}
+
+/**
+ * Destructeur de LevelVisibility
+ */
+LevelVisibility::~LevelVisibility()
+{
+}
+
+
+/**
+ * Charge l'arbre et le PVS depuis une carte Q3
+ *
+ * @param fichier       Fichier BSP, ouvert
+ *
+ * @return              false si le fichier n'est pas un BSP Q3 ou si la
+ *                      carte n'a pas de PVS (non compilée par vis)
+ */
+bool LevelVisibility::loadBsp(irr::io::IReadFile* fichier)
+{
+    clear();
+
+    irr::s32 entete[2 + 2*BSP_LUMPS];
+    if(!fichier->seek(0)
+            || fichier->read(entete, sizeof(entete)) != sizeof(entete)
+            || entete[0] != BSP_MAGIC || entete[1] != BSP_VERSION)
+        return false;
+
+    vector<irr::u8> planes, nodes, leafs, visdata;
+    if(!readLump(fichier, entete, BSP_LUMP_PLANES, planes)
+            || !readLump(fichier, entete, BSP_LUMP_NODES, nodes)
+            || !readLump(fichier, entete, BSP_LUMP_LEAFS, leafs)
+            || !readLump(fichier, entete, BSP_LUMP_VISDATA, visdata)
+            || visdata.size() < 2 * sizeof(irr::s32))
+        return false;
+
+    // Plans: Y et Z échangés
+    l_plane.resize(planes.size() / BSP_PLANE_SIZE);
+    for(irr::u32 i=0; i<l_plane.size(); i++) {
+        irr::f32 plan[4];
+        memcpy(plan, &planes[i * BSP_PLANE_SIZE], sizeof(plan));
+
+        l_plane[i].normal[0] = plan[0];
+        l_plane[i].normal[1] = plan[2];
+        l_plane[i].normal[2] = plan[1];
+        l_plane[i].distance = plan[3];
+    }
+
+    l_node.resize(nodes.size() / BSP_NODE_SIZE);
+    for(irr::u32 i=0; i<l_node.size(); i++) {
+        irr::s32 noeud[3];
+        memcpy(noeud, &nodes[i * BSP_NODE_SIZE], sizeof(noeud));
+
+        l_node[i].plane = noeud[0];
+        l_node[i].children[0] = noeud[1];
+        l_node[i].children[1] = noeud[2];
+    }
+
+    l_leafCluster.resize(leafs.size() / BSP_LEAF_SIZE);
+    for(irr::u32 i=0; i<l_leafCluster.size(); i++)
+        memcpy(&l_leafCluster[i], &leafs[i * BSP_LEAF_SIZE], sizeof(irr::s32));
+
+    irr::s32 vecteurs[2];
+    memcpy(vecteurs, &visdata[0], sizeof(vecteurs));
+    if(vecteurs[0] < 0 || vecteurs[1] < 0 || (irr::u64)vecteurs[0]
+            * vecteurs[1] > visdata.size() - sizeof(vecteurs)) {
+        clear();
+        return false;
+    }
+
+    nbClusters = vecteurs[0];
+    clusterSize = vecteurs[1];
+    l_vis.assign(visdata.begin() + sizeof(vecteurs),
+            visdata.begin() + sizeof(vecteurs) + nbClusters * clusterSize);
+
+    return validate();
+}
+
+
+/**
+ * Charge l'arbre et le PVS déja convertis (voir LevelCache)
+ *
+ * @param l_plane       Plans, dans le repére d'Irrlicht
+ * @param nbPlanes      Nombre de plans
+ * @param l_node        Noeuds
+ * @param nbNodes       Nombre de noeuds
+ * @param l_leafCluster Cluster de chaque feuille
+ * @param nbLeaves      Nombre de feuilles
+ * @param nbClusters    Nombre de clusters
+ * @param clusterSize   Octets par vecteur du PVS
+ * @param l_vis         nbClusters * clusterSize octets
+ *
+ * @return              false si les données sont incohérentes
+ */
+bool LevelVisibility::load(const Plane* l_plane, irr::u32 nbPlanes,
+        const Node* l_node, irr::u32 nbNodes,
+        const irr::s32* l_leafCluster, irr::u32 nbLeaves,
+        irr::u32 nbClusters, irr::u32 clusterSize,
+        const irr::u8* l_vis)
+{
+    clear();
+
+    this->l_plane.assign(l_plane, l_plane + nbPlanes);
+    this->l_node.assign(l_node, l_node + nbNodes);
+    this->l_leafCluster.assign(l_leafCluster, l_leafCluster + nbLeaves);
+    this->nbClusters = nbClusters;
+    this->clusterSize = clusterSize;
+    this->l_vis.assign(l_vis, l_vis + (irr::u64)nbClusters * clusterSize);
+
+    return validate();
+}
+
+
+/**
+ * Oublie la carte: tout est visible
+ */
+void LevelVisibility::clear()
+{
+    l_plane.clear();
+    l_node.clear();
+    l_leafCluster.clear();
+    nbClusters = 0;
+    clusterSize = 0;
+    l_vis.clear();
+}
+
+
+/**
+ * Vérifie que l'arbre ne référence que des plans, noeuds, feuilles et
+ * clusters existants. Sinon, oublie la carte.
+ */
+bool LevelVisibility::validate()
+{
+    bool valide = !l_node.empty() && !l_leafCluster.empty()
+            && nbClusters > 0 && (irr::u64)clusterSize * 8 >= nbClusters;
+
+    for(irr::u32 i=0; i<l_node.size() && valide; i++) {
+        const Node& noeud = l_node[i];
+        if(noeud.plane < 0 || (irr::u32)noeud.plane >= l_plane.size())
+            valide = false;
+
+        for(irr::u32 j=0; j<2; j++) {
+            irr::s32 enfant = noeud.children[j];
+            if(enfant >= 0 ? (irr::u32)enfant >= l_node.size()
+                    : (irr::u32)(-(enfant + 1)) >= l_leafCluster.size())
+                valide = false;
+        }
+    }
+
+    for(irr::u32 i=0; i<l_leafCluster.size() && valide; i++)
+        if(l_leafCluster[i] >= (irr::s32)nbClusters)
+            valide = false;
+
+    if(!valide)
+        clear();
+
+    return valide;
+}
+
+
+/**
+ * Donne le cluster contenant un point
+ *
+ * @param position      Point, dans le repére d'Irrlicht
+ *
+ * @return              -1 si le point est dans un solide ou sans PVS
+ */
+irr::s32 LevelVisibility::getCluster(const irr::core::vector3df& position) const
+{
+    if(l_node.empty())
+        return -1;
+
+    // Au plus un noeud par niveau de l'arbre
+    irr::s32 index = 0;
+    for(irr::u32 i=0; i<l_node.size() && index >= 0; i++) {
+        const Node& noeud = l_node[index];
+        const Plane& plan = l_plane[noeud.plane];
+
+        irr::f32 distance = plan.normal[0] * position.X
+                + plan.normal[1] * position.Y
+                + plan.normal[2] * position.Z
+                - plan.distance;
+
+        index = noeud.children[distance >= 0 ? 0 : 1];
+    }
+
+    if(index >= 0)
+        return -1;
+
+    return l_leafCluster[-(index + 1)];
+}
+
+
+/**
+ * Indique si un cluster peut être vu depuis un autre
+ *
+ * @param depuis        Cluster de la caméra
+ * @param cluster       Cluster testé
+ */
+bool LevelVisibility::isVisible(irr::s32 depuis, irr::s32 cluster) const
+{
+    if(depuis < 0 || cluster < 0 || l_vis.empty())
+        return true;
+
+    return (l_vis[depuis * clusterSize + (cluster >> 3)]
+            & (1 << (cluster & 7))) != 0;
+}
+
+
+// Accesseurs
+/**
+ * Indique si la carte a un PVS
+ */
+bool LevelVisibility::isEnabled() const
+{
+    return !l_vis.empty();
+}
+
+
+/**
+ * Donne les plans de l'arbre
+ */
+const vector<LevelVisibility::Plane>& LevelVisibility::getPlanes() const
+{
+    return l_plane;
+}
+
+
+/**
+ * Donne les noeuds de l'arbre
+ */
+const vector<LevelVisibility::Node>& LevelVisibility::getNodes() const
+{
+    return l_node;
+}
+
+
+/**
+ * Donne le cluster de chaque feuille
+ */
+const vector<irr::s32>& LevelVisibility::getLeafClusters() const
+{
+    return l_leafCluster;
+}
+
+
+/**
+ * Donne le nombre de clusters
+ */
+irr::u32 LevelVisibility::getClusterCount() const
+{
+    return nbClusters;
+}
+
+
+/**
+ * Donne la taille en octets d'un vecteur du PVS
+ */
+irr::u32 LevelVisibility::getClusterSize() const
+{
+    return clusterSize;
+}
+
+
+/**
+ * Donne les vecteurs du PVS, l'un aprés l'autre
+ */
+const vector<irr::u8>& LevelVisibility::getVisData() const
+{
+    return l_vis;
+}
@@ -0,0 +1,81 @@
+/** \file   LevelVisibility.h
+ *  \brief  Définit la classe LevelVisibility
+ */
+#ifndef LEVELVISIBILITY_H
+#define LEVELVISIBILITY_H
+
+#include <irrlicht.h>
+#include <vector>
+
+#define BSP_MAGIC               0x50534249  // "IBSP"
+#define BSP_VERSION             46          // Quake 3
+
+using namespace std;
+
+
+/** \class  LevelVisibility
+ *  \brief  Visibilité précalculée (PVS) d'une carte Q3.
+ *
+ * Garde de l'arbre BSP ce qu'il faut pour trouver la feuille, donc le
+ * cluster, d'un point (plans, noeuds, cluster des feuilles), et les
+ * vecteurs de bits du PVS: un bit par cluster visible depuis chaque
+ * cluster. Les plans sont convertis dans le repére d'Irrlicht (Y et Z
+ * échangés, comme le fait le loader Q3).
+ *
+ * Le cluster -1 (solide, hors de la carte, ou carte sans PVS) voit tout
+ * et est vu de partout.
+ */
+class LevelVisibility
+{
+    public:
+        /// Plan séparateur: normale.position - distance
+        struct Plane
+        {
+            irr::f32 normal[3];
+            irr::f32 distance;
+        };
+
+        /// Noeud de l'arbre. Enfant négatif: feuille -(enfant + 1)
+        struct Node
+        {
+            irr::s32 plane;
+            irr::s32 children[2];       // Devant, derriére
+        };
+
+        LevelVisibility();
+        virtual ~LevelVisibility();
+
+        bool loadBsp(irr::io::IReadFile* fichier);
+        bool load(const Plane* l_plane, irr::u32 nbPlanes,
+                const Node* l_node, irr::u32 nbNodes,
+                const irr::s32* l_leafCluster, irr::u32 nbLeaves,
+                irr::u32 nbClusters, irr::u32 clusterSize,
+                const irr::u8* l_vis);
+        void clear();
+
+        irr::s32 getCluster(const irr::core::vector3df& position) const;
+        bool isVisible(irr::s32 depuis, irr::s32 cluster) const;
+
+        // Accesseurs
+        bool isEnabled() const;
+        const vector<Plane>& getPlanes() const;
+        const vector<Node>& getNodes() const;
+        const vector<irr::s32>& getLeafClusters() const;
+        irr::u32 getClusterCount() const;
+        irr::u32 getClusterSize() const;
+        const vector<irr::u8>& getVisData() const;
+    protected:
+    private:
+        vector<Plane> l_plane;
+        vector<Node> l_node;
+        vector<irr::s32> l_leafCluster;
+
+        // PVS: nbClusters vecteurs de clusterSize octets
+        irr::u32 nbClusters;
+        irr::u32 clusterSize;
+        vector<irr::u8> l_vis;
+
+        bool validate();
+};
+
+#endif // LEVELVISIBILITY_H
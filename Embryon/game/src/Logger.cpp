@@ -3,7 +3,10 @@
  */
 #include "Logger.h"
 
-#include <time.h>
+#include "Core/TimeService.h"
+
+// Origine des horodatages: lancement du programme
+static const boost::uint64_t l_debut = TimeService::now();
 
 
 /**
@@ -44,8 +47,11 @@ void Logger::log(string message, EnumLogLevel level)
     else if(level == ERROR)
         cout << "<-ERROR-> ";
 
-    cout << "(" << clock() << ") " << name << ": " << message << endl;
-    fichier << "(" << clock() << ") " << name << ": " << message << endl;
+    // Millisecondes, horloge monotone (clock() compte le temps processeur)
+    boost::uint64_t temps = (TimeService::now() - l_debut) / 1000000;
+
+    cout << "(" << temps << ") " << name << ": " << message << endl;
+    fichier << "(" << temps << ") " << name << ": " << message << endl;
 }
 
 
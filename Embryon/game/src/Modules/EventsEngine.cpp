@@ -3,11 +3,66 @@
  */
 #include "EventsEngine.h"
 
+#include <sstream>
+#include <boost/bind.hpp>
 #include <boost/thread.hpp>
 #include <boost/date_time.hpp>
 
 #include "../Core/Core.h"
 
+// Marque les événements réinjectés lors d'une relecture
+#define REPLAY_GUI_BUTTON   0x52504C59
+#define REPLAY_INPUT_DOWN   0x52504C44
+#define REPLAY_INPUT_UP     0x52504C55
+#define REPLAY_CURSOR       0x52504C43
+
+// Messages envoyés quand une action s'active ou se désactive
+// (ordre de EnumCodePlayerAction)
+static const EnumCodesAction l_startAction[PLAYER_ACTION_COUNT] = {
+    ACTION_START_WALKING_FORWARDS,
+    ACTION_START_WALKING_BACKWARDS,
+    ACTION_START_STRAFE_LEFT,
+    ACTION_START_STRAFE_RIGHT,
+    ACTION_AUCUNE,                      // Tir: pas encore géré
+    ACTION_PLAYER_ACTION
+};
+
+static const EnumCodesAction l_stopAction[PLAYER_ACTION_COUNT] = {
+    ACTION_STOP_WALKING_FORWARDS,
+    ACTION_STOP_WALKING_BACKWARDS,
+    ACTION_STOP_STRAFE_LEFT,
+    ACTION_STOP_STRAFE_RIGHT,
+    ACTION_AUCUNE,
+    ACTION_AUCUNE
+};
+
+
+/**
+ * Indique si un event relâche une touche ou un bouton: il ne doit pas être
+ * perdu. Les events de la manette portent l'état complet, le suivant
+ * corrige une perte.
+ *
+ * @param event         Event a tester
+ */
+static bool isRelease(const irr::SEvent& event)
+{
+    switch(event.EventType) {
+    case irr::EET_KEY_INPUT_EVENT:
+        return !event.KeyInput.PressedDown;
+
+    case irr::EET_MOUSE_INPUT_EVENT:
+        return event.MouseInput.Event == irr::EMIE_LMOUSE_LEFT_UP
+            || event.MouseInput.Event == irr::EMIE_RMOUSE_LEFT_UP
+            || event.MouseInput.Event == irr::EMIE_MMOUSE_LEFT_UP;
+
+    case irr::EET_USER_EVENT:
+        return event.UserEvent.UserData2 == REPLAY_INPUT_UP;
+
+    default:
+        return false;
+    }
+}
+
 
 /**
  * Constructeur du module de gestin des evenements.
@@ -18,9 +73,9 @@ EventsEngine::EventsEngine(Core* core) :
     Module(EVENTS, "Events", core),
     irrEventLogger("Irrlicht", true)
 {
-    l_keyState = new bool[255];
-    for(int i=0; i<255; i++)
-        l_keyState[i] = false;
+    nbDroppedInputs = 0;
+    isOverflowing = 0;
+    deadZone = 0;
 
     loadKeyConfig();
 }
@@ -35,24 +90,47 @@ EventsEngine::~EventsEngine()
 
 
 /**
- * Traitement du module d'evenements
+ * Initialisation du module d'evenements
  */
-void EventsEngine::frame()
+void EventsEngine::begin()
 {
     log("Debut de la gestion des evenements");
 
-    while(core->getIsRunning()) {
-        // Attend que la file d'event ou de message ne soit plus vide
-        boost::mutex::scoped_lock lockQueue(mutexQueue);
-        while(event_queue.empty() && message_queue.empty())
-            condQueue.wait(lockQueue);
-        lockQueue.unlock();
+    if(core->getRecorder()->getMode() == RECORDER_REPLAY)
+        replayThread = boost::thread(
+                boost::bind(&EventsEngine::replayInputs, this));
+}
+
+
+/**
+ * Traitement du module d'evenements
+ *
+ * @return          true
+ */
+bool EventsEngine::step()
+{
+    // Traitement des messages
+    processQueue();
+
+    // Traitement des events
+    processEventQueue();
+
+    return true;
+}
+
 
-        // Traitement des messages
-        processQueue();
+/**
+ * Fin du module d'evenements
+ */
+void EventsEngine::end()
+{
+    replayThread.interrupt();
+    replayThread.join();
 
-        // Traitement des events
-        processEventQueue();
+    if(nbDroppedInputs) {
+        ostringstream stats;
+        stats << "Events perdus (file pleine): " << nbDroppedInputs;
+        log(stats.str());
     }
 
     log("Fin de la gestion des evenements");
@@ -60,7 +138,19 @@ void EventsEngine::frame()
 
 
 /**
- * Charge la config du module
+ * Indique si le module n'a rien a traiter
+ *
+ * @return          true si aucun message ni event n'est en attente
+ */
+bool EventsEngine::isIdle()
+{
+    return Module::isIdle() && inputBuffer.empty()
+        && !atomicLoad(isOverflowing);
+}
+
+
+/**
+ * Charge la config du module et compile la table d'affectations
  */
 void EventsEngine::loadKeyConfig()
 {
@@ -74,7 +164,24 @@ void EventsEngine::loadKeyConfig()
     if(config.find("shoot") == config.end())  config["shoot"]   = irr::KEY_KEY_E;
     if(config.find("action") == config.end())  config["action"]   = irr::KEY_KEY_A;
 
+    // Affectations secondaires: souris et manette
+    if(config.find("forward2") == config.end())
+        config["forward2"] = INPUT_AXIS_NEGATIVE(irr::SEvent::SJoystickEvent::AXIS_Y);
+    if(config.find("backward2") == config.end())
+        config["backward2"] = INPUT_AXIS_POSITIVE(irr::SEvent::SJoystickEvent::AXIS_Y);
+    if(config.find("left2") == config.end())
+        config["left2"] = INPUT_AXIS_NEGATIVE(irr::SEvent::SJoystickEvent::AXIS_X);
+    if(config.find("right2") == config.end())
+        config["right2"] = INPUT_AXIS_POSITIVE(irr::SEvent::SJoystickEvent::AXIS_X);
+    if(config.find("shoot2") == config.end())   config["shoot2"]   = irr::KEY_LBUTTON;
+    if(config.find("shoot3") == config.end())   config["shoot3"]   = INPUT_JOYSTICK_BUTTON + 1;
+    if(config.find("action2") == config.end())  config["action2"]  = INPUT_JOYSTICK_BUTTON;
+    if(config.find("deadZone") == config.end()) config["deadZone"] = 8000;
+
     core->saveConfig("KEYS", config);
+
+    deadZone = config["deadZone"];
+    bindings.build(config);
 }
 
 
@@ -109,54 +216,264 @@ bool EventsEngine::OnEvent(const irr::SEvent& event)
         return true;
 
     default:
-        boost::mutex::scoped_lock l(mutexQueue);
-        event_queue.push(event);
-        l.unlock();
+        // En relecture, seules les entrées du journal sont prises en compte
+        if(core->getRecorder()->getMode() == RECORDER_REPLAY)
+            return false;
 
-        condQueue.notify_one();
+        recordInput(event);
+        pushEvent(event);
         return false;
     }
 }
 
 
 /**
- * Traite la file d'events
+ * Date un event, l'ajoute a la file et réveille le module.
+ * Sans verrou tant que la file ne déborde pas: appelé depuis le thread de
+ * RenderingEngine et celui de relecture.
+ *
+ * @param event         Event a traiter
  */
-void EventsEngine::processEventQueue() {
-    while(true) {
-        if(event_queue.empty())
+void EventsEngine::pushEvent(const irr::SEvent& event)
+{
+    // Pas traités ici: seule compte la derniére position, lue par le rendu
+    if(event.EventType == irr::EET_MOUSE_INPUT_EVENT
+            && event.MouseInput.Event == irr::EMIE_MOUSE_MOVED)
+        return;
+
+    InputEvent input;
+    input.event = event;
+    input.time = TimeService::now();
+    input.gameTime = core->getTimeService()->getGameTime();
+
+    if((atomicLoad(isOverflowing) || !inputBuffer.push(input))
+            && !pushOverflow(input)) {
+        atomicAdd(nbDroppedInputs, 1);
+        return;
+    }
+
+    // Ne réveille le module que s'il dort
+    atomicFence();
+    if(atomicLoad(isWaiting))
+        wakeUp();
+}
+
+
+/**
+ * Ajoute un event a la file de débordement. Au dela de INPUT_BUFFER_SIZE
+ * events en attente, seuls les relâchements sont gardés.
+ *
+ * @param input         Event daté
+ *
+ * @return              false si l'event est perdu
+ */
+bool EventsEngine::pushOverflow(const InputEvent& input)
+{
+    boost::mutex::scoped_lock l(mutexOverflow);
+
+    // Débordement traité entre temps: la file a de nouveau de la place
+    if(!atomicLoad(isOverflowing) && inputBuffer.push(input))
+        return true;
+
+    if(l_overflow.size() >= INPUT_BUFFER_SIZE && !isRelease(input.event))
+        return false;
+
+    l_overflow.push_back(input);
+    atomicStore(isOverflowing, 1);
+    return true;
+}
+
+
+/**
+ * Enregistre les entrées utiles a la relecture: touches clavier,
+ * clics sur les boutons de la GUI et, en partie, position du curseur
+ * (visée et sélection des entités)
+ *
+ * @param event         Event recu
+ */
+void EventsEngine::recordInput(const irr::SEvent& event)
+{
+    MessageRecorder* recorder = core->getRecorder();
+    if(recorder->getMode() != RECORDER_RECORD)
+        return;
+
+    switch(event.EventType) {
+    case irr::EET_KEY_INPUT_EVENT:
+        recorder->recordInput(RECORD_KEY, event.KeyInput.Key,
+                event.KeyInput.PressedDown, core->isPartieEnCours());
+        break;
+
+    case irr::EET_GUI_EVENT:
+        if(event.GUIEvent.EventType != irr::gui::EGET_BUTTON_CLICKED)
+            break;
+
+        recorder->recordInput(RECORD_GUI_BUTTON,
+                event.GUIEvent.Caller->getID(), true,
+                core->isPartieEnCours());
+        break;
+
+    case irr::EET_MOUSE_INPUT_EVENT:
+        if(event.MouseInput.Event != irr::EMIE_MOUSE_MOVED
+                || !core->isPartieEnCours())
             break;
 
-        boost::mutex::scoped_lock l(mutexQueue);
-        irr::SEvent e = event_queue.front();
-        event_queue.pop();
-        l.unlock();
+        recorder->recordInput(RECORD_CURSOR, RECORD_CURSOR_VALUE(
+                event.MouseInput.X, event.MouseInput.Y), false, true);
+        break;
 
-        processEvent(e);
+    default: break;
+    }
+}
+
+
+/**
+ * Thread de relecture: réinjecte les entrées du journal en respectant
+ * leurs écarts d'origine. Une entrée enregistrée pendant une partie
+ * attend que la partie soit lancée, le temps de chargement du niveau
+ * pouvant varier d'une version a l'autre, et que GameEngine ait simulé
+ * les pas enregistrés avant elle.
+ * Les déplacements ne dépendent pas de ce rythme: GameEngine les relit
+ * lui même au pas enregistré, et ignore ceux envoyés par ce module.
+ * Arrête l'application a la fin du journal.
+ */
+void EventsEngine::replayInputs()
+{
+    MessageRecorder* recorder = core->getRecorder();
+    InputRecord input;
+
+    boost::uint64_t debut = TimeService::now();
+    irr::u32 nbInputs = 0;
+
+    try {
+        while(recorder->nextInput(input)) {
+            // Attente du lancement de la partie (chargement du niveau)
+            if(input.partieEnCours && !core->isPartieEnCours()) {
+                boost::uint64_t attente = TimeService::now();
+                while(!core->isPartieEnCours())
+                    boost::this_thread::sleep(
+                            boost::posix_time::milliseconds(1));
+
+                debut += TimeService::now() - attente;
+            }
+
+            // Déplacement appliqué par GameEngine au pas enregistré: les
+            // entrées suivantes attendent ce pas, puis gardent leur écart
+            // avec lui
+            if(input.type == RECORD_TICK_INPUT) {
+                while(recorder->getReplayTick() < input.tick)
+                    boost::this_thread::sleep(
+                            boost::posix_time::milliseconds(1));
+
+                debut = TimeService::now() - input.time;
+                continue;
+            }
+
+            // Respecte l'écart d'origine
+            boost::uint64_t maintenant = TimeService::now() - debut;
+            if(input.time > maintenant)
+                boost::this_thread::sleep(boost::posix_time::microseconds(
+                        (long)((input.time - maintenant) / 1000)));
+
+            irr::SEvent event;
+            if(input.type == RECORD_KEY) {
+                event.EventType = irr::EET_KEY_INPUT_EVENT;
+                event.KeyInput.Key = (irr::EKEY_CODE)input.value;
+                event.KeyInput.PressedDown = input.pressedDown;
+                event.KeyInput.Char = 0;
+                event.KeyInput.Shift = false;
+                event.KeyInput.Control = false;
+            } else if(input.type == RECORD_INPUT) {
+                event.EventType = irr::EET_USER_EVENT;
+                event.UserEvent.UserData1 = input.value;
+                event.UserEvent.UserData2 =
+                        input.pressedDown ? REPLAY_INPUT_DOWN : REPLAY_INPUT_UP;
+            } else if(input.type == RECORD_CURSOR) {
+                event.EventType = irr::EET_USER_EVENT;
+                event.UserEvent.UserData1 = input.value;
+                event.UserEvent.UserData2 = REPLAY_CURSOR;
+            } else {
+                event.EventType = irr::EET_USER_EVENT;
+                event.UserEvent.UserData1 = input.value;
+                event.UserEvent.UserData2 = REPLAY_GUI_BUTTON;
+            }
+
+            pushEvent(event);
+            nbInputs++;
+        }
+    } catch(boost::thread_interrupted&) {
+        return;
+    }
+
+    ostringstream stats;
+    stats << "Fin de la relecture: " << nbInputs << " entrees rejouees";
+    log(stats.str());
+
+    core->stop();
+}
+
+
+/**
+ * Traite la file d'events, puis son débordement: les events débordés sont
+ * arrivés aprés tout ceux de la file
+ */
+void EventsEngine::processEventQueue() {
+    InputEvent input;
+
+    while(inputBuffer.pop(input))
+        processEvent(input);
+
+    if(!atomicLoad(isOverflowing))
+        return;
+
+    vector<InputEvent> l_input;
+    {
+        boost::mutex::scoped_lock l(mutexOverflow);
+        l_input.swap(l_overflow);
+        atomicStore(isOverflowing, 0);
     }
+
+    for(irr::u32 i=0; i<l_input.size(); i++)
+        processEvent(l_input[i]);
 }
 
 
 /**
  * Traitement d'un event
  *
- * @param event         Event a traiter
+ * @param input         Event daté a traiter
  */
-void EventsEngine::processEvent(irr::SEvent& event)
+void EventsEngine::processEvent(InputEvent& input)
 {
+    irr::SEvent& event = input.event;
+
     switch(event.EventType) {
         case irr::EET_MOUSE_INPUT_EVENT:    // SOURIS
-            //processMouseEvent(event);
+            processMouseEvent(input);
+            break;
+
+        case irr::EET_JOYSTICK_INPUT_EVENT: // MANETTE
+            processJoystickEvent(input);
             break;
 
         case irr::EET_KEY_INPUT_EVENT:      // CLAVIER
-            processKeyboardEvent(event);
+            processKeyboardEvent(input);
             break;
 
         case irr::EET_GUI_EVENT:            // GUI
             processGUIEvent(event);
             break;
 
+        case irr::EET_USER_EVENT:           // RELECTURE
+            if(event.UserEvent.UserData2 == REPLAY_GUI_BUTTON)
+                processGUIButton(event.UserEvent.UserData1);
+            else if(event.UserEvent.UserData2 == REPLAY_INPUT_DOWN
+                    || event.UserEvent.UserData2 == REPLAY_INPUT_UP)
+                processInput(input, event.UserEvent.UserData1,
+                        event.UserEvent.UserData2 == REPLAY_INPUT_DOWN);
+            else if(event.UserEvent.UserData2 == REPLAY_CURSOR)
+                processReplayCursor(event.UserEvent.UserData1);
+            break;
+
         default: break;
     }
 }
@@ -165,16 +482,17 @@ void EventsEngine::processEvent(irr::SEvent& event)
 /**
  * Traitement des events keyboard
  *
- * @param event         Event keyboard a traiter
+ * @param input         Event keyboard daté a traiter
  */
-void EventsEngine::processKeyboardEvent(irr::SEvent& event)
+void EventsEngine::processKeyboardEvent(InputEvent& input)
 {
+    irr::SEvent& event = input.event;
+    irr::u32 changes;
+
     // Verifie que la touche a changé d'état depuis le dernier appel
-    if(l_keyState[event.KeyInput.Key] == event.KeyInput.PressedDown)
+    if(!bindings.setInput(event.KeyInput.Key, event.KeyInput.PressedDown, changes))
         return;
 
-    l_keyState[event.KeyInput.Key] = event.KeyInput.PressedDown;
-
     module_message msg = module_message(getId(), GUI, ACTION_MENU_ON_ESCAPE);
 
     switch(event.KeyInput.Key) {
@@ -185,14 +503,117 @@ void EventsEngine::processKeyboardEvent(irr::SEvent& event)
         core->sendMessage(msg);
         break;
 
+    case irr::KEY_F12:
+        // Ecrit les statistiques de traçage des messages
+        if(event.KeyInput.PressedDown)
+            core->dumpStatistics(STATISTICS_FILE);
+        break;
+
     default:
-        if(core->isPartieEnCours() && !core->isPartieEnPause())
-            processGameEvent(event);
+        if(changes && core->getGameState().isPartieActive())
+            processGameEvent(input, changes);
         break;
     }
 }
 
 
+/**
+ * Traitement des boutons de la souris, vus comme les touches KEY_LBUTTON,
+ * KEY_RBUTTON et KEY_MBUTTON
+ *
+ * @param input         Event souris daté a traiter
+ */
+void EventsEngine::processMouseEvent(InputEvent& input)
+{
+    switch(input.event.MouseInput.Event) {
+    case irr::EMIE_LMOUSE_PRESSED_DOWN:
+        processInput(input, irr::KEY_LBUTTON, true);
+        break;
+    case irr::EMIE_RMOUSE_PRESSED_DOWN:
+        processInput(input, irr::KEY_RBUTTON, true);
+        break;
+    case irr::EMIE_MMOUSE_PRESSED_DOWN:
+        processInput(input, irr::KEY_MBUTTON, true);
+        break;
+    case irr::EMIE_LMOUSE_LEFT_UP:
+        processInput(input, irr::KEY_LBUTTON, false);
+        break;
+    case irr::EMIE_RMOUSE_LEFT_UP:
+        processInput(input, irr::KEY_RBUTTON, false);
+        break;
+    case irr::EMIE_MMOUSE_LEFT_UP:
+        processInput(input, irr::KEY_MBUTTON, false);
+        break;
+
+    default: break;
+    }
+}
+
+
+/**
+ * Traitement de l'état de la premiére manette. Chaque sens d'un axe est
+ * une entrée, enfoncée au dela de la zone morte.
+ *
+ * @param input         Event manette daté a traiter
+ */
+void EventsEngine::processJoystickEvent(InputEvent& input)
+{
+    const irr::SEvent::SJoystickEvent& joystick = input.event.JoystickEvent;
+
+    if(joystick.Joystick != 0)
+        return;
+
+    for(irr::u32 i=0; i<irr::SEvent::SJoystickEvent::NUMBER_OF_BUTTONS; i++)
+        processInput(input, INPUT_JOYSTICK_BUTTON + i,
+                joystick.IsButtonPressed(i));
+
+    for(irr::u32 i=0; i<irr::SEvent::SJoystickEvent::NUMBER_OF_AXES; i++) {
+        processInput(input, INPUT_AXIS_POSITIVE(i), joystick.Axis[i] > deadZone);
+        processInput(input, INPUT_AXIS_NEGATIVE(i), joystick.Axis[i] < -deadZone);
+    }
+}
+
+
+/**
+ * Change l'état d'une entrée souris ou manette, l'enregistre pour la
+ * relecture et transmet les actions modifiées
+ *
+ * @param input         Event daté d'origine
+ * @param code          Code d'entrée (voir KeyBindings)
+ * @param down          true si l'entrée est enfoncée
+ */
+void EventsEngine::processInput(InputEvent& input, irr::u32 code, bool down)
+{
+    irr::u32 changes;
+
+    if(!bindings.setInput(code, down, changes))
+        return;
+
+    core->getRecorder()->recordInput(RECORD_INPUT, code, down,
+            core->isPartieEnCours());
+
+    if(changes && core->getGameState().isPartieActive())
+        processGameEvent(input, changes);
+}
+
+
+/**
+ * Transmet a RenderingEngine la position du curseur relue dans le journal.
+ * Même voie que ACTION_PLAYER_ACTION: la position arrive avant l'action
+ * qui la suit.
+ *
+ * @param value         Position enregistrée (RECORD_CURSOR_VALUE)
+ */
+void EventsEngine::processReplayCursor(irr::s32 value)
+{
+    module_message msg(getId(), RENDERING, ACTION_CURSOR_MOVED);
+    msg.data.cursor.x = RECORD_CURSOR_X(value);
+    msg.data.cursor.y = RECORD_CURSOR_Y(value);
+
+    core->sendMessage(msg);
+}
+
+
 /**
  * Traitement des events en rapport avec la GUI
  *
@@ -200,121 +621,130 @@ void EventsEngine::processKeyboardEvent(irr::SEvent& event)
  */
 void EventsEngine::processGUIEvent(irr::SEvent& event)
 {
-    module_message msg = module_message(getId(), GUI, ACTION_MENU_ON_ESCAPE);
-
     switch(event.GUIEvent.EventType) {
     case irr::gui::EGET_BUTTON_CLICKED:
-        switch(event.GUIEvent.Caller->getID()) {
-        //*************************************
-        // MAIN MENU
-        //*************************************
-        case GUI_MAINMENU_JOUER:
-            core->setMenuState(IN_CHOOSE_LEVEL_MENU);
-            break;
+        processGUIButton(event.GUIEvent.Caller->getID());
+        break;
 
-        case GUI_MAINMENU_OPTIONS:
-            core->setMenuState(IN_OPTIONS_MENU);
-            break;
+    default: break;
+    }
+}
 
-        case GUI_MAINMENU_QUITTER:
-            msg = module_message(getId(), GUI, ACTION_MENU_ON_ESCAPE);
-            core->sendMessage(msg);
-            return;
-
-        //*************************************
-        // MENU CHOOSE LEVEL
-        //*************************************
-        case GUI_CHOOSELEVELMENU_NIVEAU1:
-        case GUI_CHOOSELEVELMENU_NIVEAU2:
-        case GUI_CHOOSELEVELMENU_NIVEAU3:
-        case GUI_CHOOSELEVELMENU_NIVEAU4:
-        case GUI_CHOOSELEVELMENU_NIVEAU5:
-        case GUI_CHOOSELEVELMENU_NIVEAU6:
-            core->setMenuState(IN_GAME);
-            msg = module_message(getId(), GAME, ACTION_NOUVELLE_PARTIE);
-            msg.intData["niveau"] = event.GUIEvent.Caller->getID();
-            msg.intData["niveau"] -= GUI_CHOOSELEVELMENU_NIVEAU1;
-            core->sendMessage(msg);
-            break;
 
-        case GUI_CHOOSELEVELMENU_RETOUR:
-            msg = module_message(getId(), GUI, ACTION_MENU_ON_ESCAPE);
-            core->sendMessage(msg);
-            break;
+/**
+ * Traitement d'un clic sur un bouton de la GUI
+ *
+ * @param id            Identifiant du bouton (EnumCodeMenuItems)
+ */
+void EventsEngine::processGUIButton(irr::s32 id)
+{
+    module_message msg = module_message(getId(), GUI, ACTION_MENU_ON_ESCAPE);
 
-        //*************************************
-        // MENU OPTIONS
-        //*************************************
-        case GUI_OPTIONSMENU_KEYS_APPLIQUER:
-        case GUI_OPTIONSMENU_VIDEO_APPLIQUER:
-            msg = module_message(getId(), RENDERING, ACTION_SAVE_CONFIG);
-            core->sendMessage(msg);
-            break;
+    switch(id) {
+    //*************************************
+    // MAIN MENU
+    //*************************************
+    case GUI_MAINMENU_JOUER:
+        core->setMenuState(IN_CHOOSE_LEVEL_MENU);
+        break;
 
-        case GUI_OPTIONSMENU_RETOUR:
-            msg = module_message(getId(), GUI, ACTION_MENU_ON_ESCAPE);
-            core->sendMessage(msg);
-            break;
+    case GUI_MAINMENU_OPTIONS:
+        core->setMenuState(IN_OPTIONS_MENU);
+        break;
 
-        //*************************************
-        // MENU PAUSE
-        //*************************************
-        case GUI_PAUSEMENU_CONTINUER:
-            msg = module_message(getId(), GUI, ACTION_MENU_ON_ESCAPE);
-            core->sendMessage(msg);
-            break;
+    case GUI_MAINMENU_QUITTER:
+        msg = module_message(getId(), GUI, ACTION_MENU_ON_ESCAPE);
+        core->sendMessage(msg);
+        return;
 
-        case GUI_PAUSEMENU_OPTIONS:
-            core->setMenuState(IN_OPTIONS_MENU);
-            break;
+    //*************************************
+    // MENU CHOOSE LEVEL
+    //*************************************
+    case GUI_CHOOSELEVELMENU_NIVEAU1:
+    case GUI_CHOOSELEVELMENU_NIVEAU2:
+    case GUI_CHOOSELEVELMENU_NIVEAU3:
+    case GUI_CHOOSELEVELMENU_NIVEAU4:
+    case GUI_CHOOSELEVELMENU_NIVEAU5:
+    case GUI_CHOOSELEVELMENU_NIVEAU6:
+        msg = module_message(getId(), GAME, ACTION_NOUVELLE_PARTIE);
+        msg.data.nouvellePartie.niveau = id;
+        msg.data.nouvellePartie.niveau -= GUI_CHOOSELEVELMENU_NIVEAU1;
+        core->sendMessage(msg);
+        break;
 
-        case GUI_PAUSEMENU_QUITTERPARTIE:
-            core->setMenuState(IN_MAIN_MENU);
-            msg = module_message(getId(), GAME, ACTION_QUITTER_PARTIE);
-            core->sendMessage(msg);
-            break;
+    case GUI_CHOOSELEVELMENU_RETOUR:
+        msg = module_message(getId(), GUI, ACTION_MENU_ON_ESCAPE);
+        core->sendMessage(msg);
+        break;
 
-        case GUI_PAUSEMENU_QUITTER:
-            core->stop();
-            return;
+    //*************************************
+    // MENU OPTIONS
+    //*************************************
+    case GUI_OPTIONSMENU_KEYS_APPLIQUER:
+    case GUI_OPTIONSMENU_VIDEO_APPLIQUER:
+        msg = module_message(getId(), RENDERING, ACTION_SAVE_CONFIG);
+        core->sendMessage(msg);
+        break;
 
-        default: return;
-        }
+    case GUI_OPTIONSMENU_RETOUR:
+        msg = module_message(getId(), GUI, ACTION_MENU_ON_ESCAPE);
+        core->sendMessage(msg);
+        break;
+
+    //*************************************
+    // MENU PAUSE
+    //*************************************
+    case GUI_PAUSEMENU_CONTINUER:
+        msg = module_message(getId(), GUI, ACTION_MENU_ON_ESCAPE);
+        core->sendMessage(msg);
+        break;
+
+    case GUI_PAUSEMENU_OPTIONS:
+        core->setMenuState(IN_OPTIONS_MENU);
         break;
 
+    case GUI_PAUSEMENU_QUITTERPARTIE:
+        core->setMenuState(IN_MAIN_MENU);
+        msg = module_message(getId(), GAME, ACTION_QUITTER_PARTIE);
+        core->sendMessage(msg);
+        break;
+
+    case GUI_PAUSEMENU_QUITTER:
+        core->stop();
+        return;
+
     default: break;
     }
 }
 
 
 /**
- * Gére les events d'une partie en cours
+ * Transmet les actions du joueur qui ont changé d'état. Les messages portent
+ * la date de capture de l'event.
  *
- * @param event         Event GUI a traiter
+ * @param input         Event daté a l'origine du changement
+ * @param changes       Actions (bits de EnumCodePlayerAction) modifiées
  */
-void EventsEngine::processGameEvent(irr::SEvent& event)
+void EventsEngine::processGameEvent(InputEvent& input, irr::u32 changes)
 {
-    irr::EKEY_CODE key = event.KeyInput.Key;
-    bool isDown = l_keyState[key];
-
-    module_message msg(getId(), GAME, ACTION_AUCUNE);
-
-    if(config["forward"] == key) {
-        if(isDown)  msg.codeAction = ACTION_START_WALKING_FORWARDS;
-        else        msg.codeAction = ACTION_STOP_WALKING_FORWARDS;
-    } else if(config["backward"] == key) {
-        if(isDown)  msg.codeAction = ACTION_START_WALKING_BACKWARDS;
-        else        msg.codeAction = ACTION_STOP_WALKING_BACKWARDS;
-    } else if(config["left"] == key) {
-        if(isDown)  msg.codeAction = ACTION_START_STRAFE_LEFT;
-        else        msg.codeAction = ACTION_STOP_STRAFE_LEFT;
-    } else if(config["right"] == key) {
-        if(isDown)  msg.codeAction = ACTION_START_STRAFE_RIGHT;
-        else        msg.codeAction = ACTION_STOP_STRAFE_RIGHT;
-    } else if(config["action"] == key) {
-        msg.codeAction = ACTION_PLAYER_ACTION;
-    } else
-        return;
+    module_message msg(getId(), getId(), ACTION_AUCUNE);
 
-    core->sendMessage(msg);
+    msg.data.input.time = input.time;
+    msg.data.input.gameTime = input.gameTime;
+
+    for(irr::u32 action=0; changes; action++, changes >>= 1) {
+        if(!(changes & 1))
+            continue;
+
+        if(bindings.isActionDown((EnumCodePlayerAction)action))
+            msg.codeAction = l_startAction[action];
+        else
+            msg.codeAction = l_stopAction[action];
+
+        if(msg.codeAction == ACTION_AUCUNE)
+            continue;
+
+        // Publié: GameEngine et RenderingEngine sont abonnés
+        core->publish(msg);
+    }
 }
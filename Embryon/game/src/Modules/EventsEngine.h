@@ -5,9 +5,13 @@
 #define EVENTSENGINE_H
 
 #include <irrlicht.h>
-#include <boost/thread/mutex.hpp>
+#include <vector>
+#include <boost/thread.hpp>
 
 #include "Module.h"
+#include "../KeyBindings.h"
+
+#define INPUT_BUFFER_SIZE   1024    // Events en attente (puissance de 2)
 
 using namespace std;
 
@@ -15,12 +19,37 @@ class Core;
 class GUIEngine;
 
 
+/** \struct InputEvent
+ *  \brief  Event Irrlicht daté de sa capture.
+ */
+struct InputEvent {
+    irr::SEvent event;
+    boost::uint64_t time;           // TimeService::now
+    boost::uint64_t gameTime;       // Horloge de jeu
+};
+
+
 /** \class  EventsEngine
  *  \brief  Gére les événements clavier, souris, log
  *          (Irrlicht) et GUI (Irrlicht).
  *
  * Les événements GUI sont relayés vers GUIEngine s'ils sont trop complexe
  * (sauvegarde d'options, ...).
+ *
+ * Clavier, boutons de la souris et manette passent par la même table
+ * d'affectations (KeyBindings), recompilée a chaque rechargement de la
+ * section KEYS.
+ *
+ * Irrlicht appelle OnEvent depuis le thread de RenderingEngine: l'event y
+ * est seulement daté puis déposé dans une file sans verrou, le traitement
+ * se fait dans le thread du module. Les déplacements envoyés a GameEngine
+ * gardent leur date de capture, la simulation les applique au pas
+ * correspondant.
+ *
+ * Les mouvements de la souris ne sont pas mis en file (le rendu lit le
+ * curseur). Si la file est pleine, les relâchements de touches et de
+ * boutons vont dans une file de débordement, traitée dans l'ordre aprés
+ * elle: une touche ne reste jamais enfoncée.
  */
 class EventsEngine :
     public Module,
@@ -32,25 +61,46 @@ class EventsEngine :
 
         virtual bool OnEvent(const irr::SEvent& event);
 
-        void frame();
+        void begin();
+        bool step();
+        void end();
 
         void loadKeyConfig();
     protected:
     private:
-        bool *l_keyState;       // Etat des touches
-        map<EnumCodePlayerAction, irr::EKEY_CODE> l_keyAffectation;
+        KeyBindings bindings;   // Compilée depuis la section KEYS
+        irr::s32 deadZone;      // Zone morte des axes de la manette
 
         Logger irrEventLogger;
 
-        queue<irr::SEvent> event_queue;
+        RingBuffer<InputEvent, INPUT_BUFFER_SIZE> inputBuffer;
+        volatile irr::u32 nbDroppedInputs;
+
+        // Débordement de inputBuffer: tant qu'il n'est pas vidé, tout les
+        // events y passent pour garder leur ordre
+        boost::mutex mutexOverflow;
+        vector<InputEvent> l_overflow;
+        volatile irr::u32 isOverflowing;
+
+        // Relecture d'une session enregistrée
+        boost::thread replayThread;
+        void replayInputs();
+        void recordInput(const irr::SEvent& event);
 
+        bool isIdle();
+        void pushEvent(const irr::SEvent& event);
+        bool pushOverflow(const InputEvent& input);
         void processEventQueue();
-        void processEvent(irr::SEvent& event);
-        void processMouseEvent(irr::SEvent& event);
-        void processKeyboardEvent(irr::SEvent& event);
+        void processEvent(InputEvent& input);
+        void processMouseEvent(InputEvent& input);
+        void processJoystickEvent(InputEvent& input);
+        void processKeyboardEvent(InputEvent& input);
+        void processInput(InputEvent& input, irr::u32 code, bool down);
+        void processReplayCursor(irr::s32 value);
         void processGUIEvent(irr::SEvent& event);
+        void processGUIButton(irr::s32 id);
 
-        void processGameEvent(irr::SEvent& event);
+        void processGameEvent(InputEvent& input, irr::u32 changes);
 
         void processMessage(module_message& msg);
 };
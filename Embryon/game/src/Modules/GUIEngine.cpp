@@ -15,6 +15,10 @@ GUIEngine::GUIEngine(Core* core) :
     Module(GUI, "Gui", core)
 {
     l_GUIPage = core->getGUIPages();
+
+    // Suit le menu affiché sans interroger le Core
+    core->subscribe(this, TOPIC_MASK(TOPIC_GAME_STATE));
+    gameState = core->getGameState();
 }
 
 /**
@@ -27,23 +31,19 @@ GUIEngine::~GUIEngine()
 
 
 /**
- * Traitement du module
+ * Initialisation du module
  */
-void GUIEngine::frame()
+void GUIEngine::begin()
 {
     log("Debut de la gestion de la GUI");
+}
 
-    while(core->getIsRunning()) {
-        // Attend que la file de message ne soit plus vide
-        boost::mutex::scoped_lock lockQueue(mutexQueue);
-        while(message_queue.empty())
-            condQueue.wait(lockQueue);
-        lockQueue.unlock();
-
-        // Traitement des messages
-        processQueue();
-    }
 
+/**
+ * Fin du module
+ */
+void GUIEngine::end()
+{
     log("Fin de la gestion de la GUI");
 }
 
@@ -56,8 +56,14 @@ void GUIEngine::frame()
 void GUIEngine::processMessage(module_message& msg)
 {
     switch(msg.codeAction) {
+    case ACTION_GAME_STATE_CHANGED:
+        // Ignore une notification dépassée
+        if(GameState(msg.data.gameState.nouveau).isNewerThan(gameState))
+            gameState = GameState(msg.data.gameState.nouveau);
+        break;
+
     case ACTION_MENU_ON_ESCAPE:
-        (*l_GUIPage)[core->getMenuState()]->onEscape();
+        (*l_GUIPage)[gameState.getMenuState()]->onEscape();
         break;
 
     default: break;
@@ -8,6 +8,7 @@
 
 #include "Module.h"
 #include "../GUI/GUIPage.h"
+#include "../Core/GameState.h"
 
 using namespace std;
 
@@ -27,11 +28,15 @@ class GUIEngine : public Module
         GUIEngine(Core* core);
         virtual ~GUIEngine();
 
-        void frame();
+        void begin();
+        void end();
     protected:
     private:
         map<EnumGameState, GUIPage*>* l_GUIPage;
 
+        // Etat du jeu au dernier ACTION_GAME_STATE_CHANGED
+        GameState gameState;
+
         void processMessage(module_message& msg);
 
         void saveOptions();
@@ -3,6 +3,9 @@
  */
 #include "GameEngine.h"
 
+#include <algorithm>
+#include <set>
+#include <sstream>
 #include <boost/thread.hpp>
 #include <boost/date_time.hpp>
 
@@ -17,7 +20,28 @@
 GameEngine::GameEngine(Core* core) :
     Module(GAME, "Game", core)
 {
-    //ctor
+    // TOPIC_GAME_STATE: la fin du chargement d'un niveau relance la
+    // simulation endormie dans wait
+    core->subscribe(this,
+            TOPIC_MASK(TOPIC_PLAYER_MOVE) |
+            TOPIC_MASK(TOPIC_GAME_STATE)
+    );
+
+    tickDuration = 1000000000ULL / TICK_RATE;
+    subSteps = 1;
+    accumulator = 0;
+    lastSimulation = 0;
+    simulatedTime = 0;
+    nbTicks = 0;
+    nbDroppedTicks = 0;
+
+    inputTick = 0;
+    nbTickInputs = 0;
+
+    fullSpeed = false;
+    maxTicks = 0;
+    firstTick = 0;
+    lastTick = 0;
 }
 
 /**
@@ -30,47 +54,380 @@ GameEngine::~GameEngine()
 
 
 /**
- * Traitement du module
+ * Initialisation du module
  */
-void GameEngine::frame()
+void GameEngine::begin()
 {
     log("Debut de la gestion du jeu");
     loadGameConfig();
 
-    while(core->getIsRunning()) {
-        // Attend que la file de message ne soit plus vide
-        boost::mutex::scoped_lock lockQueue(mutexQueue);
-        while(message_queue.empty())
-            condQueue.wait(lockQueue);
-        lockQueue.unlock();
+    tickDuration = 1000000000ULL / config["tickRate"];
+    subSteps = config["subSteps"];
+
+    lastSimulation = core->getTimeService()->getGameTime();
+    simulatedTime = lastSimulation;
+
+    if(core->isHeadless())
+        beginHeadless();
+}
+
+
+/**
+ * Lance la partie du mode headless (section HEADLESS, voir
+ * Core::loadHeadlessConfig)
+ */
+void GameEngine::beginHeadless()
+{
+    map<string, int> headless = core->loadConfig("HEADLESS");
+
+    fullSpeed = headless["fullSpeed"] != 0;
+    maxTicks = headless["ticks"] > 0 ? headless["ticks"] : 0;
+
+    ostringstream mode;
+    mode << "Partie headless: niveau " << headless["level"]
+         << (fullSpeed ? ", pas enchaines sans attendre" : ", pas temps reel");
+    if(maxTicks)
+        mode << ", arret apres " << maxTicks << " pas";
+    log(mode.str());
+
+    newGame(headless["level"]);
+
+    if(headless["walk"])
+        core->getPlayer()->setForwards(true);
+}
+
+
+/**
+ * Traite les messages puis avance la simulation
+ *
+ * @return          true
+ */
+bool GameEngine::step()
+{
+    processQueue();
+    simulate();
+
+    return true;
+}
 
-        // Traitement des messages
-        processQueue();
-    }
+
+/**
+ * Fin du module
+ */
+void GameEngine::end()
+{
+    ostringstream stats;
+    stats << "Pas de simulation: " << nbTicks
+          << ", abandonnes (retard): " << nbDroppedTicks;
+    if(nbTicks > 1 && lastTick > firstTick)
+        stats << ", " << ((nbTicks - 1) * 1000000000.0 / (lastTick - firstTick))
+              << " pas/s";
+    log(stats.str());
+    log("Entree->publication: " + inputLatency.toString());
 
     log("Fin de la gestion du jeu");
 }
 
 
 /**
- * Traitement d'un message recu par le module
+ * Attend un message, ou le prochain pas de simulation si une partie
+ * est en cours
+ */
+void GameEngine::wait()
+{
+    if(!isSimulating()) {
+        waitQueue();
+        return;
+    }
+
+    // Pas enchainés: n'attend que le chargement du niveau
+    if(fullSpeed) {
+        if(!firstTick)
+            waitQueue(tickDuration);
+        return;
+    }
+
+    TimeService* timeService = core->getTimeService();
+    boost::uint64_t ecoule = timeService->getGameTime() - lastSimulation;
+    if(accumulator + ecoule >= tickDuration)
+        return;
+
+    // Temps de jeu restant avant le prochain pas, converti en temps réel
+    boost::uint64_t reste = tickDuration - accumulator - ecoule;
+    irr::f32 echelle = timeService->getTimeScale();
+    waitQueue(echelle > 0 ? (boost::uint64_t)(reste / echelle) : tickDuration);
+}
+
+
+/**
+ * Indique si la simulation doit avancer
  *
- * @param msg           Message recu recu
+ * @return          true si une partie est en cours et n'est pas en pause
  */
-void GameEngine::processMessage(module_message& msg)
+bool GameEngine::isSimulating()
 {
-    switch(msg.codeAction) {
-    case ACTION_NOUVELLE_PARTIE:                // Demarre une partie
-        newGame(msg.intData["niveau"]);
-        break;
+    return core->getGameState().isPartieActive();
+}
 
-    case ACTION_QUITTER_PARTIE:                 // Fin de partie
-        core->setPartieEnCours(false);
-        break;
 
-    //***************************************
-    //  DEPLACEMENTS DU JOUEUR
-    //***************************************
+/**
+ * Avance la simulation par pas fixes de tickDuration, indépendamment de
+ * l'affichage. Le temps non simulé est gardé pour le prochain appel. En cas
+ * de trop gros retard, le surplus est abandonné plutôt que de ralentir
+ * encore le jeu.
+ *
+ * Le temps simulé est celui de l'horloge de jeu: arrêté pendant la pause,
+ * mis a l'échelle du temps (section TIME).
+ */
+void GameEngine::simulate()
+{
+    boost::uint64_t maintenant = core->getTimeService()->getGameTime();
+    boost::uint64_t ecoule = maintenant - lastSimulation;
+    lastSimulation = maintenant;
+
+    if(!isSimulating()) {
+        accumulator = 0;
+        simulatedTime = maintenant;
+        return;
+    }
+
+    // Headless: un pas de tickDuration par appel, aussi vite que possible
+    if(fullSpeed) {
+        applyInputs(maintenant);
+        tick();
+        simulatedTime = maintenant;
+        return;
+    }
+
+    accumulator += ecoule;
+
+    irr::u32 ticks = 0;
+    while(accumulator >= tickDuration) {
+        if(ticks == MAX_TICKS) {
+            nbDroppedTicks += accumulator / tickDuration;
+            accumulator %= tickDuration;
+            break;
+        }
+
+        // Le pas couvre le temps de jeu jusqu'a finPas
+        applyInputs(maintenant - accumulator + tickDuration);
+
+        tick();
+        accumulator -= tickDuration;
+        ticks++;
+    }
+
+    // Le prochain pas couvrira simulatedTime + tickDuration
+    simulatedTime = maintenant - accumulator;
+}
+
+
+/**
+ * Un pas de simulation: déplace le joueur en subSteps balayages de
+ * collision, déclenche les entités nouvellement touchées, avance les entités
+ * puis publie le WorldSnapshot du pas
+ *
+ * @return          false si le niveau n'est pas encore chargé
+ */
+bool GameEngine::tick()
+{
+    Player* player = core->getPlayer();
+    Level* level = core->getLevel();
+
+    irr::f32 dt = tickDuration / 1000000.0f;      // ms
+    irr::core::vector3df position = player->getPosition();
+    irr::core::vector3df deplacement =
+            player->getDeplacement(dt) / (irr::f32)subSteps;
+
+    for(irr::u32 i=0; i<subSteps; i++) {
+        irr::s32 cibleId;
+        irr::core::vector3df ciblePosition;
+
+        // Niveau pas encore chargé
+        if(!level->collide(position, deplacement, cibleId, ciblePosition))
+            return false;
+
+        if(cibleId != SCENE_NODE_AUCUN)
+            position = player->repousser(cibleId, ciblePosition, position);
+    }
+
+    player->advancePosition(position);
+    nbTicks++;
+
+    // Entités touchées
+    vector<irr::scene::ISceneNode*> l_node;
+    level->getTouchedEntities(position, l_node, core->getJobSystem());
+
+    for(irr::u32 i=0; i<l_node.size(); i++) {
+        if(find(l_touched.begin(), l_touched.end(), l_node[i]) != l_touched.end())
+            continue;
+
+        level->triggerEntityBySceneNode(l_node[i], ENTITY_ACTIVATION_COLLIDE);
+    }
+
+    l_touched.swap(l_node);
+
+    level->update(dt, core->getJobSystem());
+
+    // Publie l'état du monde pour le rendu
+    TripleBuffer<WorldSnapshot>* worldSnapshot = core->getWorldSnapshot();
+    WorldSnapshot& snapshot = worldSnapshot->getWriteBuffer();
+
+    snapshot.tick = nbTicks;
+    snapshot.tickTime = core->getTimeService()->getGameTime();
+    snapshot.tickDuration = tickDuration;
+    player->writeSnapshot(snapshot);
+    level->writeSnapshot(snapshot);
+
+    // Entrées appliquées depuis la derniére publication (mesure de la
+    // latence jusqu'a l'affichage, voir InputLatencyProbe). Elles
+    // s'accumulent jusqu'a ce que le rendu ait lu leur pas: un pas suivant
+    // ne masque pas celles d'un snapshot jamais affiché
+    if(nbTickInputs && core->getInputAck() == inputTick)
+        nbTickInputs = 0;
+
+    if(!l_appliedInput.empty()) {
+        inputTick = nbTicks;
+
+        // Liste pleine: les suivantes ne sont pas mesurées
+        irr::u32 nbAjouts = min((irr::u32)l_appliedInput.size(),
+                (irr::u32)SNAPSHOT_INPUT_MAX - nbTickInputs);
+        copy(l_appliedInput.begin(), l_appliedInput.begin() + nbAjouts,
+                l_tickInput + nbTickInputs);
+        nbTickInputs += nbAjouts;
+    }
+
+    snapshot.inputTick = inputTick;
+    snapshot.nbInputs = nbTickInputs;
+    copy(l_tickInput, l_tickInput + nbTickInputs, snapshot.inputTime);
+
+    worldSnapshot->publish();
+
+    // Latence des entrées appliquées depuis la derniére publication
+    boost::uint64_t publication = TimeService::now();
+    for(irr::u32 i=0; i<l_appliedInput.size(); i++)
+        inputLatency.add((irr::u32)((publication - l_appliedInput[i]) / 1000));
+    l_appliedInput.clear();
+
+    // Durée réelle de la simulation (débit du mode headless)
+    lastTick = TimeService::now();
+    if(!firstTick)
+        firstTick = lastTick;
+
+    if(maxTicks && nbTicks == maxTicks) {
+        log("Nombre de pas demande atteint");
+        core->stop();
+    }
+
+    return true;
+}
+
+
+/**
+ * Applique les déplacements capturés avant la fin d'un pas, dans leur
+ * ordre de capture. Ceux capturés aprés attendent le pas suivant.
+ * Chaque déplacement est journalisé avec le numéro du pas; en relecture,
+ * ce sont ceux du journal qui sont appliqués a ce même pas.
+ *
+ * @param finPas        Temps de jeu atteint a la fin du pas
+ */
+void GameEngine::applyInputs(boost::uint64_t finPas)
+{
+    MessageRecorder* recorder = core->getRecorder();
+    irr::u32 tick = nbTicks + 1;
+
+    if(recorder->getMode() == RECORDER_REPLAY) {
+        EnumCodesAction codeAction;
+        while(recorder->nextTickInput(tick, codeAction)) {
+            module_message msg(getId(), getId(), codeAction);
+            applyInput(msg);
+        }
+        return;
+    }
+
+    irr::u32 nbApplied = 0;
+
+    while(nbApplied < l_input.size()
+            && l_input[nbApplied].data.input.gameTime <= finPas) {
+        applyInput(l_input[nbApplied]);
+        recorder->recordTickInput(tick, l_input[nbApplied].codeAction);
+        l_appliedInput.push_back(l_input[nbApplied].data.input.time);
+        nbApplied++;
+    }
+
+    l_input.erase(l_input.begin(), l_input.begin() + nbApplied);
+}
+
+
+/**
+ * Donne le pas, compté a partir du prochain, qui appliquera un déplacement
+ * (voir applyInputs)
+ *
+ * @param msg           Message de déplacement
+ *
+ * @return              0 pour le prochain pas
+ */
+irr::u32 GameEngine::getInputTick(const module_message& msg)
+{
+    if(msg.data.input.gameTime <= simulatedTime)
+        return 0;
+
+    return (irr::u32)((msg.data.input.gameTime - simulatedTime - 1)
+            / tickDuration);
+}
+
+
+/**
+ * Supprimme les déplacements annulés au sein d'un même lot.
+ * Seul le dernier START/STOP de chaque direction appliqué par un même pas
+ * compte: les précédents n'ont aucun effet puisque le joueur n'est pas
+ * déplacé entre deux entrées d'un pas.
+ *
+ * @param batch         Messages du lot
+ * @param size          Nombre de messages dans le lot
+ */
+void GameEngine::coalesceBatch(module_message* batch, irr::u32 size)
+{
+    set<pair<int, irr::u32> > l_vu;     // Direction, pas
+
+    for(irr::s32 i=size-1; i>=0; i--) {
+        int direction;
+
+        switch(batch[i].codeAction) {
+        case ACTION_START_WALKING_FORWARDS:
+        case ACTION_STOP_WALKING_FORWARDS:
+            direction = AVANCER;
+            break;
+        case ACTION_START_WALKING_BACKWARDS:
+        case ACTION_STOP_WALKING_BACKWARDS:
+            direction = RECULER;
+            break;
+        case ACTION_START_STRAFE_LEFT:
+        case ACTION_STOP_STRAFE_LEFT:
+            direction = GAUCHE;
+            break;
+        case ACTION_START_STRAFE_RIGHT:
+        case ACTION_STOP_STRAFE_RIGHT:
+            direction = DROITE;
+            break;
+        default:
+            continue;
+        }
+
+        if(!l_vu.insert(make_pair(direction, getInputTick(batch[i]))).second)
+            batch[i].codeAction = ACTION_AUCUNE;
+    }
+}
+
+
+/**
+ * Applique un déplacement au joueur
+ *
+ * @param msg           Message de déplacement (ACTION_START_*, ACTION_STOP_*)
+ */
+void GameEngine::applyInput(module_message& msg)
+{
+    switch(msg.codeAction) {
     case ACTION_START_WALKING_FORWARDS:
         core->getPlayer()->setForwards(true);
         break;
@@ -103,9 +460,52 @@ void GameEngine::processMessage(module_message& msg)
         core->getPlayer()->setStrafeRight(false);
         break;
 
-    case ACTION_PLAYER_ACTION:
-        msg.idDestination = RENDERING;
-        core->sendMessage(msg);
+    default: break;
+    }
+}
+
+
+/**
+ * Traitement d'un message recu par le module
+ *
+ * @param msg           Message recu recu
+ */
+void GameEngine::processMessage(module_message& msg)
+{
+    switch(msg.codeAction) {
+    case ACTION_NOUVELLE_PARTIE:                // Demarre une partie
+        newGame(msg.data.nouvellePartie.niveau);
+        break;
+
+    case ACTION_QUITTER_PARTIE:                 // Fin de partie
+        core->setPartieEnCours(false);
+        break;
+
+    case ACTION_PLAYER_SPAWN:                   // Niveau construit
+        core->getPlayer()->setPosition(irr::core::vector3df(
+                msg.data.spawn.x, msg.data.spawn.y, msg.data.spawn.z));
+        break;
+
+    case ACTION_ACTIVATE_ENTITY:
+        core->getLevel()->triggerEntityBySceneNode(
+                msg.data.activation.node, msg.data.activation.type);
+        break;
+
+    //***************************************
+    //  DEPLACEMENTS DU JOUEUR
+    //***************************************
+    case ACTION_START_WALKING_FORWARDS:
+    case ACTION_START_WALKING_BACKWARDS:
+    case ACTION_START_STRAFE_LEFT:
+    case ACTION_START_STRAFE_RIGHT:
+    case ACTION_STOP_WALKING_FORWARDS:
+    case ACTION_STOP_WALKING_BACKWARDS:
+    case ACTION_STOP_STRAFE_LEFT:
+    case ACTION_STOP_STRAFE_RIGHT:
+        // Appliqué au pas de sa date de capture (voir applyInputs). En
+        // relecture, les déplacements viennent du journal
+        if(core->getRecorder()->getMode() != RECORDER_REPLAY)
+            l_input.push_back(msg);
         break;
 
     default: break;
@@ -129,18 +529,20 @@ void GameEngine::newGame(int niveau)
     ostringstream name;
     name << "../../media/maps/niveau" << (niveau+1) << ".pk3";
 
+    l_touched.clear();
+    l_input.clear();
+    l_appliedInput.clear();
+
+    // Ecran de chargement, partie en pause jusqu'a la fin du chargement
+    // (RenderingEngine passe alors en IN_GAME)
+    core->setMenuState(IN_LOADING_MENU);
+    core->setPartieEnCours(true);
+    core->setPartieEnPause(true);
+
     // Chargement du niveau
     module_message msg(getId(), RENDERING, ACTION_INIT_GAME);
-    msg.strData["niveau"] = name.str();
+    module_message::setString(msg.data.initGame.niveau, name.str());
     core->sendMessage(msg);
-
-    // Affichage de la GUI
-    msg = module_message(getId(), GUI, ACTION_CHANGE_MENU);
-    msg.intData["menu"] = IN_GAME;
-    core->sendMessage(msg);
-
-    core->setPartieEnCours(true);
-    core->setPartieEnPause(false);
 }
 
 
@@ -159,5 +561,11 @@ void GameEngine::loadGameConfig()
     if(config.find("level5") == config.end())       config["level5"] = -1;
     if(config.find("level6") == config.end())       config["level6"] = -1;
 
+    if(config.find("tickRate") == config.end())     config["tickRate"] = TICK_RATE;
+    if(config.find("subSteps") == config.end())     config["subSteps"] = 1;
+
+    if(config["tickRate"] <= 0)     config["tickRate"] = TICK_RATE;
+    if(config["subSteps"] <= 0)     config["subSteps"] = 1;
+
     core->saveConfig("GAME", config);
 }
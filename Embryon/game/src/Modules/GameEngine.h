@@ -4,6 +4,7 @@
 #ifndef GAMEENGINE_H
 #define GAMEENGINE_H
 
+#include <vector>
 #include <boost/thread/mutex.hpp>
 
 #include "Module.h"
@@ -23,6 +24,17 @@ class Core;
  *
  * Gére la mise en pause du jeu, la fin des niveaux, le lancement
  * des cinématiques, ...
+ *
+ * Fait avancer la simulation par pas fixes (tickRate, section GAME),
+ * indépendamment de la fréquence d'affichage (fps, section VIDEO).
+ * Les déplacements du joueur sont appliqués au pas qui couvre leur date de
+ * capture, et non a leur réception. Dans un lot de messages, seul le
+ * dernier START/STOP de chaque direction compte pour un même pas.
+ * En relecture (section REPLAY), les déplacements sont relus du journal au
+ * numéro de pas enregistré.
+ *
+ * En mode headless (section HEADLESS), lance lui même une partie et peut
+ * enchainer les pas sans attendre pour les tests de charge.
  */
 class GameEngine : public Module
 {
@@ -30,7 +42,9 @@ class GameEngine : public Module
         GameEngine(Core* core);
         virtual ~GameEngine();
 
-        void frame();
+        void begin();
+        bool step();
+        void end();
 
         // Accesseurs
         bool isPartieEnCours();
@@ -39,8 +53,44 @@ class GameEngine : public Module
         Player* getPlayer();
     protected:
     private:
+        // Simulation a pas fixe
+        boost::uint64_t tickDuration;       // ns
+        irr::u32 subSteps;                  // Balayages de collision par pas
+        boost::uint64_t accumulator;        // Temps a simuler (ns)
+        boost::uint64_t lastSimulation;
+        boost::uint64_t simulatedTime;      // Fin du dernier pas (temps de jeu)
+        irr::u32 nbTicks;
+        irr::u32 nbDroppedTicks;
+
+        // Mode headless
+        bool fullSpeed;                     // Pas enchainés sans attendre
+        irr::u32 maxTicks;                  // 0: pas de limite
+        boost::uint64_t firstTick;
+        boost::uint64_t lastTick;
+        void beginHeadless();
+
+        // Déplacements en attente de leur pas, par date de capture
+        vector<module_message> l_input;
+        vector<boost::uint64_t> l_appliedInput;     // Captures non publiées
+        LatencyHistogram inputLatency;              // Capture -> publication
+        irr::u32 inputTick;                         // Voir WorldSnapshot
+        irr::u32 nbTickInputs;
+        boost::uint64_t l_tickInput[SNAPSHOT_INPUT_MAX];
+        void applyInputs(boost::uint64_t finPas);
+        void applyInput(module_message& msg);
+        irr::u32 getInputTick(const module_message& msg);
+
+        // Entités touchées au pas précédent
+        vector<irr::scene::ISceneNode*> l_touched;
+
+        void wait();
+        bool isSimulating();
+        void simulate();
+        bool tick();
+
         void newGame(int niveau);
 
+        void coalesceBatch(module_message* batch, irr::u32 size);
         void processMessage(module_message& msg);
         void loadGameConfig();
 };
@@ -3,6 +3,8 @@
  */
 #include "Module.h"
 
+#include <sstream>
+
 #include "../Core/Core.h"
 
 
@@ -25,6 +27,20 @@ Module::Module(EnumModuleId id, string name, Core* core) :
     this->core = core;
 
     thread = NULL;
+    cpuTime = 0;
+    isWaiting = 0;
+
+    nbBatches = 0;
+    nbBatchedMessages = 0;
+    nbCoalescedMessages = 0;
+    maxBatchSize = 0;
+    for(int i=0; i<MODULE_BATCH_HISTOGRAM; i++)
+        batchHistogram[i] = 0;
+    for(int i=0; i<LANE_COUNT; i++) {
+        maxQueueDepth[i] = 0;
+        isOverflowing[i] = 0;
+        nbOverflowMessages[i] = 0;
+    }
 
     log("Initialisation du module '" + getName() + "'");
 
@@ -41,37 +57,440 @@ Module::~Module()
 
 
 /**
- * Ajout d'un message dans la file
+ * Boucle principale du module lorsqu'il dispose de son propre thread
+ * (ordonnanceur SCHEDULER_THREADS).
+ */
+void Module::frame()
+{
+    begin();
+
+    while(core->getIsRunning()) {
+        // Attend d'avoir quelque chose a traiter
+        wait();
+
+        if(!runStep())
+            break;
+    }
+
+    end();
+}
+
+
+/**
+ * Appelé une fois avant la premiére étape, depuis le thread qui
+ * exécutera les étapes du module.
+ */
+void Module::begin()
+{
+}
+
+
+/**
+ * Une étape de travail du module. Ne doit jamais bloquer: en mode
+ * coopératif, tout les modules partagent le même thread.
+ * Par défaut, traite les messages en attente.
+ *
+ * @return          false si le module demande l'arrêt de l'application
+ */
+bool Module::step()
+{
+    processQueue();
+    return true;
+}
+
+
+/**
+ * Appelé une fois aprés la derniére étape
+ */
+void Module::end()
+{
+}
+
+
+/**
+ * Exécute une étape en mesurant sa durée
+ *
+ * @return          Valeur retournée par step
+ */
+bool Module::runStep()
+{
+    boost::uint64_t debut = TimeService::now();
+
+    bool continuer = step();
+    stepDuration.add((irr::u32)((TimeService::now() - debut) / 1000));
+
+    return continuer;
+}
+
+
+/**
+ * Attente entre deux étapes en mode thread.
+ * Par défaut, attend l'arrivée d'un message.
+ */
+void Module::wait()
+{
+    waitQueue();
+}
+
+
+/**
+ * Ajout d'un message dans la file.
+ * Peut être appelé depuis n'importe quel thread. Ne bloque pas et ne perd
+ * jamais de message: une file pleine déborde dans l_overflow.
  *
  * @param msg       Message que l'on ajoute
  */
 void Module::pushMessage(module_message& msg)
 {
+    EnumMessageLane lane = msg.getLane();
+    msg.enqueueTime = TimeService::now();
+
+    // Pendant un débordement, les messages le suivent pour rester en ordre
+    if(atomicLoad(isOverflowing[lane]) || !message_queue[lane].push(msg))
+        pushOverflow(msg, lane);
+    else {
+        // Profondeur maximale de la file
+        irr::u32 depth = message_queue[lane].size();
+        irr::u32 max = atomicLoad(maxQueueDepth[lane]);
+        while(depth > max
+                && !atomicCompareAndSwap(maxQueueDepth[lane], max, depth))
+            max = atomicLoad(maxQueueDepth[lane]);
+    }
+
+    // Ne réveille le module que s'il dort
+    atomicFence();
+    if(atomicLoad(isWaiting))
+        wakeUp();
+}
+
+
+/**
+ * Ajoute un message a la file de débordement d'une voie
+ *
+ * @param msg       Message que l'on ajoute
+ * @param lane      Voie du message
+ */
+void Module::pushOverflow(module_message& msg, EnumMessageLane lane)
+{
+    boost::mutex::scoped_lock l(mutexOverflow);
+
+    // Débordement traité entre temps: la file a de nouveau de la place
+    if(!atomicLoad(isOverflowing[lane]) && message_queue[lane].push(msg))
+        return;
+
+    l_overflow[lane].push_back(msg);
+    atomicStore(isOverflowing[lane], 1);
+    nbOverflowMessages[lane]++;
+}
+
+
+/**
+ * Retire les messages en débordement d'une voie, une fois sa file vide:
+ * ils sont plus récents que ceux de la file
+ *
+ * @param lane          Voie a traiter
+ * @param l_message     Reçoit les messages, dans leur ordre d'arrivée
+ *
+ * @return              false s'il n'y en avait pas
+ */
+bool Module::takeOverflow(EnumMessageLane lane, vector<module_message>& l_message)
+{
+    if(!atomicLoad(isOverflowing[lane]) || !message_queue[lane].empty())
+        return false;
+
+    boost::mutex::scoped_lock l(mutexOverflow);
+    l_message.swap(l_overflow[lane]);
+    atomicStore(isOverflowing[lane], 0);
+
+    return !l_message.empty();
+}
+
+
+/**
+ * Attend que le module ait quelque chose a traiter.
+ * Utilisé par les modules bloquants (Game, GUI, Events).
+ */
+void Module::waitQueue()
+{
+    if(!isIdle())
+        return;
+
+    boost::mutex::scoped_lock l(mutexQueue);
+
+    // Prévient les producteurs avant de vérifier une derniére fois la file
+    atomicStore(isWaiting, 1);
+    atomicFence();
+
+    while(isIdle())
+        condQueue.wait(l);
+
+    atomicStore(isWaiting, 0);
+}
+
+
+/**
+ * Attend que le module ait quelque chose a traiter, au plus timeout.
+ * Utilisé par les modules cadencés (simulation).
+ *
+ * @param timeout       Attente maximale (ns)
+ */
+void Module::waitQueue(boost::uint64_t timeout)
+{
+    if(!isIdle())
+        return;
+
+    boost::system_time limite = boost::get_system_time() +
+            boost::posix_time::microseconds((long)(timeout / 1000));
+
     boost::mutex::scoped_lock l(mutexQueue);
-    message_queue.push(msg);
-    l.unlock();
 
+    atomicStore(isWaiting, 1);
+    atomicFence();
+
+    while(isIdle()) {
+        if(!condQueue.timed_wait(l, limite))
+            break;
+    }
+
+    atomicStore(isWaiting, 0);
+}
+
+
+/**
+ * Réveille le module s'il attend dans waitQueue
+ */
+void Module::wakeUp()
+{
+    boost::mutex::scoped_lock l(mutexQueue);
     condQueue.notify_one();
 }
 
 
 /**
- * Traite la file de message
+ * Indique si le module n'a rien a traiter
+ *
+ * @return          true si aucun message n'est en attente
+ */
+bool Module::isIdle()
+{
+    return message_queue[LANE_REALTIME].empty() &&
+            message_queue[LANE_BULK].empty() &&
+            !atomicLoad(isOverflowing[LANE_REALTIME]) &&
+            !atomicLoad(isOverflowing[LANE_BULK]);
+}
+
+
+/**
+ * Traite les files de message sans bloquer.
+ *
+ * La voie temps réel est traitée en premier. Les messages de la voie de
+ * fond sont ensuite traités un par un, et la voie temps réel est vidée
+ * aprés chacun d'eux: un message lent (sauvegarde de la config, ...) ne
+ * retarde jamais plus d'un message de fond les déplacements du joueur.
  */
 void Module::processQueue() {
-    while(true) {
-        boost::mutex::scoped_lock l(mutexQueue);
+    processBatch(LANE_REALTIME);
+
+    module_message msg;
+    for(irr::u32 i=0; i<MODULE_QUEUE_SIZE; i++) {
+        if(!message_queue[LANE_BULK].pop(msg))
+            break;
+
+        dispatchMessage(msg, LANE_BULK);
+        processBatch(LANE_REALTIME);
+    }
+
+    vector<module_message> l_message;
+    if(!takeOverflow(LANE_BULK, l_message))
+        return;
+
+    for(irr::u32 i=0; i<l_message.size(); i++) {
+        dispatchMessage(l_message[i], LANE_BULK);
+        processBatch(LANE_REALTIME);
+    }
+}
+
+
+/**
+ * Traite en lot tout les messages en attente d'une voie.
+ *
+ * Tout les messages en attente sont retirés en une passe, puis traités
+ * en lot. Les messages arrivés pendant le traitement le seront au
+ * prochain appel. Le débordement de la file forme un second lot.
+ *
+ * @param lane          Voie a traiter
+ */
+void Module::processBatch(EnumMessageLane lane) {
+    irr::u32 size = 0;
+
+    while(size < MODULE_QUEUE_SIZE && message_queue[lane].pop(batch[size]))
+        size++;
+
+    if(size > 0)
+        runBatch(batch, size, lane);
+
+    vector<module_message> l_message;
+    if(takeOverflow(lane, l_message))
+        runBatch(&l_message[0], l_message.size(), lane);
+}
+
+
+/**
+ * Traite un lot de messages d'une voie
+ *
+ * @param lot           Messages du lot, dans l'ordre d'arrivée
+ * @param size          Nombre de messages dans le lot
+ * @param lane          Voie d'où vient le lot
+ */
+void Module::runBatch(module_message* lot, irr::u32 size,
+        EnumMessageLane lane)
+{
+    // Statistiques
+    nbBatches++;
+    nbBatchedMessages += size;
+    if(size > maxBatchSize)
+        maxBatchSize = size;
+
+    int slot = 0;
+    while((size >> (slot + 1)) && slot < MODULE_BATCH_HISTOGRAM - 1)
+        slot++;
+    batchHistogram[slot]++;
 
-        if(message_queue.empty())
-            return;
+    // Laisse le module supprimer les messages redondants
+    coalesceBatch(lot, size);
 
-        module_message e = message_queue.front();
-        message_queue.pop();
-        l.unlock();
+    for(irr::u32 i=0; i<size; i++) {
+        if(lot[i].codeAction == ACTION_AUCUNE) {
+            nbCoalescedMessages++;
+            continue;
+        }
 
-        processMessage(e);
+        dispatchMessage(lot[i], lane);
     }
-};
+}
+
+
+/**
+ * Mesure le temps passé dans la file puis traite le message
+ *
+ * @param msg           Message a traiter
+ * @param lane          Voie d'où vient le message
+ */
+void Module::dispatchMessage(module_message& msg, EnumMessageLane lane)
+{
+    EnumCodesAction codeAction = msg.codeAction;
+
+    msg.dequeueTime = TimeService::now();
+    laneLatency[lane].add((irr::u32)((msg.dequeueTime - msg.enqueueTime) / 1000));
+
+    processMessage(msg);
+
+    msg.handledTime = TimeService::now();
+    actionHandlerTime[codeAction].add(
+            (irr::u32)((msg.handledTime - msg.dequeueTime) / 1000));
+
+    // Les messages postés directement (sans le Core) n'ont pas d'envoi
+    boost::uint64_t envoi = msg.sendTime ? msg.sendTime : msg.enqueueTime;
+    actionLatency[codeAction].add((irr::u32)((msg.handledTime - envoi) / 1000));
+}
+
+
+/**
+ * Permet au module de fusionner les messages redondants d'un lot avant
+ * leur traitement. Un message dont le codeAction est remplacé par
+ * ACTION_AUCUNE est ignoré.
+ *
+ * Par défaut, ne fait rien.
+ *
+ * @param batch         Messages du lot, dans l'ordre d'arrivée
+ * @param size          Nombre de messages dans le lot
+ */
+void Module::coalesceBatch(module_message* batch, irr::u32 size)
+{
+}
+
+
+/**
+ * Affiche les statistiques de traitement des messages du module
+ */
+void Module::logStatistics()
+{
+    ostringstream stats;
+
+    stats << "Lots traites: " << nbBatches
+          << ", messages: " << nbBatchedMessages
+          << ", fusionnes: " << nbCoalescedMessages
+          << ", taille max: " << maxBatchSize;
+    if(nbBatches > 0)
+        stats << ", taille moyenne: " << ((float)nbBatchedMessages / nbBatches);
+    log(stats.str());
+
+    stats.str("");
+    stats << "Repartition des lots:";
+    for(int i=0; i<MODULE_BATCH_HISTOGRAM; i++)
+        stats << " [" << (1 << i) << "+]=" << batchHistogram[i];
+    log(stats.str());
+
+    log("Attente voie temps reel: " + laneLatency[LANE_REALTIME].toString());
+    log("Attente voie de fond: " + laneLatency[LANE_BULK].toString());
+    log("Etapes: " + stepDuration.toString());
+
+    if(nbOverflowMessages[LANE_REALTIME] || nbOverflowMessages[LANE_BULK]) {
+        stats.str("");
+        stats << "Messages en debordement (file pleine): temps reel "
+              << nbOverflowMessages[LANE_REALTIME]
+              << ", fond " << nbOverflowMessages[LANE_BULK];
+        log(stats.str(), WARNING);
+    }
+}
+
+
+/**
+ * Ecrit toutes les statistiques de traçage du module.
+ * Peut être appelé pendant que le module tourne: les valeurs lues sont
+ * alors approximatives.
+ *
+ * @param out           Flux de destination
+ */
+void Module::writeStatistics(ostream& out)
+{
+    out << "[" << getName() << "]" << endl;
+
+    out << "lots=" << nbBatches
+        << " messages=" << nbBatchedMessages
+        << " fusionnes=" << nbCoalescedMessages
+        << " taille_max=" << maxBatchSize << endl;
+
+    out << "profondeur_max temps_reel=" << maxQueueDepth[LANE_REALTIME]
+        << " fond=" << maxQueueDepth[LANE_BULK] << endl;
+    out << "debordement temps_reel=" << nbOverflowMessages[LANE_REALTIME]
+        << " fond=" << nbOverflowMessages[LANE_BULK] << endl;
+
+    out << "attente temps_reel: " << laneLatency[LANE_REALTIME].toString() << endl;
+    out << "attente fond: " << laneLatency[LANE_BULK].toString() << endl;
+    out << "etapes: " << stepDuration.toString() << endl;
+    if(cpuTime)
+        out << "temps_cpu(ms)=" << (cpuTime / 1000000) << endl;
+
+    // Histogrammes par code action
+    for(int i=0; i<ACTION_COUNT; i++) {
+        const LatencyHistogram& latency = actionLatency[i];
+        if(latency.getCount() == 0)
+            continue;
+
+        out << module_message::getActionName((EnumCodesAction)i) << endl;
+        out << "    envoi->traite: " << latency.toString() << endl;
+        out << "    traitement: " << actionHandlerTime[i].toString() << endl;
+        out << "    tranches(us):";
+        for(int j=0; j<LATENCY_HISTOGRAM_SIZE; j++) {
+            if(latency.getBucket(j))
+                out << " " << (1 << j) << "+=" << latency.getBucket(j);
+        }
+        out << endl;
+    }
+
+    out << endl;
+}
 
 
 /**
@@ -121,6 +540,17 @@ boost::thread* Module::getThread()
 }
 
 
+/**
+ * Donne le temps CPU consommé par le thread du module
+ *
+ * @return          Temps CPU (ns), 0 tant que le module tourne
+ */
+boost::uint64_t Module::getCpuTime()
+{
+    return cpuTime;
+}
+
+
 // Mutateurs
 /**
  * Modifie le thread
@@ -131,3 +561,14 @@ void Module::setThread(boost::thread* thread)
 {
     this->thread = thread;
 }
+
+
+/**
+ * Enregistre le temps CPU consommé par le thread du module
+ *
+ * @param cpuTime       Temps CPU (ns)
+ */
+void Module::setCpuTime(boost::uint64_t cpuTime)
+{
+    this->cpuTime = cpuTime;
+}
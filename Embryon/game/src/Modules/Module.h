@@ -5,13 +5,19 @@
 #define MODULE_H
 
 #include <map>
-#include <queue>
+#include <ostream>
+#include <vector>
 #include <boost/thread.hpp>
 #include <boost/thread/mutex.hpp>
 
 #include "../common.h"
 #include "../Logger.h"
 #include "../module_message.h"
+#include "../Core/RingBuffer.h"
+#include "../Core/LatencyHistogram.h"
+
+#define MODULE_QUEUE_SIZE       256     // Puissance de 2
+#define MODULE_BATCH_HISTOGRAM  10      // Tranches 1, 2-3, 4-7, ..., 256+
 
 using namespace std;
 
@@ -31,14 +37,18 @@ class Module
         Module(EnumModuleId id, string name, Core* core);
         virtual ~Module();
 
+        void frame();
 
-        /**
-         * Boucle principale de chaque module
-         */
-        virtual void frame() = 0;
+        // Etapes de la boucle du module
+        virtual void begin();
+        virtual bool step();
+        virtual void end();
+        bool runStep();
 
         // Simplifie l'appel au logger
         void log(string message, EnumLogLevel level=SIMPLE);
+        void logStatistics();
+        void writeStatistics(ostream& out);
 
         void pushMessage(module_message& msg);
 
@@ -46,9 +56,11 @@ class Module
         EnumModuleId getId();
         string getName();
         boost::thread* getThread();
+        boost::uint64_t getCpuTime();
 
         // Mutateurs
         void setThread(boost::thread* thread);
+        void setCpuTime(boost::uint64_t cpuTime);
     private:
     protected:
         EnumModuleId id;
@@ -57,17 +69,67 @@ class Module
 
         boost::thread* thread;
 
+        // Temps CPU du thread a la fin du module (ns)
+        boost::uint64_t cpuTime;
+
         map<string, int> config;
 
         Logger logger;
 
-        // File de message recu
+        // Files de message recu, une par voie, sans verrou
+        RingBuffer<module_message, MODULE_QUEUE_SIZE> message_queue[LANE_COUNT];
+
+        // Réveil du module lorsqu'il attend des messages
         boost::mutex mutexQueue;
         boost::condition_variable condQueue;
-        queue<module_message> message_queue;
+        volatile irr::u32 isWaiting;
+
+        virtual void wait();
+        void waitQueue();
+        void waitQueue(boost::uint64_t timeout);
+        void wakeUp();
+        virtual bool isIdle();
 
         void processQueue();
+        virtual void coalesceBatch(module_message* batch, irr::u32 size);
         virtual void processMessage(module_message&) = 0;
+    private:
+        void processBatch(EnumMessageLane lane);
+        void runBatch(module_message* lot, irr::u32 size,
+                EnumMessageLane lane);
+        void dispatchMessage(module_message& msg, EnumMessageLane lane);
+        void pushOverflow(module_message& msg, EnumMessageLane lane);
+        bool takeOverflow(EnumMessageLane lane, vector<module_message>& l_message);
+
+        // Lot de messages en cours de traitement
+        module_message batch[MODULE_QUEUE_SIZE];
+
+        // Temps passé dans la file, par voie
+        LatencyHistogram laneLatency[LANE_COUNT];
+
+        // Profondeur maximale atteinte par chaque file
+        volatile irr::u32 maxQueueDepth[LANE_COUNT];
+
+        // Débordement d'une file pleine, vidé par le module aprés elle:
+        // aucun message n'est perdu
+        boost::mutex mutexOverflow;
+        vector<module_message> l_overflow[LANE_COUNT];
+        volatile irr::u32 isOverflowing[LANE_COUNT];
+        volatile irr::u32 nbOverflowMessages[LANE_COUNT];
+
+        // Par code action: envoi -> fin du traitement, durée du traitement
+        LatencyHistogram actionLatency[ACTION_COUNT];
+        LatencyHistogram actionHandlerTime[ACTION_COUNT];
+
+        // Durée de chaque étape
+        LatencyHistogram stepDuration;
+
+        // Statistiques sur la taille des lots
+        irr::u32 nbBatches;
+        irr::u32 nbBatchedMessages;
+        irr::u32 nbCoalescedMessages;
+        irr::u32 maxBatchSize;
+        irr::u32 batchHistogram[MODULE_BATCH_HISTOGRAM];
 };
 
 #endif // MODULE_H
@@ -3,13 +3,17 @@
  */
 #include "RenderingEngine.h"
 
+#include <fstream>
 #include <iostream>
 #include <boost/thread.hpp>
 #include <boost/date_time.hpp>
 #include <boost/thread/mutex.hpp>
 
+#include "../Core/Atomic.h"
 #include "../Core/Core.h"
+#include "../GUI/LoadingMenu.h"
 #include "../Level.h"
+#include "../StaticBatcher.h"
 #include "EventsEngine.h"
 #include "../IGUIKeySelector.h"
 
@@ -27,15 +31,51 @@ RenderingEngine::RenderingEngine(
 {
     this->eventsEngine = eventsEngine;
 
-    currentMenu = IN_MAIN_MENU;
+    core->subscribe(this,
+            TOPIC_MASK(TOPIC_MENU) |
+            TOPIC_MASK(TOPIC_PARTIE) |
+            TOPIC_MASK(TOPIC_PLAYER_ACTION) |
+            TOPIC_MASK(TOPIC_GAME_STATE)
+    );
+
+    // Copie locale de l'état du jeu, tenue a jour par les notifications
+    gameState = core->getGameState();
+    currentMenu = gameState.getMenuState();
 
     mDevice = NULL;
+    collisionManager = NULL;
+    selectedSceneNode = NULL;
+    levelGeneration = 0;
+
+    levelLoading = LEVEL_LOADING_AUCUN;
+    levelJobs = 0;
+    cacheJobs = 0;
+    cacheWriting = false;
+    meshMap = NULL;
+    levelGeometry = NULL;
+    levelEntities = NULL;
+    nodeMap = NULL;
+    levelSelector = NULL;
+    cullingNode = NULL;
+    cullingWorld = NULL;
+
+    latencyHarness = false;
+    inputTick = 0;
+    lastInputTime = 0;
+    nbPendingInputs = 0;
+    latencyRefresh = 0;
+
+    CullingStats aucun = {-1, 0, 0, 0};
+    culling = aucun;
+    cullingTotal = aucun;
+    nbCullingFrames = 0;
 
     l_guiElement[IN_MAIN_MENU] = NULL;
     l_guiElement[IN_CHOOSE_LEVEL_MENU] = NULL;
     l_guiElement[IN_OPTIONS_MENU] = NULL;
     l_guiElement[IN_GAME] = NULL;
     l_guiElement[IN_PAUSE_MENU] = NULL;
+    l_guiElement[IN_LOADING_MENU] = NULL;
 }
 
 /**
@@ -51,10 +91,15 @@ RenderingEngine::~RenderingEngine()
  */
 void RenderingEngine::initialize()
 {
+    // Le driver nul charge les niveaux et les collisions sans fenêtre
+    irr::video::E_DRIVER_TYPE driver = irr::video::EDT_OPENGL;
+    if(core->isHeadless())
+        driver = irr::video::EDT_NULL;
+
     mDevice = irr::createDevice(
-            irr::video::EDT_OPENGL,
+            driver,
             irr::core::dimension2d<irr::u32>(config["width"], config["height"]),
-            config["bitdepth"], config["fullscreen"],
+            config["bitdepth"], config["fullscreen"] && !core->isHeadless(),
             true, config["vsync"], eventsEngine
     );
 
@@ -64,6 +109,10 @@ void RenderingEngine::initialize()
     mSmgr = mDevice->getSceneManager();
     mGuienv = mDevice->getGUIEnvironment();
 
+    // Les assets survivent aux changements de niveau
+    assetCache.setDevice(mDevice);
+    assetCache.setBudget(config["assetBudget"] * 1024ULL * 1024ULL);
+
     // Initialise les GUIPage
     core->createGUIPage(mGuienv, &l_guiElement);
 
@@ -77,6 +126,14 @@ void RenderingEngine::initialize()
     //   "../../media/shaders/celPixel.hlsl", "main", irr::video::EPST_PS_1_1, this
     //);
 
+    if(core->isHeadless())
+        return;
+
+    // Manettes (affectations de la section KEYS)
+    irr::core::array<irr::SJoystickInfo> joysticks;
+    if(mDevice->activateJoysticks(joysticks) && joysticks.size() > 0)
+        log("Manette: " + string(joysticks[0].Name.c_str()));
+
     mDriver->enableMaterial2D();
     cursor = mDriver->getTexture("../../media/pointer_shoot.png");
     mDriver->makeColorKeyTexture (cursor, irr::core::position2d<irr::s32> (0,0));
@@ -95,131 +152,408 @@ void RenderingEngine::unInitialize()
     if(l_guiElement[IN_OPTIONS_MENU])       l_guiElement[IN_OPTIONS_MENU]->drop();
     if(l_guiElement[IN_GAME])               l_guiElement[IN_GAME]->drop();
     if(l_guiElement[IN_PAUSE_MENU])         l_guiElement[IN_PAUSE_MENU]->drop();
+    if(l_guiElement[IN_LOADING_MENU])       l_guiElement[IN_LOADING_MENU]->drop();
+
+    // Libére les assets avant le driver
+    levelCache.close();
+    l_levelAsset.clear();
+    assetCache.clear();
 
     if(mDevice)                             mDevice->drop();
 }
 
 
 /**
- * Traitement du module
- * Tout les appels a Irrlicht doivent être fait ici
+ * Initialisation du module
+ * Tout les appels a Irrlicht doivent être fait depuis le thread qui
+ * exécute begin, step et end
  */
-void RenderingEngine::frame()
+void RenderingEngine::begin()
 {
     log("Debut de la gestion de l'affichage");
     loadRenderingConfig();
 
-    irr::u32 beginTime, endTime, deltaTime, sleepTime;
-    irr::f32 frameTime = (1.0 / (float)FPS) * CLOCKS_PER_SEC;
-
     initialize();
 
-    irr::core::position2d<irr::s32> mousePos;
-    irr::core::vector3df position;
-    irr::core::line3d<irr::f32> mouseRay;
-
     // Gestionnaire de collision
-    irr::scene::ISceneCollisionManager* collisionManager;
     collisionManager = mSmgr->getSceneCollisionManager();
 
-    beginTime = getTime();
-    while(core->getIsRunning() && mDevice->run()) {
-        // Gére sa liste de message
-        processQueue();
+    // Les animations d'Irrlicht suivent l'échelle du temps de jeu
+    mDevice->getTimer()->setSpeed(core->getTimeService()->getTimeScale());
 
-        if(core->isPartieEnCours() && !core->isPartieEnPause()) {
-            /******************
-            // PLAYER
-            ******************/
+    // Cadencement des images
+    framePacer.setTargetFrameTime(1000000000ULL / config["fps"]);
+    framePacer.setSpinMargin(config["spin"] * 1000ULL);
+    framePacer.setVsync(config["vsync"] != 0);
+    framePacer.start();
 
-            // Ligne de visée avec la souris
-            mousePos = mDevice->getCursorControl()->getPosition();
-            mouseRay = collisionManager->getRayFromScreenCoordinates(mousePos);
+    // Mesure de la latence entrée -> image
+    latencyHarness = config["latency"] && !core->isHeadless();
+    if(latencyHarness && !inputLatency.open(LATENCY_CSV_FILE))
+        log("Impossible de creer " LATENCY_CSV_FILE, ERROR);
+}
 
-            // Donne le mouseRay au joueur
-            core->getPlayer()->setMouseRay(mouseRay);
 
-            // Modifie la position du joueur
-            core->getPlayer()->updatePosition();
+/**
+ * Affiche une image
+ *
+ * @return          false si la fenêtre a été fermée
+ */
+bool RenderingEngine::step()
+{
+    if(!mDevice->run())
+        return false;
 
-            // Rafraichit le joueur
-            refreshPlayer();
+    // Gére sa liste de message
+    processQueue();
 
+    // Résultat de l'écriture du cache du niveau
+    finishLevelCache(false);
 
-            /******************
-            // SURVOL DE NODE
-            ******************/
+    // Une étape du chargement de niveau par image
+    if(levelLoading != LEVEL_LOADING_AUCUN)
+        stepLevel();
 
-            irr::core::vector3df intersection;
-            irr::core::triangle3df hitTriangle;
+    // Dernier état publié par la simulation, ignoré s'il concerne un
+    // niveau précédent (ses nodes n'existent plus)
+    TripleBuffer<WorldSnapshot>* worldSnapshot = core->getWorldSnapshot();
+    worldSnapshot->update();
+    const WorldSnapshot& monde = worldSnapshot->getReadBuffer();
+    bool mondeValide =
+            levelGeneration != 0 && monde.generation == levelGeneration;
 
-            // Selection d'obejts
-            selectedSceneNode = collisionManager->getSceneNodeAndCollisionPointFromRay(
-                    mouseRay, intersection, hitTriangle, SCENE_NODE_ENTITY, 0
-            );
+    // Headless: rien a afficher, seules les nodes suivent la simulation
+    if(core->isHeadless()) {
+        if(mondeValide && gameState.isPartieActive())
+            refreshWorld(monde);
 
-            if(selectedSceneNode) {
-                // Place le marqueur sur le point de collision
-                bill->setPosition(intersection);    // DEBUG
-            }
-        }
+        return true;
+    }
+
+    // Aussi pour le curseur affiché en jeu, partie en pause ou non
+    irr::core::position2d<irr::s32> mousePos = getCursorPosition();
+
+    if(gameState.isPartieActive()) {
+        /******************
+        // PLAYER
+        ******************/
+
+        // Ligne de visée avec la souris
+        selectSceneNode(mousePos);
+
+        // Donne le mouseRay au joueur
+        core->getPlayer()->setMouseRay(mouseRay);
+
+        // Rafraichit le joueur et les entités (voir GameEngine)
+        if(mondeValide) {
+            refreshWorld(monde);
 
-        mDriver->beginScene(true, true, irr::video::SColor(0xff88aadd));
+            if(latencyHarness)
+                trackInputs(monde);
+        }
 
-        if(!core->isPartieEnPause())
-            mSmgr->drawAll();
+    }
 
-        if(core->getMenuState() == IN_GAME) {
-            mDriver->setTransform(irr::video::ETS_WORLD, irr::core::matrix4());
+    mDriver->beginScene(true, true, irr::video::SColor(0xff88aadd));
+
+    if(!gameState.isPartieEnPause()) {
+        // cullLevel est appelé par cullingNode pendant drawAll
+        cullingWorld = mondeValide ? &monde : NULL;
+        if(cullingNode)
+            cullingNode->moveLast();
+        mSmgr->drawAll();
+        cullingWorld = NULL;
+        restoreCulledNodes();
+
+        // Mobs déplacés par leurs animateurs: la simulation en garde une
+        // copie
+        for(irr::u32 i=0; i<l_mobNode.size(); i++)
+            core->getLevel()->setMobTransform(l_mobNode[i],
+                    l_mobNode[i]->getPosition(), l_mobNode[i]->getRotation());
+    }
 
-            // Récupére la ligne de visée
-            irr::core::line3df viseur3D = core->getPlayer()->getViseurRay();
+    if(currentMenu == IN_GAME) {
+        mDriver->setTransform(irr::video::ETS_WORLD, irr::core::matrix4());
 
-            // Affiche la ligne de visée
+        // Affiche la ligne de visée
+        if(mondeValide)
             mDriver->draw3DLine(
-                    viseur3D.start, viseur3D.end,
+                    monde.viseurRay.start, monde.viseurRay.end,
                     irr::video::SColor(255,0,255,255)
             );
 
-            mousePos.X -= cursorDimension.Width / 2;
-            mousePos.Y -= cursorDimension.Height / 2;
-            // Curseur
-            mDriver->draw2DImage(cursor, mousePos, irr::core::rect<irr::s32>(0,0,128,128), 0, irr::video::SColor(255, 255, 255, 255), true);
-        }
+        mousePos.X -= cursorDimension.Width / 2;
+        mousePos.Y -= cursorDimension.Height / 2;
+        // Curseur
+        mDriver->draw2DImage(cursor, mousePos, irr::core::rect<irr::s32>(0,0,128,128), 0, irr::video::SColor(255, 255, 255, 255), true);
+    }
 
-        l_guiElement[currentMenu]->draw();
+    l_guiElement[currentMenu]->draw();
 
+    if(latencyHarness && currentMenu == IN_GAME)
+        drawLatency();
+    if(config["pvsStats"] && currentMenu == IN_GAME)
+        drawCulling();
 
-        mDriver->endScene();
+    mDriver->endScene();
 
-        irr::core::stringw tmp(L"Projet Embryon [");
-        tmp += mDriver->getFPS();
-        tmp += L" fps]";
+    // Les entrées du pas affiché sont visibles a partir de cette image
+    if(nbPendingInputs) {
+        boost::uint64_t affichage = TimeService::now();
+        for(irr::u32 i=0; i<nbPendingInputs; i++)
+            inputLatency.add(l_pendingInput[i], affichage, inputTick);
+        nbPendingInputs = 0;
+    }
 
-        mDevice->setWindowCaption(tmp.c_str());
+    irr::core::stringw tmp(L"Projet Embryon [");
+    tmp += mDriver->getFPS();
+    tmp += L" fps]";
 
-        // Limitation du FPS
-        endTime = getTime();
-        deltaTime = endTime - beginTime;
-        beginTime = endTime;
-        if(deltaTime < frameTime) {
-            sleepTime = frameTime - deltaTime;
-            boost::this_thread::sleep(
-                    boost::posix_time::milliseconds(sleepTime)
-            );
-        }
-    }
+    mDevice->setWindowCaption(tmp.c_str());
+
+    // Limitation du FPS
+    framePacer.waitNextFrame();
+
+    return true;
+}
 
+
+/**
+ * Fin du module
+ */
+void RenderingEngine::end()
+{
     // Si on a pas prevenu de l'arret du jeu
     if(core->getIsRunning())
         core->stop();
 
+    abortLevel();
+    finishLevelCache(true);
+    log("Assets: " + assetCache.toString());
     unInitialize();
 
+    if(!core->isHeadless())
+        log("Images: " + framePacer.toString());
+    if(latencyHarness)
+        log("Entree->image: " + inputLatency.toString());
+    inputLatency.close();
+
+    if(nbCullingFrames) {
+        ostringstream moyenne;
+        moyenne << "Visibilite: " << nbCullingFrames << " images, par image "
+                << cullingTotal.nbNodes / nbCullingFrames << " nodes, "
+                << cullingTotal.nbPvs / nbCullingFrames << " hors PVS, "
+                << cullingTotal.nbFrustum / nbCullingFrames << " hors champ";
+        log(moyenne.str());
+    }
+
     log("Fin de la gestion de l'affichage");
 }
 
 
+/**
+ * Le rendu est cadencé par step: pas d'attente de message.
+ * En headless, attend un message au plus une période d'affichage.
+ */
+void RenderingEngine::wait()
+{
+    if(core->isHeadless())
+        waitQueue(1000000000ULL / config["fps"]);
+}
+
+
+/**
+ * Retient les entrées appliquées par un nouveau pas de simulation: leur
+ * latence est mesurée aprés la prochaine image. Le pas est acquitté auprés
+ * de GameEngine, qui accumule les entrées jusque la: celles déja mesurées,
+ * par ordre de capture, sont ignorées.
+ *
+ * @param monde         Dernier état publié par la simulation
+ */
+void RenderingEngine::trackInputs(const WorldSnapshot& monde)
+{
+    if(monde.inputTick == inputTick)
+        return;
+
+    inputTick = monde.inputTick;
+    core->setInputAck(inputTick);
+
+    for(irr::u32 i=0; i<monde.nbInputs; i++) {
+        if(monde.inputTime[i] <= lastInputTime
+                || nbPendingInputs == SNAPSHOT_INPUT_MAX)
+            continue;
+
+        l_pendingInput[nbPendingInputs++] = monde.inputTime[i];
+        lastInputTime = monde.inputTime[i];
+    }
+}
+
+
+/**
+ * Affiche les percentiles de latence entrée -> image, recalculés une fois
+ * par seconde
+ */
+void RenderingEngine::drawLatency()
+{
+    boost::uint64_t maintenant = TimeService::now();
+
+    if(maintenant - latencyRefresh >= 1000000000ULL) {
+        latencyRefresh = maintenant;
+
+        irr::core::stringc texte(inputLatency.toString().c_str());
+        latencyText = L"Entree->image: ";
+        latencyText += irr::core::stringw(texte.c_str());
+    }
+
+    mGuienv->getBuiltInFont()->draw(latencyText,
+            irr::core::rect<irr::s32>(10, 10, 400, 30),
+            irr::video::SColor(255, 255, 255, 0));
+}
+
+
+/**
+ * Appelé par cullingNode pendant drawAll, une fois toute la scene animée
+ */
+void RenderingEngine::OnCull()
+{
+    cullLevel(cullingWorld);
+}
+
+
+/**
+ * Masque, le temps de drawAll, les nodes que la caméra ne peut pas voir
+ * d'aprés le PVS: géométrie et shaders de chaque cluster, mobs et entités
+ * bloc. Compte aussi ceux que le frustum écartera. Appelé entre
+ * l'animation et l'enregistrement des nodes: un node masqué a déja avancé
+ * et n'est simplement pas affiché.
+ *
+ * @param monde         Dernier état publié par la simulation, NULL s'il
+ *                      n'est pas valide (entités ignorées)
+ */
+void RenderingEngine::cullLevel(const WorldSnapshot* monde)
+{
+    CullingStats aucun = {-1, 0, 0, 0};
+    culling = aucun;
+
+    if(levelGeneration == 0 || !config["visibility"]
+            || !levelVisibility.isEnabled())
+        return;
+
+    culling.cluster = levelVisibility.getCluster(camera->getAbsolutePosition());
+
+    for(irr::u32 i=0; i<l_clusterNode.size(); i++)
+        cullNode(l_clusterNode[i].node,
+                levelVisibility.isVisible(culling.cluster, l_clusterNode[i].cluster));
+
+    for(irr::u32 i=0; i<l_mobNode.size(); i++)
+        cullNode(l_mobNode[i], isBoxVisible(culling.cluster,
+                l_mobNode[i]->getTransformedBoundingBox()));
+
+    if(monde)
+        for(irr::u32 i=0; i<monde->l_entity.size(); i++) {
+            irr::scene::ISceneNode* node = monde->l_entity[i].node;
+            cullNode(node, isBoxVisible(culling.cluster,
+                    node->getTransformedBoundingBox()));
+        }
+
+    cullingTotal.nbNodes += culling.nbNodes;
+    cullingTotal.nbPvs += culling.nbPvs;
+    cullingTotal.nbFrustum += culling.nbFrustum;
+    nbCullingFrames++;
+}
+
+
+/**
+ * Masque un node hors du PVS jusqu'a restoreCulledNodes. Un node déja
+ * masqué par le jeu est ignoré.
+ *
+ * @param node          Node testé
+ * @param visible       Résultat du PVS
+ */
+void RenderingEngine::cullNode(irr::scene::ISceneNode* node, bool visible)
+{
+    if(!node->isVisible())
+        return;
+
+    culling.nbNodes++;
+
+    if(!visible) {
+        node->setVisible(false);
+        l_culledNode.push_back(node);
+        culling.nbPvs++;
+    }
+    else if(mSmgr->isCulled(node))
+        culling.nbFrustum++;
+}
+
+
+/**
+ * Indique si une boite peut être vue depuis un cluster: son centre ou l'un
+ * de ses coins est dans un cluster visible, ou aucun n'est dans un cluster
+ *
+ * @param depuis        Cluster de la caméra
+ * @param boite         Boite englobante d'un node
+ */
+bool RenderingEngine::isBoxVisible(irr::s32 depuis,
+        const irr::core::aabbox3df& boite)
+{
+    bool dansCluster = false;
+
+    for(irr::u32 i=0; i<9; i++) {
+        irr::core::vector3df point = boite.getCenter();
+        if(i < 8)
+            point = irr::core::vector3df(
+                    i & 1 ? boite.MaxEdge.X : boite.MinEdge.X,
+                    i & 2 ? boite.MaxEdge.Y : boite.MinEdge.Y,
+                    i & 4 ? boite.MaxEdge.Z : boite.MinEdge.Z);
+
+        irr::s32 cluster = levelVisibility.getCluster(point);
+        if(cluster < 0)
+            continue;
+
+        if(levelVisibility.isVisible(depuis, cluster))
+            return true;
+        dansCluster = true;
+    }
+
+    return !dansCluster;
+}
+
+
+/**
+ * Réaffiche les nodes masqués par cullLevel: le jeu (sélection, collisions)
+ * les voit toujours
+ */
+void RenderingEngine::restoreCulledNodes()
+{
+    for(irr::u32 i=0; i<l_culledNode.size(); i++)
+        l_culledNode[i]->setVisible(true);
+
+    l_culledNode.clear();
+}
+
+
+/**
+ * Affiche les nodes écartés par la derniére image
+ */
+void RenderingEngine::drawCulling()
+{
+    irr::core::stringw texte = L"PVS: cluster ";
+    texte += culling.cluster;
+    texte += L", ";
+    texte += culling.nbPvs;
+    texte += L"/";
+    texte += culling.nbNodes;
+    texte += L" nodes masques, ";
+    texte += culling.nbFrustum;
+    texte += L" hors champ";
+
+    mGuienv->getBuiltInFont()->draw(texte,
+            irr::core::rect<irr::s32>(10, 30, 400, 50),
+            irr::video::SColor(255, 255, 255, 0));
+}
+
+
 /**
  * Charge la config du module
  */
@@ -233,6 +567,21 @@ void RenderingEngine::loadRenderingConfig()
     if(config.find("fullscreen") == config.end())   config["fullscreen"] = 0;
     if(config.find("vsync") == config.end())        config["vsync"] = 0;
     if(config.find("bitdepth") == config.end())     config["bitdepth"] = 16;
+    if(config.find("fps") == config.end())          config["fps"] = FPS;
+    if(config.find("spin") == config.end())         config["spin"] = FRAME_PACER_SPIN;
+    if(config.find("latency") == config.end())      config["latency"] = 0;
+    if(config.find("assetBudget") == config.end())  config["assetBudget"] = ASSET_BUDGET;
+    if(config.find("levelCache") == config.end())   config["levelCache"] = 1;
+    if(config.find("batching") == config.end())     config["batching"] = 1;
+    if(config.find("visibility") == config.end())   config["visibility"] = 1;
+    if(config.find("pvsStats") == config.end())     config["pvsStats"] = 0;
+    if(config.find("clusterTriangles") == config.end())
+        config["clusterTriangles"] = BATCH_CLUSTER_TRIANGLES;
+
+    if(config["fps"] <= 0)      config["fps"] = FPS;
+    if(config["spin"] < 0)      config["spin"] = 0;
+    if(config["assetBudget"] < 0)   config["assetBudget"] = 0;
+    if(config["clusterTriangles"] < 0)  config["clusterTriangles"] = 0;
 
     core->saveConfig("VIDEO", config);
 }
@@ -246,130 +595,599 @@ void RenderingEngine::loadRenderingConfig()
 void RenderingEngine::processMessage(module_message& msg)
 {
     switch(msg.codeAction) {
-        case ACTION_AFFICHER_MENU:
-            l_guiElement[currentMenu]->setVisible(false);
-            currentMenu = msg.intData["menu"];
-            l_guiElement[currentMenu]->setVisible(true);
+        case ACTION_GAME_STATE_CHANGED:
+            onGameStateChanged(GameState(msg.data.gameState.nouveau));
             break;
         case ACTION_INIT_GAME:
-            constructLevel(msg.strData["niveau"]);
-            mDevice->getCursorControl()->setVisible(false);
+            constructLevel(msg.data.initGame.niveau);
             break;
-        case ACTION_PAUSE:
-            mDevice->getTimer()->stop();
-            mSmgr->getActiveCamera()->setInputReceiverEnabled(false);
-            mDevice->getCursorControl()->setVisible(true);
+        case ACTION_SAVE_CONFIG:
+            applyConfigChanges();
+            break;
+        case ACTION_CURSOR_MOVED:
+            replayCursor.X = msg.data.cursor.x;
+            replayCursor.Y = msg.data.cursor.y;
             break;
-        case ACTION_UNPAUSE:
-            mDevice->getTimer()->start();
+        case ACTION_PLAYER_ACTION:
+            // Sélection sous le curseur au moment de l'action, et non a
+            // la derniére image: identique en relecture
+            if(!core->isHeadless() && gameState.isPartieActive())
+                selectSceneNode(getCursorPosition());
+
+            // Les entités appartiennent a la simulation
+            if(selectedSceneNode) {
+                module_message activation(
+                        getId(), GAME, ACTION_ACTIVATE_ENTITY);
+                activation.data.activation.node = selectedSceneNode;
+                activation.data.activation.type = ENTITY_ACTIVATION_ACTIONNED;
+                core->sendMessage(activation);
+            }
+            break;
+        default: break;
+    }
+}
+
+
+/**
+ * Donne la position du curseur: celle de la fenêtre, ou celle relue dans
+ * le journal en relecture (la souris réelle est alors ignorée)
+ *
+ * @return          Position a l'écran
+ */
+irr::core::position2d<irr::s32> RenderingEngine::getCursorPosition()
+{
+    if(core->getRecorder()->getMode() == RECORDER_REPLAY)
+        return replayCursor;
+
+    return mDevice->getCursorControl()->getPosition();
+}
+
+
+/**
+ * Met a jour la ligne de visée et l'entité sous le curseur
+ *
+ * @param position      Position du curseur a l'écran
+ */
+void RenderingEngine::selectSceneNode(irr::core::position2d<irr::s32> position)
+{
+    irr::core::vector3df intersection;
+    irr::core::triangle3df hitTriangle;
+
+    mouseRay = collisionManager->getRayFromScreenCoordinates(position);
+
+    // Selection d'obejts
+    selectedSceneNode = collisionManager->getSceneNodeAndCollisionPointFromRay(
+            mouseRay, intersection, hitTriangle, SCENE_NODE_ENTITY, 0
+    );
+
+    if(selectedSceneNode) {
+        // Place le marqueur sur le point de collision
+        bill->setPosition(intersection);    // DEBUG
+    }
+}
+
+
+/**
+ * Applique une transition de l'état du jeu (menu affiché et pause)
+ *
+ * @param nouveau       Etat publié par le Core
+ */
+void RenderingEngine::onGameStateChanged(GameState nouveau)
+{
+    // Notification dépassée par une transition déja appliquée
+    if(!nouveau.isNewerThan(gameState))
+        return;
+
+    GameState ancien = gameState;
+    gameState = nouveau;
+
+    if(nouveau.getMenuState() != currentMenu) {
+        l_guiElement[currentMenu]->setVisible(false);
+        currentMenu = nouveau.getMenuState();
+        l_guiElement[currentMenu]->setVisible(true);
+    }
+
+    if(nouveau.isPartieEnPause() == ancien.isPartieEnPause())
+        return;
+
+    if(nouveau.isPartieEnPause()) {
+        mDevice->getTimer()->stop();
+        if(mSmgr->getActiveCamera())
+            mSmgr->getActiveCamera()->setInputReceiverEnabled(false);
+        mDevice->getCursorControl()->setVisible(true);
+    }
+    else {
+        mDevice->getTimer()->start();
+
+        // Reprise de la partie (et non fin de partie depuis la pause)
+        if(nouveau.isPartieEnCours() && mSmgr->getActiveCamera()) {
             mSmgr->getActiveCamera()->setInputReceiverEnabled(true);
             mDevice->getCursorControl()->setVisible(false);
             mDevice->getCursorControl()->setPosition(
                     config["width"]/2,
                     config["height"]/2
             );
-            break;
-        case ACTION_SAVE_CONFIG:
-            applyConfigChanges();
-            break;
-        case ACTION_PLAYER_ACTION:
-            core->getLevel()->triggerEntityBySceneNode(
-                    selectedSceneNode, ENTITY_ACTIVATION_ACTIONNED);
-            break;
-        default: break;
+            replayCursor.X = config["width"]/2;
+            replayCursor.Y = config["height"]/2;
+        }
     }
 }
 
 
+// Progression et nom affichés au début de chaque étape du chargement
+// (ordre de EnumLevelLoading)
+static const irr::f32 l_loadingProgress[LEVEL_LOADING_COUNT] = {
+    1.0f, 0.0f, 0.1f, 0.5f, 0.6f, 0.75f, 0.85f, 0.95f
+};
+
+static const wchar_t* l_loadingName[LEVEL_LOADING_COUNT] = {
+    L"",
+    L"Lecture des fichiers",
+    L"Chargement de la carte et des textures",
+    L"Construction de la geometrie",
+    L"Calcul des collisions",
+    L"Chargement des entites",
+    L"Chargement des modeles",
+    L"Finalisation"
+};
+
+
 /**
- * Charge le niveau
+ * Job: lit d'avance les fichiers du niveau, pour que les étapes du thread
+ * de rendu les trouvent dans le cache du systéme
  *
- * @param niveau        Nom du niveau que l'on veut charger
+ * @param data          LevelLoadingJob
+ */
+static void prefetchLevelJob(void* data)
+{
+    LevelLoadingJob* job = (LevelLoadingJob*)data;
+    char tampon[65536];
+
+    for(irr::u32 i=0; i<job->l_fichier.size(); i++) {
+        ifstream fichier(job->l_fichier[i].c_str(), ios::in | ios::binary);
+
+        while(fichier.read(tampon, sizeof(tampon)) || fichier.gcount() > 0)
+            ;
+    }
+}
+
+
+/**
+ * Job: écrit le cache du niveau construit par le thread de rendu
+ *
+ * @param data          LevelCacheJob
+ */
+static void writeLevelCacheJob(void* data)
+{
+    LevelCacheJob* job = (LevelCacheJob*)data;
+
+    job->resultat = LevelCache::writeFile(job->path, job->donnees);
+}
+
+
+/**
+ * Commence le chargement d'un niveau. Le chargement avance d'une étape par
+ * image (voir stepLevel), l'écran de chargement restant affiché.
+ *
+ * @param name          Nom du niveau que l'on veut charger
  */
 void RenderingEngine::constructLevel(string name)
 {
-    // Supprimme ce qui pourrait deja exister
+    // Un nouveau niveau remplace celui en cours de chargement, et peut
+    // relire le cache en cours d'écriture
+    abortLevel();
+    finishLevelCache(true);
+
+    // La simulation ne doit plus utiliser l'ancienne scene
+    core->getLevel()->setCollisionWorld(NULL, NULL);
+
+    // Supprimme ce qui pourrait deja exister: les assets de l'ancien niveau
+    // restent en cache pour le suivant
     mSmgr->clear();
+    levelCache.close();
+    releaseLevelAssets();
+    meshMap = NULL;
+    levelGeometry = NULL;
+    levelEntities = NULL;
+    l_brushMesh.clear();
+    levelVisibility.clear();
+    l_clusterNode.clear();
+    l_mobNode.clear();
+    camera = NULL;
+    nodePlayer = NULL;
+    selectedSceneNode = NULL;
+    levelGeneration = 0;
+
+    // Décide de la visibilité dans drawAll, aprés l'animation de la scene
+    cullingNode = new CullingSceneNode(mSmgr->getRootSceneNode(), mSmgr, this);
+    cullingNode->drop();
+
+    levelName = name;
+    levelStart = TimeService::now();
+
+    l_levelSource.clear();
+    l_levelSource.push_back("../../media/maps/" + name);
+    l_levelSource.push_back("../../media/maps/test1.zip");
+
+    // Un cache a jour remplace l'analyse du BSP: seul lui est lu d'avance
+    // avec les archives (leurs textures)
+    string cache = LevelCache::getPath(l_levelSource[0]);
+    if(config["levelCache"])
+        levelCache.open(cache, l_levelSource);
+
+    // Seuls les fichiers absents du cache d'assets sont lus d'avance
+    const string l_fichier[] = {
+        levelCache.isOpen() ? cache : "",
+        l_levelSource[0],
+        l_levelSource[1],
+        "../../media/models/sydney.md2",
+        "../../media/textures/sydney.bmp",
+        "../../media/textures/lialique.bmp"
+    };
+
+    levelJob.l_fichier.clear();
+    for(irr::u32 i=0; i<sizeof(l_fichier)/sizeof(l_fichier[0]); i++)
+        if(!l_fichier[i].empty() && !assetCache.isCached(l_fichier[i]))
+            levelJob.l_fichier.push_back(l_fichier[i]);
+
+    atomicStore(levelJobs, 1);
+    core->getJobSystem()->submit(&prefetchLevelJob, &levelJob, &levelJobs);
+
+    setLevelLoading(LEVEL_LOADING_LECTURE);
+}
 
-    // Chargement du niveau
-    mDevice->getFileSystem()->addFileArchive (
-            ("../../media/maps/" + name).c_str()
-    );
 
-    mDevice->getFileSystem()->addFileArchive ("../../media/maps/test1.zip");
-    irr::scene::IQ3LevelMesh* meshMap =
-            (irr::scene::IQ3LevelMesh*) mSmgr->getMesh("test1.bsp");
+/**
+ * Avance le chargement du niveau d'une étape, si le job de l'étape
+ * précédente est terminé
+ */
+void RenderingEngine::stepLevel()
+{
+    if(atomicLoad(levelJobs))
+        return;
 
-    // On l'ajoute a la scene
-    irr::scene::IMeshSceneNode* nodeMap = mSmgr->addOctreeSceneNode(
-            meshMap->getMesh(irr::scene::quake3::E_Q3_MESH_GEOMETRY),
-            0, SCENE_NODE_MAP, 1024
-    );
+    switch(levelLoading) {
+    case LEVEL_LOADING_LECTURE:
+        setLevelLoading(LEVEL_LOADING_BSP);
+        break;
+
+    case LEVEL_LOADING_BSP:
+        // Archives, puis cache ou analyse du BSP et textures: Irrlicht crée
+        // les textures du driver pendant le chargement, dans ce thread
+        for(irr::u32 i=0; i<l_levelSource.size(); i++)
+            assetCache.mountArchive(l_levelSource[i]);
+
+        if(!loadLevelCache())
+            loadLevelMap();
+
+        setLevelLoading(LEVEL_LOADING_GEOMETRIE);
+        break;
+
+    case LEVEL_LOADING_GEOMETRIE:
+        loadLevelGeometry();
+        setLevelLoading(LEVEL_LOADING_COLLISIONS);
+        break;
+
+    case LEVEL_LOADING_COLLISIONS:
+    {
+        // Dans ce thread: le gestionnaire de scene d'Irrlicht n'est pas
+        // thread-safe. Sans node: la carte est a l'origine, et la
+        // simulation ne doit pas lire la transformation d'une node que le
+        // rendu met a jour.
+        irr::scene::ITriangleSelector* selector =
+                mSmgr->createOctreeTriangleSelector(levelGeometry, NULL, 128);
+        nodeMap->setTriangleSelector(selector);
+        levelSelector->addTriangleSelector(selector);
+        selector->drop();
+
+        setLevelLoading(LEVEL_LOADING_ENTITES);
+        break;
+    }
+
+    case LEVEL_LOADING_ENTITES:
+        loadLevelEntities();
+        setLevelLoading(LEVEL_LOADING_MODELES);
+        break;
+
+    case LEVEL_LOADING_MODELES:
+        loadLevelModels();
+        setLevelLoading(LEVEL_LOADING_FIN);
+        break;
+
+    case LEVEL_LOADING_FIN:
+        finishLevel();
+        setLevelLoading(LEVEL_LOADING_AUCUN);
+        break;
+
+    default: break;
+    }
+}
+
+
+/**
+ * Rend compte de l'écriture du cache du niveau, une fois le job terminé
+ *
+ * @param attendre      Attend la fin du job s'il est en cours
+ */
+void RenderingEngine::finishLevelCache(bool attendre)
+{
+    if(!cacheWriting)
+        return;
+
+    if(attendre)
+        core->getJobSystem()->waitFor(&cacheJobs);
+    else if(atomicLoad(cacheJobs))
+        return;
+
+    cacheWriting = false;
+    string().swap(cacheJob.donnees);
+
+    if(cacheJob.resultat)
+        log("Cache du niveau ecrit: " + cacheJob.path);
+    else
+        log("Impossible d'ecrire " + cacheJob.path, WARNING);
+}
+
+
+/**
+ * Passe a une étape du chargement et la montre sur l'écran de chargement
+ *
+ * @param etape         Nouvelle étape
+ */
+void RenderingEngine::setLevelLoading(EnumLevelLoading etape)
+{
+    levelLoading = etape;
+
+    LoadingMenu::setProgress(l_guiElement[IN_LOADING_MENU],
+            l_loadingProgress[etape], l_loadingName[etape]);
+}
+
+
+/**
+ * Abandonne un chargement en cours (arrêt du module)
+ */
+void RenderingEngine::abortLevel()
+{
+    if(levelLoading == LEVEL_LOADING_AUCUN)
+        return;
+
+    core->getJobSystem()->waitFor(&levelJobs);
+
+    if(levelSelector)
+        levelSelector->drop();
+    levelSelector = NULL;
+
+    levelLoading = LEVEL_LOADING_AUCUN;
+}
+
+
+/**
+ * Charge le niveau depuis son BSP
+ */
+void RenderingEngine::loadLevelMap()
+{
+    const string carte = "test1.bsp";
+    meshMap = (irr::scene::IQ3LevelMesh*) loadLevelMesh(carte);
+
+    levelGeometry = meshMap->getMesh(irr::scene::quake3::E_Q3_MESH_GEOMETRY);
+    levelEntities = &meshMap->getEntityList();
+
+    // Meshes des entités bloc, désignés par leur propriété "model" (*n)
+    l_brushMesh.clear();
+    for(irr::u32 i=0; i<levelEntities->size(); i++) {
+        const irr::scene::quake3::IEntity& entity = (*levelEntities)[i];
+
+        for(irr::u32 j=0; j<entity.getGroupSize(); j++) {
+            const irr::scene::quake3::SVarGroup* group = entity.getGroup(j);
+
+            for(irr::u32 k=0; k<group->Variable.size(); k++) {
+                const irr::core::stringc& model = group->Variable[k].content;
+                if(group->Variable[k].name != "model" || model.size() < 2
+                        || model[0] != '*')
+                    continue;
+
+                irr::s32 modelId = atoi(model.subString(1, model.size()).c_str());
+                if(modelId < 0)
+                    continue;
+
+                if((irr::u32)modelId >= l_brushMesh.size())
+                    l_brushMesh.resize(modelId + 1, NULL);
+                l_brushMesh[modelId] = meshMap->getBrushEntityMesh(modelId);
+            }
+        }
+    }
+
+    // Arbre BSP et PVS, que le loader d'Irrlicht ne garde pas
+    irr::io::IReadFile* bsp =
+            mDevice->getFileSystem()->createAndOpenFile(carte.c_str());
+    if(!bsp || !levelVisibility.loadBsp(bsp))
+        log("Pas de PVS dans " + carte + ": tout est affiche", WARNING);
+    if(bsp)
+        bsp->drop();
+}
+
+
+/**
+ * Charge le niveau depuis son LevelCache, ouvert par constructLevel
+ *
+ * @return              false si le BSP doit être chargé
+ */
+bool RenderingEngine::loadLevelCache()
+{
+    if(!levelCache.isOpen())
+        return false;
+
+    if(!levelCache.load(mDriver, &assetCache)) {
+        log("Cache du niveau " + levelName + " invalide", WARNING);
+        return false;
+    }
+
+    levelGeometry = levelCache.getGeometry();
+    levelEntities = &levelCache.getEntityList();
+    l_brushMesh = levelCache.getBrushMeshes();
+    levelVisibility = levelCache.getVisibility();
+
+    return true;
+}
+
+
+/**
+ * Donne le shader Q3 d'un mesh buffer de la géométrie
+ *
+ * @param index         MaterialTypeParam2 du mesh buffer
+ */
+const irr::scene::quake3::IShader* RenderingEngine::getLevelShader(
+        irr::s32 index)
+{
+    if(meshMap)
+        return meshMap->getShader(index);
+
+    return levelCache.getShader(index);
+}
+
+
+/**
+ * Ajoute la carte et ses effets spéciaux a la scene
+ */
+void RenderingEngine::loadLevelGeometry()
+{
+    // Géométrie affichée: regroupée par matériau en mémoire vidéo, ou
+    // découpée par l'octree (un appel de rendu par buffer et par feuille
+    // visible)
+    StaticBatcher batcher;
+    irr::scene::SMesh* batches = NULL;
+    irr::scene::IMesh* geometrie = levelGeometry;
+    if(config["batching"]) {
+        batches = batcher.build(levelGeometry,
+                config["visibility"] ? &levelVisibility : NULL,
+                config["clusterTriangles"]);
+        geometrie = batches;
+
+        // Un node par cluster du PVS, enfant de celui de la géométrie
+        // toujours visible (cluster -1)
+        map<irr::s32, irr::scene::SMesh*> l_clusterMesh;
+        l_clusterMesh[-1] = new irr::scene::SMesh();
+        for(irr::u32 i=0; i<batches->getMeshBufferCount(); i++) {
+            irr::scene::SMesh*& mesh = l_clusterMesh[batcher.getCluster(i)];
+            if(!mesh)
+                mesh = new irr::scene::SMesh();
+            mesh->addMeshBuffer(batches->getMeshBuffer(i));
+        }
+
+        map<irr::s32, irr::scene::SMesh*>::iterator it;
+        for(it = l_clusterMesh.begin(); it != l_clusterMesh.end(); it++) {
+            it->second->recalculateBoundingBox();
+
+            if(it->first < 0)
+                nodeMap = mSmgr->addMeshSceneNode(
+                        it->second, 0, SCENE_NODE_MAP);
+            else {
+                ClusterNode cluster;
+                cluster.node = mSmgr->addMeshSceneNode(
+                        it->second, nodeMap, SCENE_NODE_MAP);
+                cluster.node->setAutomaticCulling(irr::scene::EAC_FRUSTUM_BOX);
+                cluster.cluster = it->first;
+                l_clusterNode.push_back(cluster);
+            }
+
+            it->second->drop();
+        }
+    }
+    else
+        nodeMap = mSmgr->addOctreeSceneNode(
+                levelGeometry, 0, SCENE_NODE_MAP, 1024
+        );
     nodeMap->setMaterialFlag(irr::video::EMF_LIGHTING, true);
     nodeMap->setMaterialType(irr::video::EMT_LIGHTMAP_LIGHTING);
+    for(irr::u32 i=0; i<l_clusterNode.size(); i++) {
+        l_clusterNode[i].node->setMaterialFlag(irr::video::EMF_LIGHTING, true);
+        l_clusterNode[i].node->setMaterialType(irr::video::EMT_LIGHTMAP_LIGHTING);
+    }
+    irr::u32 nbClusters = l_clusterNode.size();
 
-    // Charge les effets spéciaux
-    irr::scene::IMesh* const additional_mesh =
-            meshMap->getMesh(irr::scene::quake3::E_Q3_MESH_GEOMETRY);
-    cout << meshMap->getMeshBufferCount() << endl;
+    // Charge les effets spéciaux: un node par buffer de la géométrie
+    // affichée, donc par shader et par cluster une fois regroupée
+    irr::u32 nbShaders = 0;
+    irr::scene::IMesh* const additional_mesh = geometrie;
     for(irr::u32 i=0; i!=additional_mesh->getMeshBufferCount(); i++) {
         const irr::scene::IMeshBuffer* meshBuffer =
                 additional_mesh->getMeshBuffer(i);
         const irr::video::SMaterial& material = meshBuffer->getMaterial();
 
         const irr::s32 shaderIndex = (irr::s32) material.MaterialTypeParam2;
-        const irr::scene::quake3::IShader* shader = meshMap->getShader(shaderIndex);
+        const irr::scene::quake3::IShader* shader = getLevelShader(shaderIndex);
         if(shader == 0)
             continue;
 
-        mSmgr->addQuake3SceneNode(meshBuffer, shader);
+        ClusterNode effet;
+        effet.node = mSmgr->addQuake3SceneNode(meshBuffer, shader);
+        effet.cluster = batcher.getCluster(i);
+        if(effet.cluster >= 0)
+            l_clusterNode.push_back(effet);
+        nbShaders++;
     }
 
-    /********************************************
-    // JOUEUR
-    ********************************************/
-
-    // Création du joueur
-    irr::scene::IAnimatedMesh* meshPlayer = mSmgr->getMesh("../../media/models/sydney.md2");
-    nodePlayer = mSmgr->addAnimatedMeshSceneNode(meshPlayer, nodeMap, SCENE_NODE_PLAYER);
-    nodePlayer->setMaterialFlag(irr::video::EMF_LIGHTING, true);
-    nodePlayer->setMD2Animation(irr::scene::EMAT_STAND);
-    nodePlayer->setMaterialTexture(0, mDriver->getTexture("../../media/textures/sydney.bmp") );
-    nodePlayer->addShadowVolumeSceneNode(meshPlayer, -1, false);
-
-    irr::scene::IMetaTriangleSelector* MetaColisionTriangle;
-    MetaColisionTriangle = mSmgr->createMetaTriangleSelector();
-
-    // Ajoute la gestion des collisions sur le joueur
-    irr::scene::ITriangleSelector* selector;
-    selector = mSmgr->createOctreeTriangleSelector(
-            nodeMap->getMesh(), nodeMap, 128);
-    nodeMap->setTriangleSelector(selector);
-    MetaColisionTriangle->addTriangleSelector(selector);
-    selector->drop();
+    ostringstream appels;
+    appels  << "Appels de rendu du niveau: ";
+    if(batches)
+        appels << batcher.toString();
+    else
+        appels << levelGeometry->getMeshBufferCount() << " buffers (octree)";
+    appels  << ", +" << nbShaders << " shaders, "
+            << nbClusters << " clusters";
+    log(appels.str());
+
+    // Les buffers restent référencés par les nodes
+    if(batches)
+        batches->drop();
+
+    levelSelector = mSmgr->createMetaTriangleSelector();
+}
 
-    /********************************************
-    // ENTITY
-    ********************************************/
 
-    // Charge les entitées
+/**
+ * Crée les entités du niveau (leurs propriétés sont lues par le JobSystem)
+ * et récupére le point de départ du joueur
+ */
+void RenderingEngine::loadLevelEntities()
+{
     Level* level = core->getLevel();
-    level->loadEntityList(meshMap);
-    level->initializeCollisionsEntities(mSmgr, meshMap, nodePlayer);
+    level->loadEntityList(*levelEntities, core->getJobSystem());
+    level->initializeCollisionsEntities(mSmgr, l_brushMesh, levelSelector);
     level->attachEntitiesToCore(core);
 
-    level->setEntityList(meshMap->getEntityList());
+    level->setEntityList(*levelEntities);
 
     // Récupére le point de départ du joueur
     map<irr::core::stringc, irr::core::stringc> entity =
             level->getEntity("info_player_start");
 
     irr::u32 pos = 0;
-    irr::core::vector3df playerStart =
-            irr::scene::quake3::getAsVector3df(entity["origin"], pos);
+    playerStart = irr::scene::quake3::getAsVector3df(entity["origin"], pos);
+}
+
 
-    // Enregistre la position du joueur
-    core->getPlayer()->setPosition(playerStart);
+/**
+ * Charge les modéles: joueur, camera, mobs de test
+ */
+void RenderingEngine::loadLevelModels()
+{
+    /********************************************
+    // JOUEUR
+    ********************************************/
+
+    // Le joueur et le mob de test partagent leur mesh et leur texture
+    irr::scene::IAnimatedMesh* meshPlayer =
+            loadLevelMesh("../../media/models/sydney.md2");
+    irr::video::ITexture* texturePlayer =
+            loadLevelTexture("../../media/textures/sydney.bmp");
+
+    // Création du joueur
+    nodePlayer = mSmgr->addAnimatedMeshSceneNode(meshPlayer, nodeMap, SCENE_NODE_PLAYER);
+    nodePlayer->setMaterialFlag(irr::video::EMF_LIGHTING, true);
+    nodePlayer->setMD2Animation(irr::scene::EMAT_STAND);
+    nodePlayer->setMaterialTexture(0, texturePlayer);
+    nodePlayer->addShadowVolumeSceneNode(meshPlayer, -1, false);
 
     /********************************************
     // CAMERA
@@ -383,14 +1201,15 @@ void RenderingEngine::constructLevel(string name)
     *****************************************/
 
     // DEBUG MOB
-    irr::scene::IAnimatedMesh* mesh = mSmgr->getMesh("../../media/models/sydney.md2");
-    irr::scene::IAnimatedMeshSceneNode* node = mSmgr->addAnimatedMeshSceneNode(mesh, nodeMap, SCENE_NODE_MOBS);
+    irr::core::vector3df mobStart = playerStart;
+    irr::scene::IAnimatedMeshSceneNode* node = mSmgr->addAnimatedMeshSceneNode(meshPlayer, nodeMap, SCENE_NODE_MOBS);
     node->setMaterialFlag(irr::video::EMF_LIGHTING, true);
     node->setMD2Animation(irr::scene::EMAT_STAND);
-    playerStart.X -= 40;
-    node->setPosition(playerStart);
-    node->setMaterialTexture(0, mDriver->getTexture("../../media/textures/sydney.bmp") );
+    mobStart.X -= 40;
+    node->setPosition(mobStart);
+    node->setMaterialTexture(0, texturePlayer);
     node->addShadowVolumeSceneNode(meshPlayer, -1, false);
+    l_mobNode.push_back(node);
 
     //! Collisions avec la map
     irr::scene::ISceneNodeAnimatorCollisionResponse* anim;
@@ -405,57 +1224,133 @@ void RenderingEngine::constructLevel(string name)
     anim->drop();
 
     //! Collisions avec le joueur
-    // Selecteur
+    // Selecteur du rendu, la simulation a sa boite (voir Level::addMob)
+    irr::scene::ITriangleSelector* selector;
     selector = mSmgr->createTriangleSelector(node->getMesh()->getMesh(0), node);
     node->setTriangleSelector(selector);
-
-    // Collision reponse
-    anim = mSmgr->createCollisionResponseAnimator(
-            selector, nodePlayer,
-            irr::core::vector3df(10,25,10),
-            irr::core::vector3df(0,0,0),
-            irr::core::vector3df(0,0,0)
-    );
-    anim->setCollisionCallback(this);
-
     selector->drop();
-    nodePlayer->addAnimator(anim);
-    anim->drop();
+
+    core->getLevel()->addMob(node, levelSelector);
 
     // DEBUG BILLBOARD
     bill = mSmgr->addBillboardSceneNode();
     bill->setMaterialType(irr::video::EMT_TRANSPARENT_ADD_COLOR );
-    bill->setMaterialTexture(0, mDriver->getTexture("../../media/textures/lialique.bmp"));
+    bill->setMaterialTexture(0, loadLevelTexture("../../media/textures/lialique.bmp"));
     bill->setMaterialFlag(irr::video::EMF_LIGHTING, false);
     bill->setMaterialFlag(irr::video::EMF_ZBUFFER, false);
     bill->setSize(irr::core::dimension2d<irr::f32>(10.0f, 10.0f));
+}
+
+
+/**
+ * Donne un mesh du cache, gardé jusqu'au changement de niveau
+ *
+ * @param path          Chemin du mesh
+ */
+irr::scene::IAnimatedMesh* RenderingEngine::loadLevelMesh(const string& path)
+{
+    irr::scene::IAnimatedMesh* mesh = assetCache.getMesh(path);
+    if(mesh)
+        l_levelAsset.push_back(mesh);
+    else
+        log("Impossible de charger " + path, ERROR);
+
+    return mesh;
+}
+
+
+/**
+ * Donne une texture du cache, gardée jusqu'au changement de niveau
+ *
+ * @param path          Chemin de la texture
+ */
+irr::video::ITexture* RenderingEngine::loadLevelTexture(const string& path)
+{
+    irr::video::ITexture* texture = assetCache.getTexture(path);
+    if(texture)
+        l_levelAsset.push_back(texture);
+    else
+        log("Impossible de charger " + path, ERROR);
+
+    return texture;
+}
+
+
+/**
+ * Rend au cache les assets du niveau (ses nodes doivent être supprimés)
+ */
+void RenderingEngine::releaseLevelAssets()
+{
+    for(irr::u32 i=0; i<l_levelAsset.size(); i++)
+        assetCache.release(l_levelAsset[i]);
+
+    l_levelAsset.clear();
+}
+
+
+/**
+ * Termine le chargement: donne les collisions a la simulation, place le
+ * joueur puis lance la partie
+ */
+void RenderingEngine::finishLevel()
+{
+    Level* level = core->getLevel();
 
     /***********************************************
     // COLLISIONS
     ***********************************************/
 
-    // Collision du jouer avec les selector définit
-    anim = mSmgr->createCollisionResponseAnimator(
-            MetaColisionTriangle, nodePlayer,
-            irr::core::vector3df(10,25,10),     // Taille de l'ellipse
-            irr::core::vector3df(0,0,0),  // Gravité
-            irr::core::vector3df(0,0,0)         // Translation dans l'ellipse
-    );
-    anim->setCollisionCallback(this);
+    // Les collisions du joueur sont résolues par la simulation (GameEngine)
+    level->setCollisionWorld(collisionManager, levelSelector);
+    levelSelector->drop();
+    levelSelector = NULL;
 
-    nodePlayer->addAnimator(anim);
-    anim->drop();
+    // Place le joueur (appartient a la simulation)
+    module_message spawn(getId(), GAME, ACTION_PLAYER_SPAWN);
+    spawn.data.spawn.x = playerStart.X;
+    spawn.data.spawn.y = playerStart.Y;
+    spawn.data.spawn.z = playerStart.Z;
+    core->sendMessage(spawn);
+
+    levelGeneration = level->getGeneration();
 
     mSmgr->setAmbientLight(irr::video::SColorf(0.1, 0.1, 0.1,0.0));
 
-    playerStart.Y += 40;
-    playerStart.Z -= 40;
+    irr::core::vector3df lumierePosition = playerStart;
+    lumierePosition.X -= 40;
+    lumierePosition.Y += 40;
+    lumierePosition.Z -= 40;
     irr::scene::ILightSceneNode* lumiere = mSmgr->addLightSceneNode(
-            nodeMap, playerStart,
+            nodeMap, lumierePosition,
             irr::video::SColorf(0.6f, 0.6f, 0.6f, 0.0f),
             150.0f
     );
     lumiere->enableCastShadow();
+
+    // Premier chargement depuis le BSP: le cache servira aux suivants.
+    // Construit ici avec Irrlicht, écrit sur disque par un job
+    if(config["levelCache"] && meshMap) {
+        cacheJob.path = LevelCache::getPath(l_levelSource[0]);
+        if(LevelCache::serialize(l_levelSource, meshMap, l_brushMesh,
+                levelVisibility, mDevice->getFileSystem(), cacheJob.donnees))
+        {
+            cacheWriting = true;
+            atomicStore(cacheJobs, 1);
+            core->getJobSystem()->submit(
+                    &writeLevelCacheJob, &cacheJob, &cacheJobs);
+        } else
+            log("Impossible de construire " + cacheJob.path, WARNING);
+    }
+
+    ostringstream duree;
+    duree << "Niveau " << levelName << (meshMap ? "" : " (cache)")
+          << " charge en "
+          << ((TimeService::now() - levelStart) / 1000000) << " ms";
+    log(duree.str());
+
+    // La partie commence
+    core->setMenuState(IN_GAME);
+    core->setPartieEnPause(false);
 }
 
 
@@ -572,17 +1467,29 @@ void RenderingEngine::applyConfigChanges()
 
 
 /**
- * Applique la position du joueur sur la camera et le nodePlayer
+ * Affiche le joueur et les entités bloc a leur position simulée. Le joueur
+ * est interpolé entre les deux derniers pas de simulation.
+ *
+ * @param monde         Dernier état publié par la simulation
  */
-void RenderingEngine::refreshPlayer()
+void RenderingEngine::refreshWorld(const WorldSnapshot& monde)
 {
-    Player* player = core->getPlayer();
+    irr::core::vector3df position =
+            monde.getInterpolatedPosition(
+                    core->getTimeService()->getGameTime());
+
+    nodePlayer->setPosition(position);
+    nodePlayer->setRotation(monde.rotation);
+
+    camera->setPosition(core->getPlayer()->getCameraPosition(position));
+    camera->setTarget(position);
 
-    nodePlayer->setPosition(player->getPosition());
-    nodePlayer->setRotation(player->getRotation());
+    for(irr::u32 i=0; i<monde.l_entity.size(); i++) {
+        const EntityTransform& transform = monde.l_entity[i];
 
-    camera->setPosition(player->getCameraPosition());
-    camera->setTarget(player->getPosition());
+        transform.node->setPosition(transform.position);
+        transform.node->setRotation(transform.rotation);
+    }
 }
 
 
@@ -612,26 +1519,3 @@ void RenderingEngine::OnSetConstants(
     float val = 0.2; // Taille des bords
     services->setPixelShaderConstant("silhouetteThreshold", &val, 1);
 }
-
-
-/**
- * Appelé en cas de colision
- *
- * @param animator      Infos sur la colision
- */
-bool RenderingEngine::onCollision(
-        const irr::scene::ISceneNodeAnimatorCollisionResponse &animator)
-{
-    // Objet qui sur lequel la colision a lieu
-    irr::scene::ISceneNode* nodeCollide = animator.getTargetNode();
-
-    // Si c'est le joueur
-    if(nodeCollide->getID() == SCENE_NODE_PLAYER) {
-        core->getPlayer()->onCollision(animator);
-        refreshPlayer();
-    } else {
-        cout << "Collision non geree: " << nodeCollide->getID() <<endl;
-    }
-
-    return true;
-}
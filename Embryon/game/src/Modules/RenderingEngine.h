@@ -6,8 +6,18 @@
 
 #include <irrlicht.h>
 #include <map>
+#include <string>
+#include <vector>
 
 #include "Module.h"
+#include "../AssetCache.h"
+#include "../CullingSceneNode.h"
+#include "../LevelCache.h"
+#include "../LevelVisibility.h"
+#include "../Core/FramePacer.h"
+#include "../Core/GameState.h"
+#include "../Core/InputLatencyProbe.h"
+#include "../Core/WorldSnapshot.h"
 
 using namespace std;
 
@@ -15,6 +25,51 @@ class Core;
 class EventsEngine;
 
 
+/// Etapes du chargement d'un niveau, une par image
+enum EnumLevelLoading
+{
+    LEVEL_LOADING_AUCUN = 0,        // Aucun chargement en cours
+    LEVEL_LOADING_LECTURE,          // Lecture des fichiers (job)
+    LEVEL_LOADING_BSP,              // Carte et textures
+    LEVEL_LOADING_GEOMETRIE,        // Nodes de la carte
+    LEVEL_LOADING_COLLISIONS,       // Octree de collision
+    LEVEL_LOADING_ENTITES,          // Entités du niveau
+    LEVEL_LOADING_MODELES,          // Joueur, mobs
+    LEVEL_LOADING_FIN,              // Collisions, lumiéres, début de partie
+    LEVEL_LOADING_COUNT
+};
+
+/// Données partagées avec les jobs du chargement
+struct LevelLoadingJob
+{
+    vector<string> l_fichier;                   // Fichiers a lire d'avance
+};
+
+/// Ecriture du LevelCache confiée au JobSystem
+struct LevelCacheJob
+{
+    string path;
+    string donnees;                             // Construit par serialize
+    bool resultat;
+};
+
+/// Node de la carte contenu dans un cluster du PVS
+struct ClusterNode
+{
+    irr::scene::ISceneNode* node;
+    irr::s32 cluster;
+};
+
+/// Nodes écartés pendant une image
+struct CullingStats
+{
+    irr::s32 cluster;                           // De la caméra
+    irr::u32 nbNodes;                           // Testés
+    irr::u32 nbPvs;                             // Hors du PVS: masqués
+    irr::u32 nbFrustum;                         // Hors du champ de vision
+};
+
+
 /** \class  RenderingEngine
  *  \brief  Gére l'affichage et les différents rendu via Irrlicht.
  *
@@ -22,12 +77,17 @@ class EventsEngine;
  * de chaque menu se fait par l'une des méthodes de ce Module.
  *
  * La création du rendu des différents éléments du jeu se fait dans ce Module.
- * Gére également les collisions du joueur avec l'environnement.
+ * Le joueur est affiché a une position interpolée entre les deux derniers
+ * pas de simulation de GameEngine, qui résout ses collisions.
+ *
+ * Un niveau est chargé par étapes, une par image, derriére l'écran de
+ * chargement: Irrlicht n'est utilisable que depuis ce thread, seule la
+ * lecture des fichiers est confiée au JobSystem.
  */
 class RenderingEngine :
     public Module,
-    public irr::scene::ICollisionCallback,
-    public irr::video::IShaderConstantSetCallBack
+    public irr::video::IShaderConstantSetCallBack,
+    public CullingCallBack
 {
     public:
         RenderingEngine(
@@ -36,13 +96,12 @@ class RenderingEngine :
 
         void initialize();
         void unInitialize();
-        void frame();
 
-        void loadRenderingConfig();
+        void begin();
+        bool step();
+        void end();
 
-        // Callback de collisions joueur
-        bool onCollision (
-                const irr::scene::ISceneNodeAnimatorCollisionResponse &animator);
+        void loadRenderingConfig();
     protected:
     private:
         EventsEngine* eventsEngine;
@@ -53,6 +112,77 @@ class RenderingEngine :
         irr::gui::IGUIEnvironment* mGuienv;
 
         irr::core::line3d<irr::f32> mouseRay;
+        irr::scene::ISceneCollisionManager* collisionManager;
+
+        // Limitation du FPS (fps, vsync et spin, section VIDEO)
+        FramePacer framePacer;
+
+        // Latence entrée -> image (latency, section VIDEO)
+        bool latencyHarness;
+        InputLatencyProbe inputLatency;
+        irr::u32 inputTick;                 // Dernier WorldSnapshot::inputTick vu
+        irr::u32 nbPendingInputs;           // Entrées affichées par l'image
+        boost::uint64_t lastInputTime;      // Derniére capture retenue
+        boost::uint64_t l_pendingInput[SNAPSHOT_INPUT_MAX];
+        boost::uint64_t latencyRefresh;     // Rafraichissement du texte
+        irr::core::stringw latencyText;
+        void trackInputs(const WorldSnapshot& monde);
+        void drawLatency();
+
+        // Meshes et textures, conservés d'un niveau a l'autre (assetBudget,
+        // section VIDEO)
+        AssetCache assetCache;
+        vector<irr::IReferenceCounted*> l_levelAsset;   // Pris par le niveau
+        irr::scene::IAnimatedMesh* loadLevelMesh(const string& path);
+        irr::video::ITexture* loadLevelTexture(const string& path);
+        void releaseLevelAssets();
+
+        // Niveau construit, comparé a celui du WorldSnapshot
+        irr::u32 levelGeneration;
+
+        // Chargement du niveau en cours
+        EnumLevelLoading levelLoading;
+        string levelName;
+        volatile irr::u32 levelJobs;        // Job de l'étape en cours
+        LevelLoadingJob levelJob;
+        boost::uint64_t levelStart;
+        irr::scene::IMeshSceneNode* nodeMap;
+        irr::scene::IMetaTriangleSelector* levelSelector;
+        irr::core::vector3df playerStart;
+
+        // Données du niveau, lues dans le BSP ou dans son LevelCache
+        // (levelCache, section VIDEO)
+        vector<string> l_levelSource;           // Archives du niveau
+        LevelCache levelCache;
+        volatile irr::u32 cacheJobs;            // Ecriture du cache en cours
+        LevelCacheJob cacheJob;
+        bool cacheWriting;                      // Résultat pas encore lu
+        void finishLevelCache(bool attendre);
+        irr::scene::IQ3LevelMesh* meshMap;      // NULL si lu dans le cache
+        irr::scene::IMesh* levelGeometry;
+        const irr::scene::quake3::tQ3EntityList* levelEntities;
+        vector<irr::scene::IMesh*> l_brushMesh; // Index: modéle "*n"
+        void loadLevelMap();
+        bool loadLevelCache();
+        const irr::scene::quake3::IShader* getLevelShader(irr::s32 index);
+
+        // Visibilité: les nodes hors du PVS de la caméra sont masqués le
+        // temps de drawAll, aprés leur animation (visibility et pvsStats,
+        // section VIDEO)
+        LevelVisibility levelVisibility;
+        CullingSceneNode* cullingNode;          // Appelle OnCull
+        const WorldSnapshot* cullingWorld;      // Pendant drawAll
+        vector<ClusterNode> l_clusterNode;      // Géométrie et shaders
+        vector<irr::scene::ISceneNode*> l_mobNode;
+        vector<irr::scene::ISceneNode*> l_culledNode;   // Masqués par l'image
+        CullingStats culling;                   // Derniére image
+        CullingStats cullingTotal;
+        irr::u32 nbCullingFrames;
+        void cullLevel(const WorldSnapshot* monde);
+        void cullNode(irr::scene::ISceneNode* node, bool visible);
+        bool isBoxVisible(irr::s32 depuis, const irr::core::aabbox3df& boite);
+        void restoreCulledNodes();
+        void drawCulling();
 
         // Modéles du jeu
         irr::scene::ICameraSceneNode* camera;
@@ -62,6 +192,8 @@ class RenderingEngine :
 
         map<int, irr::gui::IGUIElement*> l_guiElement;
 
+        // Etat du jeu au dernier ACTION_GAME_STATE_CHANGED
+        GameState gameState;
         int currentMenu;
 
         // DEBUG
@@ -72,19 +204,35 @@ class RenderingEngine :
         //Mouse
         irr::video::ITexture* cursor;
         irr::core::dimension2d<irr::s32> cursorDimension;
+        irr::core::position2d<irr::s32> replayCursor;   // Relu du journal
 
+        irr::core::position2d<irr::s32> getCursorPosition();
+        void selectSceneNode(irr::core::position2d<irr::s32> position);
+
+        void wait();
         void processMessage(module_message& msg);
+        void onGameStateChanged(GameState nouveau);
         void constructLevel(string name);
+        void stepLevel();
+        void setLevelLoading(EnumLevelLoading etape);
+        void abortLevel();
+        void loadLevelGeometry();
+        void loadLevelEntities();
+        void loadLevelModels();
+        void finishLevel();
         void applyConfigChanges();
 
-        // Récupére les informations du joueur
-        void refreshPlayer();
+        // Applique le dernier état publié par la simulation
+        void refreshWorld(const WorldSnapshot& monde);
 
         // Callback de shaders
         virtual void OnSetConstants(
                 irr::video::IMaterialRendererServices* services,
                 irr::s32 userData
         );
+
+        // Callback de CullingSceneNode
+        virtual void OnCull();
 };
 
 #endif // RENDERINGENGINE_H
@@ -16,7 +16,10 @@ Player::Player()
     setStrafeLeft(false);
     setStrafeRight(false);
 
-    lastPositionUpdate = -1;
+    viseurDirty = true;
+
+    vie = 100;
+    armure = 0;
     setSpeed(0.2f);
 }
 
@@ -42,38 +45,75 @@ void Player::takeDamage(int degats)
 
 
 /**
- * Met la position donnée a jour en fonction du deplacement du joueur
+ * Passe au pas de simulation suivant. La position précédente est
+ * conservée pour l'interpolation de l'affichage.
+ *
+ * @param position      Position a la fin du pas
  */
-void Player::updatePosition()
+void Player::advancePosition(irr::core::vector3df position)
 {
-    int x = 0, z = 0;
+    previousPosition = this->position;
+    applyPosition(position);
+}
 
-    irr::u32 currentTime = getTime();
-    irr::f32 elapsedTime = (irr::f32)(currentTime - lastPositionUpdate);
 
-    if(forwards)    x += 1;
-    if(backwards)   x -= 1;
-    if(strafeLeft)  z += 1;
-    if(strafeRight) z -= 1;
+/**
+ * Ecarte le joueur d'un mob qu'il vient de heurter
+ *
+ * @param cibleId       Type de l'obstacle heurté (SCENE_NODE_*)
+ * @param ciblePosition Sa position (voir Level::collide)
+ * @param position      Position aprés collision
+ *
+ * @return              Position corrigée
+ */
+irr::core::vector3df Player::repousser(irr::s32 cibleId,
+        const irr::core::vector3df& ciblePosition,
+        irr::core::vector3df position)
+{
+    irr::core::line2d<irr::f32> ray;
+
+    switch(cibleId) {
+        case SCENE_NODE_MOBS:       // MOBS
+            ray.start.X = ciblePosition.X;
+            ray.start.Y = ciblePosition.Z;
+            ray.end.X = position.X;
+            ray.end.Y = position.Z;
+
+            position.X += ray.getUnitVector().X * 0.2f;
+            position.Z += ray.getUnitVector().Y * 0.2f;
+            break;
+        default:                    // MAP
+            break;
+    }
+
+    return position;
+}
 
-    // NB: En cas de ralentissement, le joueur peut traverser les murs
-    // Cet effet est particuliérement vicieux sur la gravité, d'ou la gravité fixe
 
-    position.X += getSpeed() * x * elapsedTime;
-    position.Y -= getSpeed() * elapsedTime;
-    position.Z += getSpeed() * z * elapsedTime;
+/**
+ * Récupére la derniére ligne de visée de la souris transmise par le rendu
+ * et recalcule la visée si elle ou la position a changé
+ */
+void Player::refreshViseur()
+{
+    if(mouseRayBuffer.update()) {
+        mouseRay = mouseRayBuffer.getReadBuffer();
+        viseurDirty = true;
+    }
 
-    setPosition(position);
+    if(viseurDirty)
+        updateViseurRay();
 }
 
 
 /**
- * Met a jour la ligne de visée du joueur
+ * Met a jour la ligne de visée et l'orientation du joueur, d'aprés la
+ * position et la ligne de visée de la souris
  */
 void Player::updateViseurRay()
 {
     irr::core::vector3df viseurPosition;
-    float y = getPosition().Y;
+    float y = position.Y;
 
     // Crée le plan d'intersection
     irr::core::plane3df mousePlane(
@@ -91,8 +131,8 @@ void Player::updateViseurRay()
 
     // Vecteur de visée en 2D
     irr::core::line2df viseur2D;
-    viseur2D.start.X = getViseurRay().start.X;
-    viseur2D.start.Y = getViseurRay().start.Z;
+    viseur2D.start.X = viseurRay.start.X;
+    viseur2D.start.Y = viseurRay.start.Z;
     viseur2D.end.X = viseurPosition.X;
     viseur2D.end.Y = viseurPosition.Z;
 
@@ -102,22 +142,31 @@ void Player::updateViseurRay()
     viseurPosition.X = viseur2D.start.X + viseur2D.getUnitVector().X * 50; //portee joueur
     viseurPosition.Z = viseur2D.start.Y + viseur2D.getUnitVector().Y * 50; //portee joueur
 
-    // Met le viseur du joueur a jour
-    setViseurPosition(viseurPosition);
+    // Met le viseur du joueur a jour et le ré-oriente
+    viseurRay.end = viseurPosition;
+    rotation = viseurRay.getVector().getHorizontalAngle();
+
+    viseurDirty = false;
 }
 
 
 /**
- * Met a jour la rotation en fonction de la visée
+ * Copie l'état du joueur dans le WorldSnapshot du pas en cours
+ *
+ * @param snapshot      Snapshot a remplir
  */
-void Player::updateRotation()
+void Player::writeSnapshot(WorldSnapshot& snapshot)
 {
-    irr::core::vector3df rotation;
-    rotation = viseurRay.getVector().getHorizontalAngle();
-    setRotation(rotation);
+    snapshot.previousPosition = previousPosition;
+    snapshot.position = position;
+    snapshot.rotation = getRotation();
+    snapshot.viseurRay = getViseurRay();
+    snapshot.vie = vie;
+    snapshot.armure = armure;
 }
 
 
+
 // Accesseurs
 /**
  * Donne la position de la camera
@@ -126,8 +175,19 @@ void Player::updateRotation()
  */
 irr::core::vector3df Player::getCameraPosition()
 {
-    irr::core::vector3df position = getPosition();
+    return getCameraPosition(getPosition());
+}
 
+
+/**
+ * Donne la position de la camera pour une position du joueur
+ *
+ * @param position      Position du joueur
+ *
+ * @return              Position de la camera
+ */
+irr::core::vector3df Player::getCameraPosition(irr::core::vector3df position)
+{
     position.X -= 50;
     position.Y += 150;
 
@@ -142,11 +202,31 @@ irr::core::vector3df Player::getCameraPosition()
  */
 irr::core::vector3df Player::getPosition()
 {
-    boost::mutex::scoped_lock l(mutexPlayer);
     return position;
 }
 
 
+/**
+ * Donne le déplacement souhaité du joueur pendant dt, gravité comprise
+ *
+ * @param dt    Durée du pas de simulation (ms)
+ *
+ * @return      Déplacement
+ */
+irr::core::vector3df Player::getDeplacement(irr::f32 dt)
+{
+    int x = 0, z = 0;
+
+    if(forwards)    x += 1;
+    if(backwards)   x -= 1;
+    if(strafeLeft)  z += 1;
+    if(strafeRight) z -= 1;
+
+    // Gravité fixe
+    return irr::core::vector3df(speed * x * dt, -speed * dt, speed * z * dt);
+}
+
+
 /**
  * Donne la rotation du joueur
  *
@@ -154,7 +234,7 @@ irr::core::vector3df Player::getPosition()
  */
 irr::core::vector3df Player::getRotation()
 {
-    boost::mutex::scoped_lock l(mutexPlayer);
+    refreshViseur();
     return rotation;
 }
 
@@ -166,7 +246,7 @@ irr::core::vector3df Player::getRotation()
  */
 irr::core::line3df Player::getViseurRay()
 {
-    boost::mutex::scoped_lock l(mutexPlayer);
+    refreshViseur();
     return viseurRay;
 }
 
@@ -178,7 +258,6 @@ irr::core::line3df Player::getViseurRay()
  */
 int Player::getVie()
 {
-    boost::mutex::scoped_lock l(mutexPlayer);
     return vie;
 }
 
@@ -190,7 +269,6 @@ int Player::getVie()
  */
 int Player::getArmure()
 {
-    boost::mutex::scoped_lock l(mutexPlayer);
     return armure;
 }
 
@@ -202,35 +280,35 @@ int Player::getArmure()
  */
 float Player::getSpeed()
 {
-    boost::mutex::scoped_lock l(mutexPlayer);
     return speed;
 }
 
 
 // Mutateurs
 /**
- * modifie la position du joueur et celle de la caméra
+ * Place le joueur sans interpolation (téléportation, début de niveau)
  *
  * @param position          Nouvelle position du joueur
  */
 void Player::setPosition(irr::core::vector3df position)
 {
-    boost::mutex::scoped_lock l(mutexPlayer);
+    previousPosition = position;
+    applyPosition(position);
+}
+
 
-    // Modifie la position du joueur
+/**
+ * modifie la position du joueur et celle de son viseur. La visée sera
+ * recalculée a sa prochaine lecture.
+ *
+ * @param position          Nouvelle position du joueur
+ */
+void Player::applyPosition(irr::core::vector3df position)
+{
     this->position = position;
-    lastPositionUpdate = getTime();
-    viseurRay.start = position;         // Viseur
-
-    // Modifie le mouseRay (on a déplacé la caméra)
-    l.unlock();
-    position = getCameraPosition();
-    l.lock();
-    mouseRay.start = position;
-
-    // Met la rotation du joueur a jour
-    l.unlock();
-    updateViseurRay();
+    viseurRay.start = position;
+
+    viseurDirty = true;
 }
 
 
@@ -241,41 +319,21 @@ void Player::setPosition(irr::core::vector3df position)
  */
 void Player::setRotation(irr::core::vector3df rotation)
 {
-    boost::mutex::scoped_lock l(mutexPlayer);
     this->rotation = rotation;
 }
 
 
 /**
- * Met le mouseRay a jour
+ * Transmet le mouseRay a la simulation, qui en tient compte au pas suivant.
+ * Appelé par le rendu.
  *
  * @param mouseRay          Nouveau mouseRay (vecteur partant de la camera
  *                          Vers la souris)
  */
 void Player::setMouseRay(irr::core::line3d<irr::f32> mouseRay)
 {
-    boost::mutex::scoped_lock l(mutexPlayer);
-    this->mouseRay = mouseRay;
-
-    // Recalcule la position du viseur
-    l.unlock();
-    updateViseurRay();
-}
-
-
-/**
- * Met le viseur du joueur a jour
- *
- * @param viseurPosition        Nouvelle position du viseur
- */
-void Player::setViseurPosition(irr::core::vector3df viseurPosition)
-{
-    boost::mutex::scoped_lock l(mutexPlayer);
-    viseurRay.end = viseurPosition;
-
-    // On a modifié la position du viseur, il faut ré-orienter le joueur
-    l.unlock();
-    updateRotation();
+    mouseRayBuffer.getWriteBuffer() = mouseRay;
+    mouseRayBuffer.publish();
 }
 
 
@@ -286,7 +344,6 @@ void Player::setViseurPosition(irr::core::vector3df viseurPosition)
  */
 void Player::setForwards(bool forwards)
 {
-    boost::mutex::scoped_lock l(mutexPlayer);
     this->forwards = forwards;
 }
 
@@ -298,7 +355,6 @@ void Player::setForwards(bool forwards)
  */
 void Player::setBackwards(bool backwards)
 {
-    boost::mutex::scoped_lock l(mutexPlayer);
     this->backwards = backwards;
 }
 
@@ -310,7 +366,6 @@ void Player::setBackwards(bool backwards)
  */
 void Player::setStrafeLeft(bool strafeLeft)
 {
-    boost::mutex::scoped_lock l(mutexPlayer);
     this->strafeLeft = strafeLeft;
 }
 
@@ -322,7 +377,6 @@ void Player::setStrafeLeft(bool strafeLeft)
  */
 void Player::setStrafeRight(bool strafeRight)
 {
-    boost::mutex::scoped_lock l(mutexPlayer);
     this->strafeRight = strafeRight;
 }
 
@@ -334,41 +388,5 @@ void Player::setStrafeRight(bool strafeRight)
  */
 void Player::setSpeed(float speed)
 {
-    boost::mutex::scoped_lock l(mutexPlayer);
     this->speed = speed;
 }
-
-
-// Callback
-/**
- * Appelé si le joueur fonce dans un truc
- *
- * @param animator      Infos sur la colision
- */
-bool Player::onCollision(
-        const irr::scene::ISceneNodeAnimatorCollisionResponse &animator)
-{
-    const irr::scene::ISceneNode* cible = animator.getCollisionNode();
-    irr::core::vector3df newPosition = animator.getCollisionResultPosition();
-
-    irr::core::line2d<irr::f32> ray;
-
-    switch(cible->getID()) {
-        case SCENE_NODE_MOBS:       // MOBS
-            ray.start.X = cible->getPosition().X;
-            ray.start.Y = cible->getPosition().Z;
-            ray.end.X = newPosition.X;
-            ray.end.Y = newPosition.Z;
-
-            newPosition.X += ray.getUnitVector().X * 0.2f;
-            newPosition.Z += ray.getUnitVector().Y * 0.2f;
-            break;
-        default:                    // MAP
-            break;
-    }
-
-    // Met a jour la position du joueur
-    setPosition(newPosition);
-
-    return true;
-}
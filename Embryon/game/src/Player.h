@@ -4,10 +4,12 @@
 #ifndef PLAYER_H
 #define PLAYER_H
 
-#include <boost/thread/mutex.hpp>
 #include <list>
 #include <irrlicht.h>
 
+#include "Core/TripleBuffer.h"
+#include "Core/WorldSnapshot.h"
+
 using namespace std;
 
 
@@ -17,22 +19,34 @@ using namespace std;
  * Contient la position du joueur, sa vie, son armure, sa position. Fournit
  * un ensemble de méthodes permettant d'agir sur le joueur (dégats, mouvements,
  * ...).
+ *
+ * Le joueur appartient a la simulation (GameEngine): seul son thread le
+ * modifie et le lit. Le rendu ne fait que lui transmettre la ligne de visée
+ * de la souris (setMouseRay) et affiche le WorldSnapshot publié a chaque pas.
+ *
+ * La ligne de visée et l'orientation dépendent de la position et de la
+ * souris: elles ne sont recalculées qu'a leur lecture, si l'une des deux a
+ * changé (une fois par pas, par writeSnapshot).
  */
 /// \todo implémenter Camera séparement
-class Player : public irr::scene::ICollisionCallback
+class Player
 {
     public:
         Player();
         virtual ~Player();
 
         void takeDamage(int degats);
-        void updatePosition();
-        void updateViseurRay();
-        void updateRotation();
+        void advancePosition(irr::core::vector3df position);
+        irr::core::vector3df repousser(irr::s32 cibleId,
+                const irr::core::vector3df& ciblePosition,
+                irr::core::vector3df position);
+        void writeSnapshot(WorldSnapshot& snapshot);
 
         // Accesseurs
         irr::core::vector3df getCameraPosition();
+        irr::core::vector3df getCameraPosition(irr::core::vector3df position);
         irr::core::vector3df getPosition();
+        irr::core::vector3df getDeplacement(irr::f32 dt);
         irr::core::vector3df getRotation();
         irr::core::line3df getViseurRay();
         int getVie();
@@ -43,27 +57,28 @@ class Player : public irr::scene::ICollisionCallback
         void setPosition(irr::core::vector3df position);
         void setRotation(irr::core::vector3df rotation);
         void setMouseRay(irr::core::line3d<irr::f32> mouseRay);
-        void setViseurPosition(irr::core::vector3df viseurPosition);
         void setForwards(bool forwards);
         void setBackwards(bool backwards);
         void setStrafeLeft(bool strafeLeft);
         void setStrafeRight(bool strafeRight);
         void setSpeed(float speed);
-
-        // Callback de collisions joueur
-        bool onCollision (
-                const irr::scene::ISceneNodeAnimatorCollisionResponse &animator);
     protected:
     private:
-        boost::mutex mutexPlayer;
+        void applyPosition(irr::core::vector3df position);
+        void refreshViseur();
+        void updateViseurRay();
 
-        irr::u32 lastPositionUpdate;
+        // Position au pas précédent, pour l'interpolation de l'affichage
+        irr::core::vector3df previousPosition;
 
         irr::core::vector3df position;
         irr::core::vector3df rotation;
 
+        // Ligne de visée de la souris, écrite par le rendu
+        TripleBuffer< irr::core::line3d<irr::f32> > mouseRayBuffer;
         irr::core::line3d<irr::f32> mouseRay;
         irr::core::line3d<irr::f32> viseurRay;
+        bool viseurDirty;               // viseurRay et rotation a recalculer
 
         int vie;
         int armure;
@@ -0,0 +1,328 @@
+/** \file   StaticBatcher.cpp
+ *  \brief  Implémente la classe StaticBatcher
+ */
+#include "StaticBatcher.h"
+
+#include <algorithm>
+#include <sstream>
+
+
+/**
+ * Donne le cluster d'un triangle: celui de son centre et de ses sommets
+ * (rapprochés du centre), poussés devant la face
+ *
+ * @param visibility    PVS de la carte
+ * @param buffer        Mesh buffer du triangle
+ * @param triangle      Ses trois indices
+ *
+ * @return              -1 si les points ne sont pas dans un même cluster
+ */
+static irr::s32 getTriangleCluster(const LevelVisibility* visibility,
+        const irr::scene::IMeshBuffer* buffer, const irr::u16* triangle)
+{
+    irr::u32 pitch = irr::video::getVertexPitchFromType(buffer->getVertexType());
+    const char* vertices = (const char*)buffer->getVertices();
+
+    // Tout les types de vertex commencent par un S3DVertex
+    const irr::video::S3DVertex* sommet[3];
+    for(irr::u32 i=0; i<3; i++)
+        sommet[i] = (const irr::video::S3DVertex*)(vertices + triangle[i] * pitch);
+
+    irr::core::vector3df centre =
+            (sommet[0]->Pos + sommet[1]->Pos + sommet[2]->Pos) / 3.0f;
+    irr::core::vector3df normale =
+            sommet[0]->Normal + sommet[1]->Normal + sommet[2]->Normal;
+    if(normale.getLength() > 0)
+        normale.normalize();
+    normale = normale * BATCH_CLUSTER_OFFSET;
+
+    irr::s32 cluster = visibility->getCluster(centre + normale);
+    for(irr::u32 i=0; i<3 && cluster >= 0; i++) {
+        irr::core::vector3df point = sommet[i]->Pos
+                + (centre - sommet[i]->Pos) * 0.1f + normale;
+        if(visibility->getCluster(point) != cluster)
+            cluster = -1;
+    }
+
+    return cluster;
+}
+
+
+/**
+ * Ordre des clés: regroupe les mesh buffers de même cluster et matériau
+ */
+bool StaticBatcher::BatchKey::operator<(const BatchKey& autre) const
+{
+    if(cluster != autre.cluster)
+        return cluster < autre.cluster;
+    if(vertexType != autre.vertexType)
+        return vertexType < autre.vertexType;
+    return material < autre.material;
+}
+
+
+/**
+ * Constructeur de StaticBatcher
+ */
+StaticBatcher::StaticBatcher()
+{
+    nbSources = 0;
+    nbBatches = 0;
+    nbClusters = 0;
+    nbMergedClusters = 0;
+}
+
+/**
+ * Destructeur de StaticBatcher
+ */
+StaticBatcher::~StaticBatcher()
+{
+}
+
+
+/**
+ * Fusionne les mesh buffers d'un mesh par matériau, et par cluster si le
+ * PVS est donné
+ *
+ * @param mesh          Mesh statique (géométrie du niveau)
+ * @param visibility    PVS de la carte, NULL pour ne pas séparer les
+ *                      clusters
+ * @param minTriangles  Triangles en dessous desquels un cluster n'est pas
+ *                      séparé (cluster -1)
+ *
+ * @return              Nouveau mesh (une référence), EHM_STATIC
+ */
+irr::scene::SMesh* StaticBatcher::build(irr::scene::IMesh* mesh,
+        const LevelVisibility* visibility, irr::u32 minTriangles)
+{
+    map<BatchKey, vector<BatchPiece> > l_groupe;
+
+    nbSources = 0;
+    nbBatches = 0;
+    nbClusters = 0;
+    nbMergedClusters = 0;
+    l_cluster.clear();
+    l_material.clear();
+
+    if(visibility && !visibility->isEnabled())
+        visibility = NULL;
+
+    // Triangles de chaque buffer, par cluster, et taille des clusters
+    vector<map<irr::s32, vector<irr::u32> > > l_bufferTriangle(
+            mesh->getMeshBufferCount());
+    map<irr::s32, irr::u32> l_clusterSize;
+    for(irr::u32 i=0; i<mesh->getMeshBufferCount(); i++) {
+        irr::scene::IMeshBuffer* buffer = mesh->getMeshBuffer(i);
+        if(buffer->getIndexCount() == 0)
+            continue;
+
+        if(visibility) {
+            const irr::u16* indices = buffer->getIndices();
+            for(irr::u32 j=0; j+2<buffer->getIndexCount(); j+=3) {
+                irr::s32 cluster =
+                        getTriangleCluster(visibility, buffer, indices + j);
+                l_bufferTriangle[i][cluster].push_back(j);
+                l_clusterSize[cluster]++;
+            }
+        }
+        else
+            l_bufferTriangle[i][-1];
+    }
+
+    map<irr::s32, irr::u32>::iterator taille;
+    for(taille = l_clusterSize.begin(); taille != l_clusterSize.end(); taille++)
+        if(taille->first >= 0) {
+            nbClusters++;
+            if(taille->second < minTriangles)
+                nbMergedClusters++;
+        }
+
+    for(irr::u32 i=0; i<mesh->getMeshBufferCount(); i++) {
+        irr::scene::IMeshBuffer* buffer = mesh->getMeshBuffer(i);
+        if(buffer->getIndexCount() == 0)
+            continue;
+
+        BatchKey key;
+        key.cluster = -1;
+        key.vertexType = buffer->getVertexType();
+        key.material = findMaterial(buffer->getMaterial());
+
+        nbSources++;
+
+        // Les petits clusters rejoignent le cluster -1, dans l'ordre du
+        // buffer
+        map<irr::s32, vector<irr::u32> >& l_triangle = l_bufferTriangle[i];
+        map<irr::s32, vector<irr::u32> >::iterator it = l_triangle.begin();
+        bool fusion = false;
+        while(it != l_triangle.end()) {
+            if(it->first >= 0 && l_clusterSize[it->first] < minTriangles) {
+                vector<irr::u32>& l_visible = l_triangle[-1];
+                l_visible.insert(l_visible.end(),
+                        it->second.begin(), it->second.end());
+                l_triangle.erase(it++);
+                fusion = true;
+            }
+            else
+                it++;
+        }
+        if(fusion)
+            sort(l_triangle[-1].begin(), l_triangle[-1].end());
+
+        for(it = l_triangle.begin(); it != l_triangle.end(); it++) {
+            key.cluster = it->first;
+
+            BatchPiece piece;
+            piece.buffer = buffer;
+            if(l_triangle.size() > 1)
+                piece.l_triangle.swap(it->second);
+
+            l_groupe[key].push_back(piece);
+        }
+    }
+
+    irr::scene::SMesh* batches = new irr::scene::SMesh();
+
+    map<BatchKey, vector<BatchPiece> >::iterator it;
+    for(it = l_groupe.begin(); it != l_groupe.end(); it++) {
+        switch(it->first.vertexType) {
+        case irr::video::EVT_STANDARD:
+            merge<irr::video::S3DVertex>(
+                    it->second, it->first.cluster, batches);
+            break;
+        case irr::video::EVT_2TCOORDS:
+            merge<irr::video::S3DVertex2TCoords>(
+                    it->second, it->first.cluster, batches);
+            break;
+        case irr::video::EVT_TANGENTS:
+            merge<irr::video::S3DVertexTangents>(
+                    it->second, it->first.cluster, batches);
+            break;
+        default: break;
+        }
+    }
+
+    batches->recalculateBoundingBox();
+    batches->setHardwareMappingHint(irr::scene::EHM_STATIC);
+
+    return batches;
+}
+
+
+/**
+ * Donne l'index d'un matériau parmi ceux déja rencontrés, en l'ajoutant
+ * s'il est nouveau. Compare tout l'état du matériau (SMaterial n'a pas
+ * d'ordre).
+ *
+ * @param material      Matériau d'un mesh buffer
+ */
+irr::u32 StaticBatcher::findMaterial(const irr::video::SMaterial& material)
+{
+    for(irr::u32 i=0; i<l_material.size(); i++)
+        if(l_material[i] == material)
+            return i;
+
+    l_material.push_back(material);
+    return l_material.size() - 1;
+}
+
+
+/**
+ * Concatène des morceaux de mesh buffers de même matériau, en commençant
+ * un nouveau buffer quand les indices 16 bits ne suffisent plus. Seuls
+ * les vertices utilisés par les triangles sont copiés.
+ *
+ * @param l_piece       Morceaux a fusionner (vertices de type Vertex)
+ * @param cluster       Cluster des morceaux
+ * @param batches       Reçoit les buffers fusionnés
+ */
+template<class Vertex>
+void StaticBatcher::merge(const vector<BatchPiece>& l_piece, irr::s32 cluster,
+        irr::scene::SMesh* batches)
+{
+    irr::scene::CMeshBuffer<Vertex>* batch = NULL;
+
+    for(irr::u32 i=0; i<=l_piece.size(); i++) {
+        const BatchPiece* piece = i < l_piece.size() ? &l_piece[i] : NULL;
+
+        // Indices du morceau, et ses vertices dans l'ordre d'utilisation
+        vector<irr::u16> l_index;
+        vector<irr::s32> l_remap;
+        vector<irr::u16> l_vertex;
+        if(piece) {
+            const irr::u16* indices = piece->buffer->getIndices();
+            if(piece->l_triangle.empty())
+                l_index.assign(indices, indices + piece->buffer->getIndexCount());
+            else
+                for(irr::u32 j=0; j<piece->l_triangle.size(); j++)
+                    l_index.insert(l_index.end(),
+                            indices + piece->l_triangle[j],
+                            indices + piece->l_triangle[j] + 3);
+
+            l_remap.resize(piece->buffer->getVertexCount(), -1);
+            for(irr::u32 j=0; j<l_index.size(); j++)
+                if(l_remap[l_index[j]] < 0) {
+                    l_remap[l_index[j]] = l_vertex.size();
+                    l_vertex.push_back(l_index[j]);
+                }
+        }
+
+        // Termine le buffer en cours s'il est plein ou si c'était le dernier
+        if(batch && (!piece || batch->Vertices.size()
+                + l_vertex.size() > BATCH_MAX_VERTICES)) {
+            batch->recalculateBoundingBox();
+            batches->addMeshBuffer(batch);
+            batch->drop();
+            batch = NULL;
+            l_cluster.push_back(cluster);
+            nbBatches++;
+        }
+
+        if(!piece)
+            break;
+
+        if(!batch) {
+            batch = new irr::scene::CMeshBuffer<Vertex>();
+            batch->Material = piece->buffer->getMaterial();
+        }
+
+        irr::u32 base = batch->Vertices.size();
+
+        const Vertex* vertices = (const Vertex*)piece->buffer->getVertices();
+        for(irr::u32 j=0; j<l_vertex.size(); j++)
+            batch->Vertices.push_back(vertices[l_vertex[j]]);
+
+        for(irr::u32 j=0; j<l_index.size(); j++)
+            batch->Indices.push_back((irr::u16)(base + l_remap[l_index[j]]));
+    }
+}
+
+
+/**
+ * Donne le cluster d'un buffer fusionné par la derniére construction
+ *
+ * @param buffer        Index du buffer dans le mesh construit
+ *
+ * @return              -1: toujours visible
+ */
+irr::s32 StaticBatcher::getCluster(irr::u32 buffer) const
+{
+    if(buffer >= l_cluster.size())
+        return -1;
+
+    return l_cluster[buffer];
+}
+
+
+/**
+ * Résumé de la derniére fusion: buffers d'origine (non vides) et buffers
+ * fusionnés, un appel de rendu chacun, et clusters séparés
+ */
+string StaticBatcher::toString() const
+{
+    ostringstream resume;
+    resume << nbSources << " mesh buffers -> " << nbBatches << " batches ("
+           << l_material.size() << " matériaux), " << nbClusters
+           << " clusters -> " << nbClusters - nbMergedClusters;
+
+    return resume.str();
+}
@@ -0,0 +1,84 @@
+/** \file   StaticBatcher.h
+ *  \brief  Définit la classe StaticBatcher
+ */
+#ifndef STATICBATCHER_H
+#define STATICBATCHER_H
+
+#include <irrlicht.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "LevelVisibility.h"
+
+#define BATCH_MAX_VERTICES      65535   // Indices 16 bits
+#define BATCH_CLUSTER_OFFSET    1.0f    // Devant la face, pour trouver son cluster
+#define BATCH_CLUSTER_TRIANGLES 256     // Taille minimale d'un cluster séparé
+
+using namespace std;
+
+
+/** \class  StaticBatcher
+ *  \brief  Regroupe les mesh buffers statiques d'un niveau par matériau.
+ *
+ * Les mesh buffers qui partagent le même matériau (tout son état: type,
+ * drapeaux, couches de texture dont la lightmap, shader Q3) sont
+ * fusionnés en gros buffers, dans l'ordre du
+ * mesh d'origine, jusqu'a BATCH_MAX_VERTICES vertices chacun. Le mesh
+ * obtenu est marqué EHM_STATIC: ses buffers restent en mémoire vidéo et
+ * chacun coûte un seul appel de rendu.
+ *
+ * Avec le PVS de la carte, les triangles sont aussi séparés par cluster
+ * (voir getCluster) pour que chaque buffer puisse être écarté. Un triangle
+ * a cheval sur plusieurs clusters, ou dans un solide, va au cluster -1:
+ * toujours visible. Chaque cluster séparé multiplie les buffers (un par
+ * matériau) et les nodes: un cluster de moins de minTriangles triangles
+ * rejoint donc le cluster -1.
+ */
+class StaticBatcher
+{
+    public:
+        StaticBatcher();
+        virtual ~StaticBatcher();
+
+        irr::scene::SMesh* build(irr::scene::IMesh* mesh,
+                const LevelVisibility* visibility = NULL,
+                irr::u32 minTriangles = BATCH_CLUSTER_TRIANGLES);
+
+        // Accesseurs
+        irr::s32 getCluster(irr::u32 buffer) const;
+        string toString() const;
+    protected:
+    private:
+        /// Ce qui doit être identique pour fusionner deux mesh buffers
+        struct BatchKey
+        {
+            irr::s32 cluster;
+            irr::u32 vertexType;
+            irr::u32 material;              // Index dans l_material
+
+            bool operator<(const BatchKey& autre) const;
+        };
+
+        /// Triangles d'un mesh buffer a fusionner
+        struct BatchPiece
+        {
+            irr::scene::IMeshBuffer* buffer;
+            vector<irr::u32> l_triangle;    // Premier index, vide: tous
+        };
+
+        irr::u32 nbSources;
+        irr::u32 nbBatches;
+        irr::u32 nbClusters;                // Du PVS, contenant des triangles
+        irr::u32 nbMergedClusters;          // Rejoints au cluster -1
+        vector<irr::s32> l_cluster;         // Cluster de chaque batch
+        vector<irr::video::SMaterial> l_material;   // Matériaux distincts
+
+        irr::u32 findMaterial(const irr::video::SMaterial& material);
+
+        template<class Vertex>
+        void merge(const vector<BatchPiece>& l_piece, irr::s32 cluster,
+                irr::scene::SMesh* batches);
+};
+
+#endif // STATICBATCHER_H
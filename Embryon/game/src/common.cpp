@@ -5,7 +5,6 @@
 
 #include <string>
 #include <vector>
-#include <time.h>
 
 using namespace std;
 
@@ -23,16 +22,3 @@ string wchar_to_string(const wchar_t * wcharstr){
 
     return test;
 }
-
-
-/**
- * Donne le temps en millisecondes
- *
- * @return      Temps en millisecondes
- */
-irr::u32 getTime()
-{
-    float time = (float)clock();
-
-    return (irr::u32)((time / (float)CLOCKS_PER_SEC) * 1000.f);
-}
@@ -5,10 +5,13 @@
 #ifndef COMMON_H
 #define COMMON_H
 
-#define FPS             50
+#define FPS             50      // Images par seconde (par défaut)
+#define TICK_RATE       60      // Pas de simulation par seconde (par défaut)
+#define MAX_TICKS       5       // Pas de simulation max par rattrapage
 
 #define GRAVITY         -2
 
+#include <boost/cstdint.hpp>
 #include <boost/multi_array.hpp>
 #include <string>
 #include <irrlicht.h>
@@ -20,7 +23,157 @@ using namespace std;
  *  \brief  Contient les identifiants des différents modules.
  */
 enum EnumModuleId {
-    CORE, RENDERING, EVENTS, GAME, GUI
+    CORE, RENDERING, EVENTS, GAME, GUI,
+
+    MODULE_COUNT                // Nombre d'identifiants de module
+};
+
+/** \enum   EnumCodesAction
+ *  \brief  Définit tout les codes possibles pour les messages.
+ */
+enum EnumCodesAction {
+    ACTION_AUCUNE=0,
+    ACTION_QUITTER,
+
+    // CODE ACTION CORE
+    ACTION_GAME_STATE_CHANGED,
+
+    // CODE ACTION RENDERING
+    ACTION_INIT_GAME,
+    ACTION_PLAYER_ACTION,
+    ACTION_CURSOR_MOVED,
+
+    // CODE ACTION EVENTS
+    ACTION_RELOAD_CONFIG_KEYS,
+
+    // CODE ACTION GAME
+    ACTION_NOUVELLE_PARTIE,
+    ACTION_QUITTER_PARTIE,
+    ACTION_PLAYER_SPAWN,
+    ACTION_ACTIVATE_ENTITY,
+    ACTION_START_WALKING_FORWARDS,
+    ACTION_START_WALKING_BACKWARDS,
+    ACTION_START_STRAFE_LEFT,
+    ACTION_START_STRAFE_RIGHT,
+    ACTION_STOP_WALKING_FORWARDS,
+    ACTION_STOP_WALKING_BACKWARDS,
+    ACTION_STOP_STRAFE_LEFT,
+    ACTION_STOP_STRAFE_RIGHT,
+
+    // CODE ACTION GUI
+    ACTION_CHANGE_MENU,
+    ACTION_MENU_ON_ESCAPE,
+    ACTION_SAVE_CONFIG,
+
+    ACTION_COUNT                // Nombre de codes action
+};
+
+/** \enum   EnumTopic
+ *  \brief  Groupes d'actions auxquels un module peut s'abonner.
+ *
+ * Chaque code action appartient a un seul groupe. Un module s'abonne a
+ * plusieurs groupes en combinant leurs TOPIC_MASK.
+ */
+enum EnumTopic {
+    TOPIC_SYSTEM=0,             // Arret de l'application
+    TOPIC_MENU,                 // Navigation dans les menus
+    TOPIC_CONFIG,               // Sauvegarde et rechargement de la config
+    TOPIC_PARTIE,               // Début, pause et fin de partie
+    TOPIC_PLAYER_MOVE,          // Déplacements du joueur
+    TOPIC_PLAYER_ACTION,        // Actions du joueur sur le niveau
+    TOPIC_GAME_STATE,           // Transitions de l'état du jeu (Core)
+
+    TOPIC_COUNT                 // Nombre de groupes
+};
+
+#define TOPIC_MASK(topic)       (1 << (topic))
+
+/** \enum   EnumMessageLane
+ *  \brief  Voies de la file de message d'un module.
+ *
+ * La voie temps réel (entrées, gameplay) est toujours traitée avant la
+ * voie de fond (menus, config, chargement).
+ */
+enum EnumMessageLane {
+    LANE_REALTIME=0,
+    LANE_BULK,
+
+    LANE_COUNT                  // Nombre de voies
+};
+
+/** \enum   EnumGameState
+ *  \brief  Définit tout les états de jeu possible.
+ */
+enum EnumGameState {
+    IN_MAIN_MENU=0,
+    IN_CHOOSE_LEVEL_MENU,
+    IN_OPTIONS_MENU,
+    IN_PAUSE_MENU,
+    IN_GAME,
+    IN_LOADING_MENU
+};
+
+/** \enum   EnumGameSceneNode
+ *  \brief  Définit tout les scenes nodes utilisé.
+ *
+ * Les valeurs sont des masques de bits afin de pouvoir être utilisées
+ * pour la selection de node par rayon.
+ */
+enum EnumGameSceneNode {
+    SCENE_NODE_AUCUN=0,
+    SCENE_NODE_PLAYER=1,
+    SCENE_NODE_MOBS=2,
+    SCENE_NODE_MAP=4,
+    SCENE_NODE_ENTITY=8
+};
+
+/** \enum   EnumCodeMenuItems
+ *  \brief  Définit tout les éléments de GUI utilisé.
+ */
+enum EnumCodeMenuItems {
+    // MENU PRINCIPAL
+    GUI_MAINMENU_JOUER=101,
+    GUI_MAINMENU_OPTIONS,
+    GUI_MAINMENU_QUITTER,
+
+    // MENU CHOOSE LEVEL
+    GUI_CHOOSELEVELMENU_NIVEAU1,
+    GUI_CHOOSELEVELMENU_NIVEAU2,
+    GUI_CHOOSELEVELMENU_NIVEAU3,
+    GUI_CHOOSELEVELMENU_NIVEAU4,
+    GUI_CHOOSELEVELMENU_NIVEAU5,
+    GUI_CHOOSELEVELMENU_NIVEAU6,
+    GUI_CHOOSELEVELMENU_RETOUR,
+
+    // MENU OPTIONS
+    GUI_OPTIONSMENU_TABCONTROL,
+    GUI_OPTIONSMENU_RETOUR,
+    GUI_OPTIONSMENU_KEYS,
+    GUI_OPTIONSMENU_KEYS_APPLIQUER,
+    GUI_OPTIONSMENU_KEYS_FORWARD,
+    GUI_OPTIONSMENU_KEYS_BACKWARD,
+    GUI_OPTIONSMENU_KEYS_LEFT,
+    GUI_OPTIONSMENU_KEYS_RIGHT,
+    GUI_OPTIONSMENU_KEYS_SHOOT,
+    GUI_OPTIONSMENU_KEYS_ACTION,
+    GUI_OPTIONSMENU_VIDEO,
+    GUI_OPTIONSMENU_VIDEO_APPLIQUER,
+    GUI_OPTIONSMENU_VIDEO_RESOLUTION,
+    GUI_OPTIONSMENU_VIDEO_FULLSCREEN,
+    GUI_OPTIONSMENU_VIDEO_VSYNC,
+    GUI_OPTIONSMENU_AUDIO,
+    GUI_OPTIONSMENU_MISC,
+
+
+    // MENU PAUSE
+    GUI_PAUSEMENU_CONTINUER,
+    GUI_PAUSEMENU_OPTIONS,
+    GUI_PAUSEMENU_QUITTERPARTIE,
+    GUI_PAUSEMENU_QUITTER,
+
+    // ECRAN DE CHARGEMENT
+    GUI_LOADINGMENU_ETAPE,
+    GUI_LOADINGMENU_BARRE
 };
 
 /** \enum   EnumDirection
@@ -33,6 +186,20 @@ enum EnumDirection {
     DROITE
 };
 
+/** \enum   EnumCodePlayerAction
+ *  \brief  Actions du joueur affectables a une entrée (section KEYS)
+ */
+enum EnumCodePlayerAction {
+    PLAYER_ACTION_FORWARD=0,
+    PLAYER_ACTION_BACKWARD,
+    PLAYER_ACTION_LEFT,
+    PLAYER_ACTION_RIGHT,
+    PLAYER_ACTION_SHOOT,
+    PLAYER_ACTION_ACTION,
+
+    PLAYER_ACTION_COUNT         // Nombre d'actions
+};
+
 /** \enum   EnumEntityActivation
  *  \brief  Définit tous les types d'activation d'entité possible
  */
@@ -47,6 +214,4 @@ enum EnumEntityActivation {
 string wchar_to_string(const wchar_t*);
 string string_to_wchar(const string*);
 
-irr::u32 getTime();
-
 #endif // COMMON_H
@@ -48,7 +48,7 @@ int main()
     GUIEngine       gui(&core);
     EventsEngine    events(&core);
     RenderingEngine rendering(&core, &events);
-    //Module ia("IA", &core);
+    //Module ia("IA", &core);   // S'abonnera a TOPIC_PLAYER_MOVE/ACTION
 
     try {
         core.main();
@@ -3,6 +3,8 @@
  */
 #include "module_message.h"
 
+#include <string.h>
+
 
 /**
  * Constructeur de module_message.
@@ -15,7 +17,11 @@ module_message::module_message(
         EnumModuleId idExpediteur, EnumModuleId idDestination,
         EnumCodesAction codeAction)
 {
-    intData = map<string, int>();
+    memset(&data, 0, sizeof(data));
+    sendTime = 0;
+    enqueueTime = 0;
+    dequeueTime = 0;
+    handledTime = 0;
 
     this->idExpediteur = idExpediteur;
     this->idDestination = idDestination;
@@ -29,3 +35,123 @@ module_message::~module_message()
 {
     //dtor
 }
+
+
+/**
+ * Copie une chaine dans l'un des champs texte d'un message.
+ * La chaine est tronquée si elle dépasse MESSAGE_STRING_SIZE - 1 caractéres.
+ *
+ * @param destination       Champ texte du message
+ * @param source            Chaine a copier
+ */
+void module_message::setString(char* destination, const string& source)
+{
+    strncpy(destination, source.c_str(), MESSAGE_STRING_SIZE - 1);
+    destination[MESSAGE_STRING_SIZE - 1] = '\0';
+}
+
+
+/**
+ * Donne le groupe auquel appartient l'action du message.
+ * Utilisé par le Core pour distribuer les messages publiés.
+ *
+ * @return          Groupe de l'action
+ */
+EnumTopic module_message::getTopic()
+{
+    switch(codeAction) {
+    case ACTION_CHANGE_MENU:
+    case ACTION_MENU_ON_ESCAPE:
+        return TOPIC_MENU;
+
+    case ACTION_RELOAD_CONFIG_KEYS:
+    case ACTION_SAVE_CONFIG:
+        return TOPIC_CONFIG;
+
+    case ACTION_INIT_GAME:
+    case ACTION_NOUVELLE_PARTIE:
+    case ACTION_QUITTER_PARTIE:
+    case ACTION_PLAYER_SPAWN:
+        return TOPIC_PARTIE;
+
+    case ACTION_START_WALKING_FORWARDS:
+    case ACTION_START_WALKING_BACKWARDS:
+    case ACTION_START_STRAFE_LEFT:
+    case ACTION_START_STRAFE_RIGHT:
+    case ACTION_STOP_WALKING_FORWARDS:
+    case ACTION_STOP_WALKING_BACKWARDS:
+    case ACTION_STOP_STRAFE_LEFT:
+    case ACTION_STOP_STRAFE_RIGHT:
+        return TOPIC_PLAYER_MOVE;
+
+    case ACTION_PLAYER_ACTION:
+    case ACTION_CURSOR_MOVED:
+    case ACTION_ACTIVATE_ENTITY:
+        return TOPIC_PLAYER_ACTION;
+
+    case ACTION_GAME_STATE_CHANGED:
+        return TOPIC_GAME_STATE;
+
+    default:
+        return TOPIC_SYSTEM;
+    }
+}
+
+
+/**
+ * Donne la voie dans laquelle le message doit être déposé.
+ * Les entrées du joueur et le gameplay passent avant les menus, la config
+ * et le chargement.
+ *
+ * @return          Voie du message
+ */
+EnumMessageLane module_message::getLane()
+{
+    switch(getTopic()) {
+    case TOPIC_SYSTEM:
+    case TOPIC_PLAYER_MOVE:
+    case TOPIC_PLAYER_ACTION:
+    case TOPIC_GAME_STATE:
+        return LANE_REALTIME;
+
+    default:
+        return LANE_BULK;
+    }
+}
+
+
+/**
+ * Donne le nom d'un code action (pour les statistiques et les logs)
+ *
+ * @param codeAction    Code action
+ *
+ * @return              Nom du code action
+ */
+const char* module_message::getActionName(EnumCodesAction codeAction)
+{
+    switch(codeAction) {
+    case ACTION_AUCUNE:                     return "ACTION_AUCUNE";
+    case ACTION_QUITTER:                    return "ACTION_QUITTER";
+    case ACTION_GAME_STATE_CHANGED:         return "ACTION_GAME_STATE_CHANGED";
+    case ACTION_INIT_GAME:                  return "ACTION_INIT_GAME";
+    case ACTION_PLAYER_ACTION:              return "ACTION_PLAYER_ACTION";
+    case ACTION_CURSOR_MOVED:               return "ACTION_CURSOR_MOVED";
+    case ACTION_RELOAD_CONFIG_KEYS:         return "ACTION_RELOAD_CONFIG_KEYS";
+    case ACTION_NOUVELLE_PARTIE:            return "ACTION_NOUVELLE_PARTIE";
+    case ACTION_QUITTER_PARTIE:             return "ACTION_QUITTER_PARTIE";
+    case ACTION_PLAYER_SPAWN:               return "ACTION_PLAYER_SPAWN";
+    case ACTION_ACTIVATE_ENTITY:            return "ACTION_ACTIVATE_ENTITY";
+    case ACTION_START_WALKING_FORWARDS:     return "ACTION_START_WALKING_FORWARDS";
+    case ACTION_START_WALKING_BACKWARDS:    return "ACTION_START_WALKING_BACKWARDS";
+    case ACTION_START_STRAFE_LEFT:          return "ACTION_START_STRAFE_LEFT";
+    case ACTION_START_STRAFE_RIGHT:         return "ACTION_START_STRAFE_RIGHT";
+    case ACTION_STOP_WALKING_FORWARDS:      return "ACTION_STOP_WALKING_FORWARDS";
+    case ACTION_STOP_WALKING_BACKWARDS:     return "ACTION_STOP_WALKING_BACKWARDS";
+    case ACTION_STOP_STRAFE_LEFT:           return "ACTION_STOP_STRAFE_LEFT";
+    case ACTION_STOP_STRAFE_RIGHT:          return "ACTION_STOP_STRAFE_RIGHT";
+    case ACTION_CHANGE_MENU:                return "ACTION_CHANGE_MENU";
+    case ACTION_MENU_ON_ESCAPE:             return "ACTION_MENU_ON_ESCAPE";
+    case ACTION_SAVE_CONFIG:                return "ACTION_SAVE_CONFIG";
+    default:                                return "ACTION_INCONNUE";
+    }
+}
@@ -5,34 +5,105 @@
 #define MODULE_MESSAGE_H
 
 #include <iostream>
-#include <map>
+#include <string>
 
 #include "common.h"
 
+#define MESSAGE_STRING_SIZE     64      // Taille max des chaines d'un message
+
 using namespace std;
 
 
+/** \union  MessageData
+ *  \brief  Données transportées par un module_message.
+ *
+ * Le membre à utiliser dépend du code action du message. Les données sont
+ * stockées dans le message lui même, envoyer un message ne demande donc
+ * aucune allocation.
+ */
+union MessageData {
+    // ACTION_CHANGE_MENU
+    struct {
+        EnumGameState menu;
+    } menu;
+
+    // ACTION_NOUVELLE_PARTIE
+    struct {
+        int niveau;
+    } nouvellePartie;
+
+    // ACTION_INIT_GAME
+    struct {
+        char niveau[MESSAGE_STRING_SIZE];
+    } initGame;
+
+    // ACTION_PLAYER_SPAWN
+    struct {
+        irr::f32 x, y, z;
+    } spawn;
+
+    // ACTION_ACTIVATE_ENTITY
+    struct {
+        irr::scene::ISceneNode* node;
+        EnumEntityActivation type;
+    } activation;
+
+    // ACTION_START_*, ACTION_STOP_*, ACTION_PLAYER_ACTION (capture de
+    // l'entrée, voir EventsEngine)
+    struct {
+        boost::uint64_t time;           // TimeService::now
+        boost::uint64_t gameTime;       // Horloge de jeu
+    } input;
+
+    // ACTION_CURSOR_MOVED (relecture, voir EventsEngine)
+    struct {
+        irr::s32 x, y;
+    } cursor;
+
+    // ACTION_GAME_STATE_CHANGED (mots d'état, voir GameState)
+    struct {
+        irr::u32 ancien;
+        irr::u32 nouveau;
+    } gameState;
+};
+
+
 /** \class  module_message
  *  \brief  Contient toutes les informations concernant un message.
  *
  * Les messages sont envoyés par un Module ou le Core vers un autre Module ou
  * le Core. Ils permettent aux modules de communiquer entre-eux.
+ *
+ * Un message ne contient que des types simples: il peut être copié sans
+ * allocation.
  */
 class module_message
 {
     public:
         module_message(
-                EnumModuleId idExpediteur, EnumModuleId idDestination,
+                EnumModuleId idExpediteur=CORE, EnumModuleId idDestination=CORE,
                 EnumCodesAction codeAction=ACTION_AUCUNE);
         ~module_message();
 
+        static void setString(char* destination, const string& source);
+
+        EnumTopic getTopic();
+        EnumMessageLane getLane();
+
+        static const char* getActionName(EnumCodesAction codeAction);
+
         EnumModuleId idExpediteur;
         EnumModuleId idDestination;
 
         EnumCodesAction codeAction;     // Action que l'on souhaite effectuer
 
-        map<string, int> intData;
-        map<string, string> strData;
+        MessageData data;               // Dépend de codeAction
+
+        // Traçage du message (horloge monotone, ns)
+        boost::uint64_t sendTime;       // Envoi par le Core
+        boost::uint64_t enqueueTime;    // Dépôt dans la file
+        boost::uint64_t dequeueTime;    // Début du traitement
+        boost::uint64_t handledTime;    // Fin du traitement
 };
 
 #endif // MODULE_MESSAGE_H